@@ -0,0 +1,148 @@
+/**
+ * Benchmark of the operations of tsl::hopscotch_map for the different growth policies, NeighborhoodSize
+ * and StoreHash parameters, with int64_t and std::string keys. StoreHash is only tried with a NeighborhoodSize
+ * of at most 30 (the maximum with StoreHash).
+ *
+ * For each configuration, nb_elements values are inserted in an empty map (without reserve), then the keys
+ * are searched in a random order ('find_hit') and keys which are not in the map are searched ('find_miss').
+ * The map is then iterated, rehashed to twice its bucket count and all its values are erased.
+ *
+ * The times are in ns per element (per operation for find). The keys are generated from a counter with
+ * a bijective mix so that the missing keys are known not to be in the map.
+ *
+ * Usage: ./bench_hopscotch_map [nb_elements]
+ */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+
+
+namespace {
+
+template<class Key>
+Key get_key(std::uint64_t counter);
+
+template<>
+std::int64_t get_key<std::int64_t>(std::uint64_t counter) {
+    return std::int64_t(bench::mix(counter));
+}
+
+template<>
+std::string get_key<std::string>(std::uint64_t counter) {
+    return "key_" + std::to_string(bench::mix(counter));
+}
+
+const char* key_name(std::int64_t) { return "int64_t"; }
+const char* key_name(const std::string&) { return "string"; }
+
+const char* growth_policy_name(tsl::power_of_two_growth_policy*) { return "power_of_two"; }
+const char* growth_policy_name(tsl::mod_growth_policy<>*) { return "mod"; }
+const char* growth_policy_name(tsl::prime_growth_policy*) { return "prime"; }
+
+template<class Key, unsigned int NeighborhoodSize, bool StoreHash, class GrowthPolicy>
+void bench_map(std::size_t nb_elements, std::size_t& checksum) {
+    using map_type = tsl::hopscotch_map<Key, std::int64_t, std::hash<Key>, std::equal_to<Key>,
+                                        std::allocator<std::pair<Key, std::int64_t>>,
+                                        NeighborhoodSize, StoreHash, GrowthPolicy>;
+    
+    std::vector<Key> keys;
+    std::vector<Key> missing_keys;
+    keys.reserve(nb_elements);
+    missing_keys.reserve(nb_elements);
+    for(std::size_t i = 0; i < nb_elements; i++) {
+        keys.push_back(get_key<Key>(i));
+        missing_keys.push_back(get_key<Key>(nb_elements + i));
+    }
+    
+    std::vector<Key> shuffled_keys = keys;
+    std::shuffle(shuffled_keys.begin(), shuffled_keys.end(), std::mt19937_64(nb_elements));
+    
+    map_type map;
+    
+    bench::timer timer_insert;
+    for(std::size_t i = 0; i < nb_elements; i++) {
+        map.insert({keys[i], std::int64_t(i)});
+    }
+    const double insert = timer_insert.ns_per_operation(nb_elements);
+    
+    bench::timer timer_find_hit;
+    for(const Key& key: shuffled_keys) {
+        checksum += std::size_t(map.find(key)->second);
+    }
+    const double find_hit = timer_find_hit.ns_per_operation(nb_elements);
+    
+    bench::timer timer_find_miss;
+    for(const Key& key: missing_keys) {
+        checksum += (map.find(key) == map.end())?0:1;
+    }
+    const double find_miss = timer_find_miss.ns_per_operation(nb_elements);
+    
+    bench::timer timer_iterate;
+    for(const auto& key_value: map) {
+        checksum += std::size_t(key_value.second);
+    }
+    const double iterate = timer_iterate.ns_per_operation(nb_elements);
+    
+    const std::size_t overflow_size = map.overflow_size();
+    
+    bench::timer timer_rehash;
+    map.rehash(map.bucket_count()*2);
+    const double rehash = timer_rehash.ns_per_operation(nb_elements);
+    
+    bench::timer timer_erase;
+    for(const Key& key: shuffled_keys) {
+        checksum += map.erase(key);
+    }
+    const double erase = timer_erase.ns_per_operation(nb_elements);
+    
+    std::printf("%13s %17u %10s %8s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9zu\n",
+                growth_policy_name(static_cast<GrowthPolicy*>(nullptr)), NeighborhoodSize,
+                StoreHash?"true":"false", key_name(Key()), insert, find_hit, find_miss, iterate, rehash, erase,
+                overflow_size);
+}
+
+template<class Key, class GrowthPolicy>
+void bench_growth_policy(std::size_t nb_elements, std::size_t& checksum) {
+    bench_map<Key, 8, false, GrowthPolicy>(nb_elements, checksum);
+    bench_map<Key, 8, true, GrowthPolicy>(nb_elements, checksum);
+    bench_map<Key, 30, false, GrowthPolicy>(nb_elements, checksum);
+    bench_map<Key, 30, true, GrowthPolicy>(nb_elements, checksum);
+    // StoreHash needs a NeighborhoodSize <= 30
+    bench_map<Key, 62, false, GrowthPolicy>(nb_elements, checksum);
+}
+
+template<class Key>
+void bench_key(std::size_t nb_elements, std::size_t& checksum) {
+    bench_growth_policy<Key, tsl::power_of_two_growth_policy>(nb_elements, checksum);
+    bench_growth_policy<Key, tsl::mod_growth_policy<>>(nb_elements, checksum);
+    bench_growth_policy<Key, tsl::prime_growth_policy>(nb_elements, checksum);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::size_t nb_elements = (argc > 1)?std::strtoull(argv[1], nullptr, 10):1000000;
+    std::size_t checksum = 0;
+    
+    std::printf("Time in ns per element for %zu elements. 'overflow' is overflow_size() before the rehash.\n",
+                nb_elements);
+    std::printf("%13s %17s %10s %8s %9s %9s %9s %9s %9s %9s %9s\n", "growth_policy", "NeighborhoodSize",
+                "StoreHash", "key", "insert", "find_hit", "find_miss", "iterate", "rehash", "erase", "overflow");
+    
+    bench_key<std::int64_t>(nb_elements, checksum);
+    bench_key<std::string>(nb_elements, checksum);
+    
+    std::printf("checksum: %zu\n", checksum);
+}
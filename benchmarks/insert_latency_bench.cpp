@@ -0,0 +1,208 @@
+/**
+ * Latency of each insert while a map grows from empty to nb_elements values, to find the tail latency
+ * of the inserts and what causes it.
+ *
+ * Each insert is timed and classified with the counters of the map (the benchmark is compiled with
+ * TSL_HOPSCOTCH_ENABLE_COUNTERS, see tsl::hopscotch_counters):
+ * - 'rehash': the insert triggered a rehash, because of the load factor or of a full neighborhood
+ *   (with incremental_rehash(true), only the start of the rehash, the migration of the values is spread
+ *   over the next inserts which are then in the other categories).
+ * - 'overflow': the value was inserted in the overflow list.
+ * - 'displacement': values were displaced to get an empty bucket in the neighborhood.
+ * - 'direct': there was an empty bucket in the neighborhood.
+ *
+ * The latencies are recorded in a log-linear histogram (128 sub-buckets per power of two, < 0.8% of error),
+ * the percentiles are given for all the inserts and for each category. 'outliers' is the number of inserts
+ * of the category slower than the p99.9 of all the inserts and 'time %' the share of the total time spent
+ * in the inserts of the category. The latencies include the overhead of the clock (~20 ns).
+ *
+ * Usage: ./bench_insert_latency [nb_elements (default 10^8)]
+ */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+
+
+namespace {
+
+/*
+ * Histogram of latencies in ns. The values below 2^SUB_BUCKET_BITS are recorded exactly, the ones above in
+ * 2^(SUB_BUCKET_BITS - 1) sub-buckets per power of two.
+ */
+class latency_histogram {
+public:
+    latency_histogram(): m_counts(SUB_BUCKET_COUNT + (64 - SUB_BUCKET_BITS)*SUB_BUCKET_HALF_COUNT, 0),
+                         m_nb_values(0), m_sum(0), m_max(0)
+    {
+    }
+    
+    void add(std::uint64_t value) {
+        m_counts[index_for_value(value)]++;
+        m_nb_values++;
+        m_sum += value;
+        m_max = std::max(m_max, value);
+    }
+    
+    /*
+     * Lower bound of the sub-bucket of the value at the percentile (in [0, 100]).
+     */
+    std::uint64_t percentile(double percentile) const {
+        const std::uint64_t rank = std::uint64_t(double(m_nb_values)*percentile/100.0);
+        
+        std::uint64_t nb_values = 0;
+        for(std::size_t index = 0; index < m_counts.size(); index++) {
+            nb_values += m_counts[index];
+            if(nb_values > rank) {
+                return value_for_index(index);
+            }
+        }
+        
+        return m_max;
+    }
+    
+    /*
+     * Number of values strictly greater than the sub-bucket of threshold.
+     */
+    std::uint64_t count_above(std::uint64_t threshold) const {
+        std::uint64_t nb_values = 0;
+        for(std::size_t index = index_for_value(threshold) + 1; index < m_counts.size(); index++) {
+            nb_values += m_counts[index];
+        }
+        
+        return nb_values;
+    }
+    
+    std::uint64_t nb_values() const { return m_nb_values; }
+    std::uint64_t sum() const { return m_sum; }
+    std::uint64_t max() const { return m_max; }
+
+private:
+    static std::size_t index_for_value(std::uint64_t value) {
+        if(value < SUB_BUCKET_COUNT) {
+            return std::size_t(value);
+        }
+        
+        unsigned int exponent = SUB_BUCKET_BITS;
+        while(exponent < 64 && (value >> exponent) != 0) {
+            exponent++;
+        }
+        
+        // value >> shift is in [SUB_BUCKET_HALF_COUNT, SUB_BUCKET_COUNT)
+        const unsigned int shift = exponent - SUB_BUCKET_BITS;
+        return SUB_BUCKET_COUNT + (shift - 1)*SUB_BUCKET_HALF_COUNT +
+               std::size_t((value >> shift) - SUB_BUCKET_HALF_COUNT);
+    }
+    
+    static std::uint64_t value_for_index(std::size_t index) {
+        if(index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        
+        const unsigned int shift = unsigned(1 + (index - SUB_BUCKET_COUNT)/SUB_BUCKET_HALF_COUNT);
+        return std::uint64_t(SUB_BUCKET_HALF_COUNT + (index - SUB_BUCKET_COUNT)%SUB_BUCKET_HALF_COUNT) << shift;
+    }
+
+private:
+    static const unsigned int SUB_BUCKET_BITS = 8;
+    static const std::size_t SUB_BUCKET_COUNT = std::size_t(1) << SUB_BUCKET_BITS;
+    static const std::size_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT/2;
+    
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_nb_values;
+    std::uint64_t m_sum;
+    std::uint64_t m_max;
+};
+
+enum insert_category { direct, displacement, overflow, rehash, nb_insert_categories };
+
+const char* const insert_category_names[] = {"direct", "displacement", "overflow", "rehash"};
+
+insert_category categorize(const tsl::hopscotch_counters& before, const tsl::hopscotch_counters& after) {
+    if(after.nb_rehashes_on_load_threshold != before.nb_rehashes_on_load_threshold ||
+       after.nb_rehashes_on_full_neighborhood != before.nb_rehashes_on_full_neighborhood)
+    {
+        return rehash;
+    }
+    
+    if(after.nb_overflow_inserts != before.nb_overflow_inserts) {
+        return overflow;
+    }
+    
+    if(after.nb_displacements != before.nb_displacements) {
+        return displacement;
+    }
+    
+    return direct;
+}
+
+void print_histogram(const char* config_name, const char* category_name, const latency_histogram& histogram,
+                     std::uint64_t outliers_threshold, std::uint64_t total_time)
+{
+    std::printf("%-34s %12s %11llu %7llu %7llu %9llu %10llu %9llu %7.1f\n", config_name, category_name,
+                static_cast<unsigned long long>(histogram.nb_values()),
+                static_cast<unsigned long long>(histogram.percentile(50.0)),
+                static_cast<unsigned long long>(histogram.percentile(99.0)),
+                static_cast<unsigned long long>(histogram.percentile(99.9)),
+                static_cast<unsigned long long>(histogram.max()),
+                static_cast<unsigned long long>(histogram.count_above(outliers_threshold)),
+                100.0*double(histogram.sum())/double(total_time));
+}
+
+template<class Map>
+void bench_map(const char* config_name, std::size_t nb_elements, bool incremental_rehash) {
+    std::unique_ptr<Map> map(new Map());
+    map->incremental_rehash(incremental_rehash);
+    
+    latency_histogram all_inserts;
+    std::vector<latency_histogram> inserts_by_category(nb_insert_categories);
+    
+    tsl::hopscotch_counters counters = map->counters();
+    for(std::size_t i = 0; i < nb_elements; i++) {
+        const std::int64_t key = std::int64_t(bench::mix(i));
+        
+        bench::timer timer;
+        map->insert({key, std::int64_t(i)});
+        const std::uint64_t latency = timer.elapsed_ns();
+        
+        const tsl::hopscotch_counters counters_after_insert = map->counters();
+        all_inserts.add(latency);
+        inserts_by_category[categorize(counters, counters_after_insert)].add(latency);
+        counters = counters_after_insert;
+    }
+    
+    const std::uint64_t outliers_threshold = all_inserts.percentile(99.9);
+    print_histogram(config_name, "all", all_inserts, outliers_threshold, all_inserts.sum());
+    for(std::size_t category = 0; category < nb_insert_categories; category++) {
+        print_histogram(config_name, insert_category_names[category], inserts_by_category[category],
+                        outliers_threshold, all_inserts.sum());
+    }
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::size_t nb_elements = (argc > 1)?std::strtoull(argv[1], nullptr, 10):100000000;
+    
+    using map_type = tsl::hopscotch_map<std::int64_t, std::int64_t>;
+    using map_ns8_type = tsl::hopscotch_map<std::int64_t, std::int64_t, std::hash<std::int64_t>,
+                                            std::equal_to<std::int64_t>,
+                                            std::allocator<std::pair<std::int64_t, std::int64_t>>, 8>;
+    
+    std::printf("Insert latencies in ns while growing to %zu elements.\n", nb_elements);
+    std::printf("%-34s %12s %11s %7s %7s %9s %10s %9s %7s\n", "map", "inserts", "count", "p50", "p99", "p99.9",
+                "max", "outliers", "time %");
+    
+    bench_map<map_type>("hopscotch_map", nb_elements, false);
+    bench_map<map_type>("hopscotch_map incremental_rehash", nb_elements, true);
+    bench_map<map_ns8_type>("hopscotch_map NS=8", nb_elements, false);
+}
@@ -0,0 +1,152 @@
+/**
+ * Microbenchmark of the kernels used by hopscotch_hash to search the neighborhood of a bucket:
+ * find_neighbor_shift_loop (previous implementation), find_neighbor_bit_scan and find_neighbor_unrolled.
+ * 
+ * For each NeighborhoodSize, neighborhood bitmaps are generated with a given number of neighbors, placed either 
+ * close to the home bucket ('near', as with a low load factor) or anywhere in the neighborhood ('spread', 
+ * as with a high load factor after displacements). Each kernel then searches a key among the neighbors, 
+ * the key is either present ('hit') or absent ('miss', all the neighbors are compared).
+ * 
+ * Usage: ./bench_lookup_kernel [nb_neighborhoods]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "hopscotch_hash.h"
+
+
+namespace {
+    
+using namespace tsl::detail_hopscotch_hash;
+
+unsigned int count_set_bits(std::uint_least64_t value) {
+    unsigned int nb_set_bits = 0;
+    for(; value != 0; value &= value - 1) {
+        nb_set_bits++;
+    }
+    
+    return nb_set_bits;
+}
+
+struct neighborhood_sample {
+    std::uint_least64_t neighborhood_infos;
+    std::int64_t searched_key;
+};
+
+/*
+ * Keys of the neighbors are stored in keys[i*NeighborhoodSize + ineighbor].
+ */
+template<unsigned int NeighborhoodSize>
+void generate_samples(std::size_t nb_neighborhoods, unsigned int nb_neighbors, bool spread, bool hit,
+                      std::vector<neighborhood_sample>& samples, std::vector<std::int64_t>& keys) 
+{
+    std::mt19937_64 generator(nb_neighborhoods + nb_neighbors + (spread?1:0) + (hit?2:0));
+    const unsigned int max_offset = spread?NeighborhoodSize:std::min(NeighborhoodSize, 2*nb_neighbors);
+    std::uniform_int_distribution<unsigned int> offset_distribution(0, max_offset - 1);
+    
+    samples.resize(nb_neighborhoods);
+    keys.assign(nb_neighborhoods*NeighborhoodSize, -1);
+    
+    for(std::size_t i = 0; i < nb_neighborhoods; i++) {
+        std::uint_least64_t neighborhood_infos = 0;
+        while(count_set_bits(neighborhood_infos) < nb_neighbors) {
+            neighborhood_infos |= std::uint_least64_t(1) << offset_distribution(generator);
+        }
+        
+        std::vector<unsigned int> neighbors;
+        for(unsigned int ineighbor = 0; ineighbor < NeighborhoodSize; ineighbor++) {
+            if(((neighborhood_infos >> ineighbor) & 1) == 1) {
+                keys[i*NeighborhoodSize + ineighbor] = std::int64_t(generator() >> 1);
+                neighbors.push_back(ineighbor);
+            }
+        }
+        
+        samples[i].neighborhood_infos = neighborhood_infos;
+        samples[i].searched_key = hit?keys[i*NeighborhoodSize + neighbors[generator() % neighbors.size()]]:-2;
+    }
+}
+
+enum class kernel { shift_loop, bit_scan, unrolled };
+
+template<unsigned int NeighborhoodSize>
+double bench_kernel(kernel kernel_type, const std::vector<neighborhood_sample>& samples, 
+                    const std::vector<std::int64_t>& keys, std::size_t& checksum) 
+{
+    using neighborhood_bitmap = typename smallest_type_for_min_bits<NeighborhoodSize + 
+                                                                    NB_RESERVED_BITS_IN_NEIGHBORHOOD>::type;
+    const std::size_t nb_repeats = 10;
+    
+    const auto start = std::chrono::high_resolution_clock::now();
+    for(std::size_t repeat = 0; repeat < nb_repeats; repeat++) {
+        for(std::size_t i = 0; i < samples.size(); i++) {
+            const std::int64_t* neighbors_keys = keys.data() + i*NeighborhoodSize;
+            const std::int64_t searched_key = samples[i].searched_key;
+            const neighborhood_bitmap neighborhood_infos = neighborhood_bitmap(samples[i].neighborhood_infos);
+            auto predicate = [&](std::size_t ineighbor) { return neighbors_keys[ineighbor] == searched_key; };
+            
+            switch(kernel_type) {
+                case kernel::shift_loop:
+                    checksum += find_neighbor_shift_loop<NeighborhoodSize>(neighborhood_infos, predicate);
+                    break;
+                case kernel::bit_scan:
+                    checksum += find_neighbor_bit_scan<NeighborhoodSize>(neighborhood_infos, predicate);
+                    break;
+                case kernel::unrolled:
+                    checksum += find_neighbor_unrolled<NeighborhoodSize>(neighborhood_infos, predicate);
+                    break;
+            }
+        }
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    
+    const double nb_lookups = double(nb_repeats*samples.size());
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())/nb_lookups;
+}
+
+template<unsigned int NeighborhoodSize>
+void bench_neighborhood_size(std::size_t nb_neighborhoods, std::size_t& checksum) {
+    std::vector<neighborhood_sample> samples;
+    std::vector<std::int64_t> keys;
+    
+    for(unsigned int nb_neighbors: {1u, 2u, 4u}) {
+        for(bool spread: {false, true}) {
+            for(bool hit: {true, false}) {
+                generate_samples<NeighborhoodSize>(nb_neighborhoods, nb_neighbors, spread, hit, samples, keys);
+                
+                const double shift_loop = bench_kernel<NeighborhoodSize>(kernel::shift_loop, samples, keys, checksum);
+                const double bit_scan = bench_kernel<NeighborhoodSize>(kernel::bit_scan, samples, keys, checksum);
+                const double unrolled = bench_kernel<NeighborhoodSize>(kernel::unrolled, samples, keys, checksum);
+                
+                std::printf("%17u %12u %7s %5s %11.2f %9.2f %9.2f  %s\n", NeighborhoodSize, nb_neighbors, 
+                            spread?"spread":"near", hit?"hit":"miss", shift_loop, bit_scan, unrolled,
+                            (NeighborhoodSize <= MAX_NEIGHBORHOOD_SIZE_UNROLLED_LOOKUP)?"unrolled":"bit_scan");
+            }
+        }
+    }
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::size_t nb_neighborhoods = (argc > 1)?std::strtoull(argv[1], nullptr, 10):(1 << 16);
+    std::size_t checksum = 0;
+    
+    std::printf("Time per lookup in ns. 'used' is the kernel selected by find_neighbor.\n");
+    std::printf("%17s %12s %7s %5s %11s %9s %9s  %s\n", "NeighborhoodSize", "nb_neighbors", "offsets", "", 
+                "shift_loop", "bit_scan", "unrolled", "used");
+    
+    bench_neighborhood_size<4>(nb_neighborhoods, checksum);
+    bench_neighborhood_size<8>(nb_neighborhoods, checksum);
+    bench_neighborhood_size<16>(nb_neighborhoods, checksum);
+    bench_neighborhood_size<30>(nb_neighborhoods, checksum);
+    bench_neighborhood_size<62>(nb_neighborhoods, checksum);
+    
+    std::printf("checksum: %zu\n", checksum);
+}
@@ -0,0 +1,152 @@
+/**
+ * Memory footprint of tsl::hopscotch_map and tsl::hopscotch_sc_map for different value types, NeighborhoodSize,
+ * StoreHash and bucket layouts, measured with a counting allocator.
+ *
+ * For each configuration:
+ * - 'bytes/bucket' is the exact size of a bucket, occupancy bit included, measured as the difference of
+ *   the bytes allocated by two empty maps of nb_buckets and 2*nb_buckets buckets divided by nb_buckets.
+ * - 'padding' is the size of the NeighborhoodSize - 1 buckets allocated after the bucket_count() buckets
+ *   so that the neighborhood of the last bucket doesn't wrap around.
+ *
+ * Then, for each load factor, a map of nb_buckets buckets (with a max_load_factor of 0.95) is filled
+ * up to the load factor and:
+ * - 'bytes/elem' is the total number of bytes allocated by the map divided by its size, overflow included.
+ * - 'overhead' is bytes/elem divided by sizeof(value_type).
+ * - 'overflow' is overflow_size() and 'ovf bytes/elem' the bytes allocated for the nodes of the overflow
+ *   list (std::list) or tree (std::map for tsl::hopscotch_sc_map) divided by the size of the map.
+ * The map may have grown before reaching the load factor if a neighborhood was full, 'load' is the actual
+ * load factor.
+ *
+ * The std::string keys are short enough to not allocate any memory.
+ *
+ * Usage: ./bench_memory [nb_buckets (power of two)]
+ */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+#include "hopscotch_sc_map.h"
+
+
+namespace {
+
+template<class Key>
+Key get_key(std::uint64_t counter);
+
+template<>
+std::int32_t get_key<std::int32_t>(std::uint64_t counter) {
+    return std::int32_t(bench::mix(counter));
+}
+
+template<>
+std::int64_t get_key<std::int64_t>(std::uint64_t counter) {
+    return std::int64_t(bench::mix(counter));
+}
+
+template<>
+std::string get_key<std::string>(std::uint64_t counter) {
+    return std::to_string(bench::mix(counter) % 1000000000000ULL);
+}
+
+const float load_factors[] = {0.25f, 0.5f, 0.75f, 0.9f};
+
+/*
+ * Bytes allocated by an empty map of nb_buckets buckets.
+ */
+template<class Map>
+std::size_t empty_map_allocated_bytes(std::size_t nb_buckets) {
+    bench::allocated_bytes() = 0;
+    Map map(nb_buckets);
+    
+    return bench::allocated_bytes();
+}
+
+template<class Map, unsigned int NeighborhoodSize>
+void bench_map(const char* config_name, std::size_t nb_buckets) {
+    using key_type = typename Map::key_type;
+    using value_type = typename Map::value_type;
+    
+    const double bytes_per_bucket = double(empty_map_allocated_bytes<Map>(2*nb_buckets) -
+                                           empty_map_allocated_bytes<Map>(nb_buckets))/double(nb_buckets);
+    const double padding_bytes = bytes_per_bucket*double(NeighborhoodSize - 1);
+    
+    for(float load_factor: load_factors) {
+        std::size_t overflow_bytes = 0;
+        
+        bench::allocated_bytes() = 0;
+        Map map(nb_buckets);
+        map.max_load_factor(0.95f);
+        
+        const std::size_t nb_elements = std::size_t(load_factor*float(nb_buckets));
+        for(std::uint64_t i = 0; map.size() < nb_elements; i++) {
+            const std::size_t nb_overflow_elements = map.overflow_size();
+            const std::size_t allocated_bytes_before_insert = bench::allocated_bytes();
+            
+            map.insert({get_key<key_type>(i), typename Map::mapped_type()});
+            if(map.overflow_size() != nb_overflow_elements) {
+                overflow_bytes += bench::allocated_bytes() - allocated_bytes_before_insert;
+            }
+        }
+        
+        const double bytes_per_element = double(bench::allocated_bytes())/double(map.size());
+        std::printf("%-36s %12.3f %9.0f %6.2f %6.2f %10.2f %8.2f %8zu %14.2f\n", config_name, bytes_per_bucket,
+                    padding_bytes, load_factor, map.load_factor(), bytes_per_element,
+                    bytes_per_element/double(sizeof(value_type)), map.overflow_size(),
+                    double(overflow_bytes)/double(map.size()));
+    }
+}
+
+template<class Key, class T>
+void bench_value_type(std::size_t nb_buckets) {
+    using hash = std::hash<Key>;
+    using key_equal = std::equal_to<Key>;
+    using allocator = bench::counting_allocator<std::pair<Key, T>>;
+    using sc_allocator = bench::counting_allocator<std::pair<const Key, T>>;
+    
+    const std::string prefix = std::string(std::is_same<Key, std::string>::value?"string":
+                                           (sizeof(Key) == 4)?"int32":"int64") +
+                               ((sizeof(T) == 4)?"/int32 ":"/int64 ");
+    
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 8>, 8>(
+        (prefix + "NS=8").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 30>, 30>(
+        (prefix + "NS=30").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 30, true>, 30>(
+        (prefix + "NS=30 StoreHash").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 62>, 62>(
+        (prefix + "NS=62").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 62, false,
+                                 tsl::power_of_two_growth_policy, tsl::split_bucket_layout>, 62>(
+        (prefix + "NS=62 split").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_map<Key, T, hash, key_equal, allocator, 62, false,
+                                 tsl::power_of_two_growth_policy, tsl::fingerprint_bucket_layout>, 62>(
+        (prefix + "NS=62 fingerprint").c_str(), nb_buckets);
+    bench_map<tsl::hopscotch_sc_map<Key, T, hash, key_equal, std::less<Key>, sc_allocator, 8>, 8>(
+        (prefix + "NS=8 sc_map").c_str(), nb_buckets);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::size_t nb_buckets = (argc > 1)?std::strtoull(argv[1], nullptr, 10):(1 << 20);
+    if(nb_buckets == 0 || (nb_buckets & (nb_buckets - 1)) != 0) {
+        std::fprintf(stderr, "nb_buckets must be a power of two.\n");
+        return 1;
+    }
+    
+    std::printf("%zu buckets. NS is NeighborhoodSize.\n", nb_buckets);
+    std::printf("%-36s %12s %9s %6s %6s %10s %8s %8s %14s\n", "config", "bytes/bucket", "padding", "target",
+                "load", "bytes/elem", "overhead", "overflow", "ovf bytes/elem");
+    
+    bench_value_type<std::int32_t, std::int32_t>(nb_buckets);
+    bench_value_type<std::int64_t, std::int64_t>(nb_buckets);
+    bench_value_type<std::string, std::int64_t>(nb_buckets);
+}
@@ -0,0 +1,143 @@
+#ifndef TSL_BENCH_UTILS_H
+#define TSL_BENCH_UTILS_H
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace bench {
+
+/*
+ * Finalizer of splitmix64, a bijection on 64 bits.
+ */
+inline std::uint64_t mix(std::uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+class timer {
+public:
+    timer(): m_start(std::chrono::high_resolution_clock::now()) {
+    }
+    
+    std::uint64_t elapsed_ns() const {
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count());
+    }
+    
+    /*
+     * Elapsed ns since the construction of the timer, divided by nb_operations.
+     */
+    double ns_per_operation(std::size_t nb_operations) const {
+        return double(elapsed_ns())/double(nb_operations);
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point m_start;
+};
+
+/*
+ * Value at the percentile (in [0, 100]) of values, reorders values.
+ */
+template<class T>
+T percentile(std::vector<T>& values, double percentile) {
+    if(values.empty()) {
+        return T();
+    }
+    
+    const std::size_t index = std::min(values.size() - 1, std::size_t(double(values.size())*percentile/100.0));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    
+    return values[index];
+}
+
+
+/*
+ * Bytes currently allocated through all the counting_allocator.
+ */
+inline std::size_t& allocated_bytes() {
+    static std::size_t bytes = 0;
+    return bytes;
+}
+
+/*
+ * Allocator counting the bytes it allocates in allocated_bytes(), all the rebinds share the same counter.
+ */
+template<typename T>
+class counting_allocator {
+public:
+    using value_type = T;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    
+    
+    template<typename U>
+    struct rebind {
+        using other = counting_allocator<U>;
+    };
+    
+    counting_allocator() = default;
+    counting_allocator(const counting_allocator&) = default;
+    
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&) {
+    }
+    
+    pointer allocate(size_type n, const void* /*hint*/ = 0) {
+        pointer ptr = static_cast<pointer>(std::malloc(n * sizeof(T)));
+        if(ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        
+        allocated_bytes() += n * sizeof(T);
+        return ptr;
+    }
+    
+    void deallocate(T* p, size_type n) {
+        allocated_bytes() -= n * sizeof(T);
+        std::free(p);
+    }
+    
+    size_type max_size() const noexcept {
+        return std::numeric_limits<size_type>::max()/sizeof(value_type);
+    }
+    
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+    
+    template<typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+};
+
+template <class T, class U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&) {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&) {
+    return false;
+}
+
+}
+
+#endif
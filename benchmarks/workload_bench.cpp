@@ -0,0 +1,269 @@
+/**
+ * Benchmark of tsl::hopscotch_map, tsl::hopscotch_map with tsl::prime_growth_policy, tsl::hopscotch_sc_map and
+ * std::unordered_map on the same traces of operations, modelled on real workloads:
+ *
+ * - 'zipf': lookups (90%) and updates (10%) of int64_t keys chosen with a Zipf distribution (s = 0.99),
+ *   a few keys get most of the operations as in a cache.
+ * - 'urls': lookups of URL-like std::string keys sharing long prefixes, half of them are not in the map.
+ * - 'monotonic_ids': inserts of increasing int64_t ids (as given by a database sequence) mixed with lookups
+ *   of recent ids.
+ * - 'churn': inserts of new int64_t keys and erases of the oldest ones, the size of the map stays the same
+ *   (sessions, connections, ...). Half of the operations are lookups.
+ *
+ * The first nb_keys keys of a trace are inserted before the measure, then the nb_operations operations of the
+ * trace are run once to measure the throughput and once more, on a new map, timing each operation to get the
+ * latency percentiles (which include the overhead of the clock, ~20 ns).
+ *
+ * The bytes per element are the bytes allocated by the container at the end of the trace divided by its size.
+ * The memory allocated by the std::string keys themselves is not counted.
+ *
+ * Usage: ./bench_workload [nb_keys] [nb_operations]
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+#include "hopscotch_sc_map.h"
+
+
+namespace {
+
+enum class operation_type { insert, find, erase };
+
+struct operation {
+    operation_type type;
+    std::size_t ikey;
+};
+
+template<class Key>
+struct trace {
+    const char* name;
+    std::vector<Key> keys;
+    std::size_t nb_initial_keys;
+    std::vector<operation> operations;
+};
+
+/*
+ * Generate ranks in [0, nb_items) following a Zipf distribution with exponent s, rank 0 being the most frequent.
+ */
+class zipf_distribution {
+public:
+    zipf_distribution(std::size_t nb_items, double s): m_cdf(nb_items) {
+        double sum = 0.0;
+        for(std::size_t i = 0; i < nb_items; i++) {
+            sum += 1.0/std::pow(double(i + 1), s);
+            m_cdf[i] = sum;
+        }
+        
+        for(double& cdf: m_cdf) {
+            cdf /= sum;
+        }
+    }
+    
+    template<class Generator>
+    std::size_t operator()(Generator& generator) {
+        const double value = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+        const auto it = std::lower_bound(m_cdf.begin(), m_cdf.end(), value);
+        
+        return std::min(std::size_t(std::distance(m_cdf.begin(), it)), m_cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> m_cdf;
+};
+
+trace<std::int64_t> zipf_trace(std::size_t nb_keys, std::size_t nb_operations) {
+    std::mt19937_64 generator(1);
+    zipf_distribution zipf(nb_keys, 0.99);
+    
+    trace<std::int64_t> zipf_trace{"zipf", {}, nb_keys, {}};
+    for(std::size_t i = 0; i < nb_keys; i++) {
+        zipf_trace.keys.push_back(std::int64_t(bench::mix(i)));
+    }
+    
+    for(std::size_t i = 0; i < nb_operations; i++) {
+        const operation_type type = (generator() % 10 == 0)?operation_type::insert:operation_type::find;
+        zipf_trace.operations.push_back({type, zipf(generator)});
+    }
+    
+    return zipf_trace;
+}
+
+trace<std::string> urls_trace(std::size_t nb_keys, std::size_t nb_operations) {
+    static const char* const domains[] = {"www.example.com", "static.example.org", "api.example.net",
+                                          "cdn.images.example.com"};
+    std::mt19937_64 generator(2);
+    
+    // The keys after the first nb_keys ones are not in the map
+    trace<std::string> urls_trace{"urls", {}, nb_keys, {}};
+    for(std::size_t i = 0; i < 2*nb_keys; i++) {
+        const std::uint64_t random = bench::mix(i);
+        urls_trace.keys.push_back(std::string("https://") + domains[random % 4] + "/articles/" +
+                                  std::to_string((random >> 8) % 1000) + "/item?id=" + std::to_string(i));
+    }
+    
+    for(std::size_t i = 0; i < nb_operations; i++) {
+        urls_trace.operations.push_back({operation_type::find, std::size_t(generator() % (2*nb_keys))});
+    }
+    
+    return urls_trace;
+}
+
+trace<std::int64_t> monotonic_ids_trace(std::size_t nb_keys, std::size_t nb_operations) {
+    std::mt19937_64 generator(3);
+    
+    trace<std::int64_t> ids_trace{"monotonic_ids", {}, nb_keys, {}};
+    for(std::size_t i = 0; i < nb_keys + nb_operations; i++) {
+        ids_trace.keys.push_back(std::int64_t(i));
+    }
+    
+    // Lookups of one of the last nb_keys/10 inserted ids
+    std::size_t nb_inserted_keys = nb_keys;
+    for(std::size_t i = 0; i < nb_operations; i++) {
+        if(generator() % 2 == 0) {
+            ids_trace.operations.push_back({operation_type::insert, nb_inserted_keys});
+            nb_inserted_keys++;
+        }
+        else {
+            const std::size_t nb_recent_keys = std::max(std::size_t(1), nb_keys/10);
+            ids_trace.operations.push_back({operation_type::find,
+                                            nb_inserted_keys - 1 - std::size_t(generator() % nb_recent_keys)});
+        }
+    }
+    
+    return ids_trace;
+}
+
+trace<std::int64_t> churn_trace(std::size_t nb_keys, std::size_t nb_operations) {
+    std::mt19937_64 generator(4);
+    
+    trace<std::int64_t> churn_trace{"churn", {}, nb_keys, {}};
+    for(std::size_t i = 0; i < nb_keys + nb_operations; i++) {
+        churn_trace.keys.push_back(std::int64_t(bench::mix(i)));
+    }
+    
+    // The keys in the map are the ones in [ifirst_key, ifirst_key + nb_keys)
+    std::size_t ifirst_key = 0;
+    while(churn_trace.operations.size() < nb_operations) {
+        if(generator() % 2 == 0) {
+            churn_trace.operations.push_back({operation_type::insert, ifirst_key + nb_keys});
+            churn_trace.operations.push_back({operation_type::erase, ifirst_key});
+            ifirst_key++;
+        }
+        else {
+            churn_trace.operations.push_back({operation_type::find, ifirst_key + std::size_t(generator() % nb_keys)});
+        }
+    }
+    
+    return churn_trace;
+}
+
+
+template<class Map, class Key>
+std::size_t run_operation(Map& map, const trace<Key>& trace, const operation& op) {
+    switch(op.type) {
+        case operation_type::insert:
+            map[trace.keys[op.ikey]] = std::int64_t(op.ikey);
+            return 1;
+        case operation_type::find:
+            return (map.find(trace.keys[op.ikey]) != map.end())?1:0;
+        case operation_type::erase:
+            return map.erase(trace.keys[op.ikey]);
+    }
+    
+    return 0;
+}
+
+template<class Map, class Key>
+void load_map(Map& map, const trace<Key>& trace) {
+    for(std::size_t i = 0; i < trace.nb_initial_keys; i++) {
+        map.insert({trace.keys[i], std::int64_t(i)});
+    }
+}
+
+template<class Map, class Key>
+void bench_map(const char* map_name, const trace<Key>& trace, std::size_t& checksum) {
+    double operations_per_second;
+    double bytes_per_element;
+    {
+        bench::allocated_bytes() = 0;
+        Map map;
+        load_map(map, trace);
+        
+        bench::timer timer;
+        for(const operation& op: trace.operations) {
+            checksum += run_operation(map, trace, op);
+        }
+        operations_per_second = 1e9/timer.ns_per_operation(trace.operations.size());
+        bytes_per_element = double(bench::allocated_bytes())/double(map.size());
+    }
+    
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(trace.operations.size());
+    {
+        Map map;
+        load_map(map, trace);
+        
+        for(const operation& op: trace.operations) {
+            bench::timer timer;
+            checksum += run_operation(map, trace, op);
+            latencies.push_back(timer.elapsed_ns());
+        }
+    }
+    
+    const std::uint64_t p50 = bench::percentile(latencies, 50.0);
+    const std::uint64_t p99 = bench::percentile(latencies, 99.0);
+    const std::uint64_t p999 = bench::percentile(latencies, 99.9);
+    const std::uint64_t max = *std::max_element(latencies.begin(), latencies.end());
+    
+    std::printf("%14s %26s %12.0f %10.1f %8llu %8llu %8llu %10llu\n", trace.name, map_name, operations_per_second,
+                bytes_per_element, static_cast<unsigned long long>(p50), static_cast<unsigned long long>(p99),
+                static_cast<unsigned long long>(p999), static_cast<unsigned long long>(max));
+}
+
+template<class Key>
+void bench_trace(const trace<Key>& trace, std::size_t& checksum) {
+    using value_type = std::pair<Key, std::int64_t>;
+    using const_value_type = std::pair<const Key, std::int64_t>;
+    
+    bench_map<tsl::hopscotch_map<Key, std::int64_t, std::hash<Key>, std::equal_to<Key>,
+                                 bench::counting_allocator<value_type>>>("hopscotch_map", trace, checksum);
+    bench_map<tsl::hopscotch_map<Key, std::int64_t, std::hash<Key>, std::equal_to<Key>,
+                                 bench::counting_allocator<value_type>, 62, false,
+                                 tsl::prime_growth_policy>>("hopscotch_map (prime)", trace, checksum);
+    bench_map<tsl::hopscotch_sc_map<Key, std::int64_t, std::hash<Key>, std::equal_to<Key>, std::less<Key>,
+                                    bench::counting_allocator<const_value_type>>>("hopscotch_sc_map", trace, checksum);
+    bench_map<std::unordered_map<Key, std::int64_t, std::hash<Key>, std::equal_to<Key>,
+                                 bench::counting_allocator<const_value_type>>>("std::unordered_map", trace, checksum);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::size_t nb_keys = (argc > 1)?std::strtoull(argv[1], nullptr, 10):500000;
+    const std::size_t nb_operations = (argc > 2)?std::strtoull(argv[2], nullptr, 10):2000000;
+    std::size_t checksum = 0;
+    
+    std::printf("%zu keys, %zu operations. Latencies in ns.\n", nb_keys, nb_operations);
+    std::printf("%14s %26s %12s %10s %8s %8s %8s %10s\n", "trace", "map", "ops/s", "bytes/elem",
+                "p50", "p99", "p99.9", "max");
+    
+    bench_trace(zipf_trace(nb_keys, nb_operations), checksum);
+    bench_trace(urls_trace(nb_keys, nb_operations), checksum);
+    bench_trace(monotonic_ids_trace(nb_keys, nb_operations), checksum);
+    bench_trace(churn_trace(nb_keys, nb_operations), checksum);
+    
+    std::printf("checksum: %zu\n", checksum);
+}
@@ -0,0 +1,350 @@
+/**
+ * Driver running the core workloads A to F of the Yahoo! Cloud Serving Benchmark (YCSB) against the maps
+ * of src/, on a generated keyspace:
+ *
+ * - A: 50% reads, 50% updates, zipfian.
+ * - B: 95% reads, 5% updates, zipfian.
+ * - C: 100% reads, zipfian.
+ * - D: 95% reads, 5% inserts, the reads favour the latest inserted records.
+ * - E: 95% scans of 1 to 100 records, 5% inserts, zipfian.
+ * - F: 50% reads, 50% read-modify-writes, zipfian.
+ *
+ * A record is an int64_t key (a bijective mix of the record number) mapped to 8 fields of 8 bytes.
+ * An update writes one field. The zipfian distribution is scrambled, the most frequent records are spread
+ * over the keyspace as in YCSB.
+ *
+ * tsl::hopscotch_map and tsl::hopscotch_sc_map are run by one thread, tsl::concurrent_hopscotch_map and
+ * tsl::sharded_hopscotch_map by nb_threads threads sharing the operations. A scan iterates over the map from
+ * the first record for the single-threaded maps and reads consecutive record numbers for the concurrent maps,
+ * which have no iterator.
+ *
+ * The nb_records records are inserted before each run and are not part of the measure.
+ *
+ * Usage: ./bench_ycsb [workloads (e.g. ACF, default ABCDEF)] [nb_records] [nb_operations] [nb_threads]
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+#include "concurrent_hopscotch_map.h"
+#include "hopscotch_map.h"
+#include "hopscotch_sc_map.h"
+#include "sharded_hopscotch_map.h"
+
+
+namespace {
+
+using record = std::array<std::uint64_t, 8>;
+
+std::int64_t key_for_record(std::uint64_t irecord) {
+    return std::int64_t(bench::mix(irecord));
+}
+
+record make_record(std::uint64_t irecord) {
+    record new_record;
+    new_record.fill(irecord);
+    
+    return new_record;
+}
+
+enum class distribution { zipfian, latest };
+
+struct workload {
+    char name;
+    double read_proportion;
+    double update_proportion;
+    double insert_proportion;
+    double scan_proportion;
+    double read_modify_write_proportion;
+    distribution request_distribution;
+};
+
+const workload workloads[] = {
+    {'A', 0.50, 0.50, 0.00, 0.00, 0.00, distribution::zipfian},
+    {'B', 0.95, 0.05, 0.00, 0.00, 0.00, distribution::zipfian},
+    {'C', 1.00, 0.00, 0.00, 0.00, 0.00, distribution::zipfian},
+    {'D', 0.95, 0.00, 0.05, 0.00, 0.00, distribution::latest},
+    {'E', 0.00, 0.00, 0.05, 0.95, 0.00, distribution::zipfian},
+    {'F', 0.50, 0.00, 0.00, 0.00, 0.50, distribution::zipfian},
+};
+
+const std::size_t MAX_SCAN_LENGTH = 100;
+
+/*
+ * Zipfian generator of YCSB (from "Quickly Generating Billion-Record Synthetic Databases", Gray et al.),
+ * return ranks in [0, nb_items) in constant time, rank 0 being the most frequent.
+ */
+class zipfian_generator {
+public:
+    explicit zipfian_generator(std::uint64_t nb_items, double theta = 0.99): m_nb_items(nb_items),
+                                                                             m_theta(theta),
+                                                                             m_alpha(1.0/(1.0 - theta)),
+                                                                             m_zetan(zeta(nb_items, theta))
+    {
+        m_eta = (1.0 - std::pow(2.0/double(nb_items), 1.0 - theta))/(1.0 - zeta(2, theta)/m_zetan);
+    }
+    
+    template<class Generator>
+    std::uint64_t operator()(Generator& generator) const {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+        const double uz = u*m_zetan;
+        
+        if(uz < 1.0) {
+            return 0;
+        }
+        
+        if(uz < 1.0 + std::pow(0.5, m_theta)) {
+            return 1;
+        }
+        
+        return std::min(m_nb_items - 1, std::uint64_t(double(m_nb_items)*std::pow(m_eta*u - m_eta + 1.0, m_alpha)));
+    }
+
+private:
+    static double zeta(std::uint64_t nb_items, double theta) {
+        double sum = 0.0;
+        for(std::uint64_t i = 1; i <= nb_items; i++) {
+            sum += 1.0/std::pow(double(i), theta);
+        }
+        
+        return sum;
+    }
+
+private:
+    std::uint64_t m_nb_items;
+    double m_theta;
+    double m_alpha;
+    double m_zetan;
+    double m_eta;
+};
+
+
+/*
+ * Operations of the single-threaded maps.
+ */
+template<class Map>
+class map_adapter {
+public:
+    static const bool CONCURRENT = false;
+    
+    bool read(std::int64_t key, record& record_out) const {
+        auto it = m_map.find(key);
+        if(it == m_map.end()) {
+            return false;
+        }
+        
+        record_out = it->second;
+        return true;
+    }
+    
+    void update(std::int64_t key, std::size_t ifield, std::uint64_t value) {
+        auto it = m_map.find(key);
+        if(it != m_map.end()) {
+            it.value()[ifield] = value;
+        }
+    }
+    
+    void insert(std::int64_t key, const record& new_record) {
+        m_map.insert({key, new_record});
+    }
+    
+    std::uint64_t scan(std::uint64_t ifirst_record, std::size_t nb_records) const {
+        std::uint64_t checksum = 0;
+        
+        auto it = m_map.find(key_for_record(ifirst_record));
+        for(std::size_t i = 0; i < nb_records && it != m_map.end(); i++, ++it) {
+            checksum += it->second[0];
+        }
+        
+        return checksum;
+    }
+
+private:
+    Map m_map;
+};
+
+/*
+ * Operations of the concurrent maps, tsl::concurrent_hopscotch_map and tsl::sharded_hopscotch_map.
+ */
+template<class Map>
+class concurrent_map_adapter {
+public:
+    static const bool CONCURRENT = true;
+    
+    bool read(std::int64_t key, record& record_out) const {
+        return m_map.find(key, record_out);
+    }
+    
+    void update(std::int64_t key, std::size_t ifield, std::uint64_t value) {
+        m_map.visit(key, [&](record& existing_record) { existing_record[ifield] = value; });
+    }
+    
+    void insert(std::int64_t key, const record& new_record) {
+        m_map.insert({key, new_record});
+    }
+    
+    std::uint64_t scan(std::uint64_t ifirst_record, std::size_t nb_records) const {
+        std::uint64_t checksum = 0;
+        
+        record scanned_record;
+        for(std::size_t i = 0; i < nb_records; i++) {
+            if(m_map.find(key_for_record(ifirst_record + i), scanned_record)) {
+                checksum += scanned_record[0];
+            }
+        }
+        
+        return checksum;
+    }
+
+private:
+    Map m_map;
+};
+
+
+/*
+ * Run nb_operations operations of the workload on the adapter, the record numbers of the inserts are taken
+ * from nb_inserted_records which is shared by all the threads.
+ */
+template<class Adapter>
+std::uint64_t run_operations(Adapter& adapter, const workload& load, const zipfian_generator& zipfian,
+                             std::uint64_t nb_records, std::atomic<std::uint64_t>& nb_inserted_records,
+                             std::size_t nb_operations, std::uint64_t seed)
+{
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<double> operation_distribution(0.0, 1.0);
+    std::uint64_t checksum = 0;
+    record read_record;
+    
+    auto next_record = [&]() {
+        if(load.request_distribution == distribution::latest) {
+            const std::uint64_t ilast_record = nb_inserted_records.load(std::memory_order_relaxed) - 1;
+            return ilast_record - std::min(ilast_record, zipfian(generator));
+        }
+        
+        return bench::mix(zipfian(generator)) % nb_records;
+    };
+    
+    for(std::size_t i = 0; i < nb_operations; i++) {
+        double operation = operation_distribution(generator);
+        
+        if((operation -= load.read_proportion) < 0) {
+            if(adapter.read(key_for_record(next_record()), read_record)) {
+                checksum += read_record[0];
+            }
+        }
+        else if((operation -= load.update_proportion) < 0) {
+            adapter.update(key_for_record(next_record()), std::size_t(generator() % read_record.size()), i);
+        }
+        else if((operation -= load.insert_proportion) < 0) {
+            const std::uint64_t irecord = nb_inserted_records.fetch_add(1, std::memory_order_relaxed);
+            adapter.insert(key_for_record(irecord), make_record(irecord));
+        }
+        else if((operation -= load.scan_proportion) < 0) {
+            checksum += adapter.scan(next_record(), 1 + std::size_t(generator() % MAX_SCAN_LENGTH));
+        }
+        else {
+            const std::int64_t key = key_for_record(next_record());
+            if(adapter.read(key, read_record)) {
+                adapter.update(key, 0, read_record[0] + 1);
+            }
+        }
+    }
+    
+    return checksum;
+}
+
+template<class Adapter>
+void bench_workload(const char* map_name, const workload& load, const zipfian_generator& zipfian,
+                    std::uint64_t nb_records, std::size_t nb_operations, std::size_t nb_threads,
+                    std::uint64_t& checksum)
+{
+    if(!Adapter::CONCURRENT) {
+        nb_threads = 1;
+    }
+    
+    std::unique_ptr<Adapter> adapter(new Adapter());
+    for(std::uint64_t irecord = 0; irecord < nb_records; irecord++) {
+        adapter->insert(key_for_record(irecord), make_record(irecord));
+    }
+    
+    std::atomic<std::uint64_t> nb_inserted_records(nb_records);
+    std::vector<std::uint64_t> checksums(nb_threads, 0);
+    std::vector<std::thread> threads;
+    
+    bench::timer timer;
+    for(std::size_t ithread = 1; ithread < nb_threads; ithread++) {
+        threads.emplace_back([&, ithread]() {
+            checksums[ithread] = run_operations(*adapter, load, zipfian, nb_records, nb_inserted_records,
+                                                nb_operations/nb_threads, ithread);
+        });
+    }
+    
+    checksums[0] = run_operations(*adapter, load, zipfian, nb_records, nb_inserted_records,
+                                  nb_operations - (nb_threads - 1)*(nb_operations/nb_threads), 0);
+    for(std::thread& thread: threads) {
+        thread.join();
+    }
+    const double operations_per_second = 1e9/timer.ns_per_operation(nb_operations);
+    
+    for(std::uint64_t thread_checksum: checksums) {
+        checksum += thread_checksum;
+    }
+    
+    std::printf("%8c %26s %7zu %12.0f\n", load.name, map_name, nb_threads, operations_per_second);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const std::string workload_names = (argc > 1)?argv[1]:"ABCDEF";
+    const std::uint64_t nb_records = (argc > 2)?std::strtoull(argv[2], nullptr, 10):1000000;
+    const std::size_t nb_operations = (argc > 3)?std::strtoull(argv[3], nullptr, 10):2000000;
+    const std::size_t nb_threads = (argc > 4)?std::strtoull(argv[4], nullptr, 10):
+                                              std::max(1u, std::thread::hardware_concurrency());
+    if(nb_records == 0 || nb_threads == 0) {
+        std::fprintf(stderr, "nb_records and nb_threads must be > 0.\n");
+        return 1;
+    }
+    
+    using hopscotch_map = tsl::hopscotch_map<std::int64_t, record>;
+    using hopscotch_sc_map = tsl::hopscotch_sc_map<std::int64_t, record>;
+    using concurrent_hopscotch_map = tsl::concurrent_hopscotch_map<std::int64_t, record>;
+    using sharded_hopscotch_map = tsl::sharded_hopscotch_map<std::int64_t, record>;
+    
+    const zipfian_generator zipfian(nb_records);
+    std::uint64_t checksum = 0;
+    
+    std::printf("%llu records, %zu operations.\n", static_cast<unsigned long long>(nb_records), nb_operations);
+    std::printf("%8s %26s %7s %12s\n", "workload", "map", "threads", "ops/s");
+    
+    for(const workload& load: workloads) {
+        if(workload_names.find(load.name) == std::string::npos) {
+            continue;
+        }
+        
+        bench_workload<map_adapter<hopscotch_map>>("hopscotch_map", load, zipfian, nb_records,
+                                                   nb_operations, nb_threads, checksum);
+        bench_workload<map_adapter<hopscotch_sc_map>>("hopscotch_sc_map", load, zipfian, nb_records,
+                                                      nb_operations, nb_threads, checksum);
+        bench_workload<concurrent_map_adapter<concurrent_hopscotch_map>>("concurrent_hopscotch_map", load, zipfian,
+                                                                         nb_records, nb_operations, nb_threads,
+                                                                         checksum);
+        bench_workload<concurrent_map_adapter<sharded_hopscotch_map>>("sharded_hopscotch_map", load, zipfian,
+                                                                      nb_records, nb_operations, nb_threads,
+                                                                      checksum);
+    }
+    
+    std::printf("checksum: %llu\n", static_cast<unsigned long long>(checksum));
+}
@@ -0,0 +1,1255 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_CONCURRENT_HOPSCOTCH_MAP_H
+#define TSL_CONCURRENT_HOPSCOTCH_MAP_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hopscotch_hash.h"
+
+
+/*
+ * The lookups of tsl::concurrent_hopscotch_map don't take any lock if Key and T are trivially copyable,
+ * unless TSL_HOPSCOTCH_NO_OPTIMISTIC_READS is defined (see concurrent_hopscotch_map).
+ */
+#ifdef TSL_HOPSCOTCH_NO_OPTIMISTIC_READS
+    #define TSL_HOPSCOTCH_OPTIMISTIC_READS_ENABLED false
+#else
+    #define TSL_HOPSCOTCH_OPTIMISTIC_READS_ENABLED true
+#endif
+
+
+namespace tsl {
+
+/**
+ * Hash map using the hopscotch hashing algorithm which can be accessed concurrently by multiple threads.
+ * 
+ * The bucket array is divided in segments of SEGMENT_SIZE buckets. Each segment is protected by one
+ * of the lock_count() locks of the map (the lock of a segment is its index modulo lock_count(), a power of two).
+ * As a value is always in the neighborhood of its bucket, an operation only locks the few segments
+ * it may read or modify:
+ *  - find, at, visit, count, contains and erase lock the segments of the neighborhood of the bucket of the key.
+ *  - insert, emplace, try_emplace and insert_or_assign lock the segments from the first bucket which may have
+ *    the bucket of the key in its neighborhood to the last bucket searched for an empty bucket. The empty
+ *    bucket is moved closer with the same displacements as tsl::hopscotch_map, which stay in these segments.
+ *  - clear, rehash, reserve, max_load_factor and the growth of the map on insert lock all the segments.
+ * The locks are always taken in increasing order, and the lock of the overflow list last, to avoid deadlocks.
+ * 
+ * The values can't be accessed outside of the locks, the map has no iterator. find and at copy the mapped
+ * value and visit calls a function on it while the locks are held.
+ * 
+ * If Key and T are trivially copyable, find, at, count, contains and the const visit are optimistic and don't
+ * take any lock. Each lock also has a version, odd while a thread holding the lock modifies its segments.
+ * A lookup reads the versions of the segments of the neighborhood, searches the neighborhood and copies
+ * the value without any lock, then checks that the versions didn't change. If they changed, because a value
+ * was inserted, displaced or erased in the neighborhood in the meantime, the lookup is done again
+ * (with the locks after a few tries or if the bucket has values in the overflow list). As a lookup may
+ * still be reading the bucket array replaced by a rehash, the rehash waits until the optimistic lookups
+ * which started before it have left the old bucket array before freeing it.
+ * Define TSL_HOPSCOTCH_NO_OPTIMISTIC_READS to always take the locks (e.g. to use ThreadSanitizer,
+ * the optimistic reads are data races validated afterwards).
+ * 
+ * The number of buckets is always a power of two (see tsl::power_of_two_growth_policy).
+ * 
+ * The Key and the value T must be nothrow move-constructible.
+ * 
+ * The size of the neighborhood (NeighborhoodSize) must be > 0 and <= 62 if StoreHash is false, <= 30 otherwise
+ * (see tsl::hopscotch_map).
+ * 
+ * If an exception is thrown during a rehash, the map is left unchanged. If the destructors of Key or T
+ * throw an exception, behaviour of the class is undefined.
+ */
+template<class Key,
+         class T,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>,
+         class Allocator = std::allocator<std::pair<Key, T>>,
+         unsigned int NeighborhoodSize = 62,
+         bool StoreHash = false>
+class concurrent_hopscotch_map: private Hash, private KeyEqual {
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    
+private:
+    using bucket = tsl::detail_hopscotch_hash::hopscotch_bucket<value_type, NeighborhoodSize, StoreHash>;
+    using buckets_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<bucket>;
+    using buckets_container_type = std::vector<bucket, buckets_allocator>;
+    using occupancy_bitmap = tsl::detail_hopscotch_hash::hopscotch_occupancy_bitmap<allocator_type>;
+    using overflow_container_type = std::list<value_type, allocator_type>;
+    
+    /*
+     * Bucket with the index of a value instead of the value, to compute the positions of the values
+     * in a new bucket array on rehash before moving any of them.
+     */
+    using index_bucket = tsl::detail_hopscotch_hash::hopscotch_bucket<std::size_t, NeighborhoodSize, false>;
+    using index_buckets_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<index_bucket>;
+    
+    /*
+     * Bucket array and mask to find the bucket of a hash, never modified once published in m_buckets_view
+     * so that a lookup reads both of them consistently with a single atomic load.
+     */
+    struct buckets_view {
+        const bucket* buckets;
+        std::size_t mask;
+    };
+    using buckets_views_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<buckets_view>;
+    
+    static_assert(std::is_nothrow_move_constructible<value_type>::value,
+                  "Key and T must be nothrow move-constructible.");
+    
+    
+    static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12*NeighborhoodSize;
+    static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    
+    /*
+     * A multiple of the number of bits in a word of the occupancy bitmap, two segments never share a word.
+     * It must also be >= NeighborhoodSize so that a lookup locks at most two segments.
+     */
+    static const std::size_t SEGMENT_SIZE = 256;
+    static_assert(SEGMENT_SIZE % occupancy_bitmap::NB_BITS_IN_WORD == 0, "");
+    static_assert(SEGMENT_SIZE >= NeighborhoodSize, "");
+    
+    /*
+     * Maximum number of segments locked by an insert.
+     */
+    static const std::size_t MAX_LOCKED_SEGMENTS =
+                (NeighborhoodSize - 1 + MAX_PROBES_FOR_EMPTY_BUCKET - 1)/SEGMENT_SIZE + 2;
+    
+    /*
+     * A lookup reads the buckets without any lock only if the torn copies of a key or a value that
+     * it may read while they are modified are harmless.
+     */
+    static const bool OPTIMISTIC_READS = TSL_HOPSCOTCH_OPTIMISTIC_READS_ENABLED && 
+                                         std::is_trivially_copyable<Key>::value && 
+                                         std::is_trivially_copyable<T>::value;
+    static const std::size_t MAX_OPTIMISTIC_READ_TRIES = 4;
+    
+    
+    /*
+     * Lock of the segments and its version, aligned on a cache line so that two threads using different locks
+     * don't write to the same cache line.
+     */
+    struct alignas(CACHE_LINE_SIZE) segment_mutex {
+        segment_mutex() noexcept: version(0) {
+        }
+        
+        std::mutex mutex;
+        
+        /*
+         * Incremented when a writer locks the mutex and when it unlocks it, odd while the segments are modified.
+         */
+        std::atomic<std::size_t> version;
+    };
+    
+    /*
+     * Number of optimistic lookups reading a bucket array for each parity of m_reader_epoch, aligned on a cache line.
+     * A thread always uses the same counter among the lock_count() counters of the map.
+     */
+    struct alignas(CACHE_LINE_SIZE) reader_counter {
+        reader_counter() noexcept {
+            nb_readers[0].store(0, std::memory_order_relaxed);
+            nb_readers[1].store(0, std::memory_order_relaxed);
+        }
+        
+        std::atomic<std::size_t> nb_readers[2];
+    };
+    
+    /*
+     * Fixed-size array of default-constructed U aligned on a cache line. Before C++17, operator new doesn't
+     * respect an alignment greater than alignof(std::max_align_t), the storage is over-allocated and aligned by hand.
+     */
+    template<class U>
+    class cache_aligned_array {
+    public:
+        explicit cache_aligned_array(std::size_t size): m_storage(new char[size*sizeof(U) + CACHE_LINE_SIZE - 1]),
+                                                        m_values(nullptr), m_size(0)
+        {
+            static_assert(std::is_nothrow_default_constructible<U>::value, "");
+            
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_storage.get());
+            const std::size_t offset = std::size_t((CACHE_LINE_SIZE - address % CACHE_LINE_SIZE) % CACHE_LINE_SIZE);
+            m_values = reinterpret_cast<U*>(m_storage.get() + offset);
+            
+            for(; m_size < size; m_size++) {
+                ::new (static_cast<void*>(m_values + m_size)) U();
+            }
+        }
+        
+        cache_aligned_array(const cache_aligned_array& other) = delete;
+        cache_aligned_array& operator=(const cache_aligned_array& other) = delete;
+        
+        ~cache_aligned_array() {
+            while(m_size > 0) {
+                m_size--;
+                m_values[m_size].~U();
+            }
+        }
+        
+        U& operator[](std::size_t i) const noexcept {
+            return m_values[i];
+        }
+        
+        U* get() const noexcept {
+            return m_values;
+        }
+        
+    private:
+        std::unique_ptr<char[]> m_storage;
+        U* m_values;
+        std::size_t m_size;
+    };
+    
+    /*
+     * Hold the locks of a range of segments until its destruction or a call to unlock. 
+     * If write is true, the segments may be modified and their versions are incremented on lock and unlock.
+     */
+    class segments_lock {
+    public:
+        explicit segments_lock(bool write) noexcept: m_mutexes(nullptr), m_nb_locked(0), m_write(write) {
+        }
+        
+        segments_lock(const segments_lock& other) = delete;
+        segments_lock& operator=(const segments_lock& other) = delete;
+        
+        ~segments_lock() {
+            unlock();
+        }
+        
+        void lock(segment_mutex* mutexes, std::size_t nb_mutexes, std::size_t first_segment, std::size_t last_segment) {
+            tsl_assert(m_nb_locked == 0);
+            tsl_assert(first_segment <= last_segment && last_segment - first_segment < MAX_LOCKED_SEGMENTS);
+            
+            std::size_t imutexes[MAX_LOCKED_SEGMENTS];
+            std::size_t nb_mutexes_to_lock = 0;
+            for(std::size_t isegment = first_segment; isegment <= last_segment; isegment++) {
+                imutexes[nb_mutexes_to_lock++] = mutex_for_segment(isegment, nb_mutexes);
+            }
+            
+            std::sort(imutexes, imutexes + nb_mutexes_to_lock);
+            nb_mutexes_to_lock = std::size_t(std::unique(imutexes, imutexes + nb_mutexes_to_lock) - imutexes);
+            
+            m_mutexes = mutexes;
+            for(std::size_t i = 0; i < nb_mutexes_to_lock; i++) {
+                m_mutexes[imutexes[i]].mutex.lock();
+                if(m_write) {
+                    begin_write(m_mutexes[imutexes[i]]);
+                }
+                
+                m_locked[m_nb_locked++] = imutexes[i];
+            }
+            
+            // The odd versions must be visible before any modification of the buckets
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        
+        void unlock() noexcept {
+            while(m_nb_locked > 0) {
+                m_nb_locked--;
+                if(m_write) {
+                    end_write(m_mutexes[m_locked[m_nb_locked]]);
+                }
+                
+                m_mutexes[m_locked[m_nb_locked]].mutex.unlock();
+            }
+        }
+    
+    private:
+        segment_mutex* m_mutexes;
+        std::size_t m_locked[MAX_LOCKED_SEGMENTS];
+        std::size_t m_nb_locked;
+        bool m_write;
+    };
+    
+    /*
+     * Hold all the locks of the segments until its destruction, the segments may be modified.
+     */
+    class all_segments_lock {
+    public:
+        all_segments_lock(segment_mutex* mutexes, std::size_t nb_mutexes): m_mutexes(mutexes), m_nb_locked(0) {
+            try {
+                for(; m_nb_locked < nb_mutexes; m_nb_locked++) {
+                    m_mutexes[m_nb_locked].mutex.lock();
+                    begin_write(m_mutexes[m_nb_locked]);
+                }
+            }
+            catch(...) {
+                unlock();
+                throw;
+            }
+            
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        
+        all_segments_lock(const all_segments_lock& other) = delete;
+        all_segments_lock& operator=(const all_segments_lock& other) = delete;
+        
+        ~all_segments_lock() {
+            unlock();
+        }
+    
+    private:
+        void unlock() noexcept {
+            while(m_nb_locked > 0) {
+                m_nb_locked--;
+                end_write(m_mutexes[m_nb_locked]);
+                m_mutexes[m_nb_locked].mutex.unlock();
+            }
+        }
+    
+    private:
+        segment_mutex* m_mutexes;
+        std::size_t m_nb_locked;
+    };
+    
+    /*
+     * Register an optimistic lookup in the counter of the current epoch until its destruction, the bucket array
+     * read by the lookup is not freed until then (see wait_for_readers).
+     * 
+     * If the epoch changed while the lookup registered itself, a rehash may already be waiting for the readers
+     * of the previous epoch and the lookup registers itself again in the new one.
+     */
+    class reader_guard {
+    public:
+        explicit reader_guard(const concurrent_hopscotch_map& map) noexcept {
+            reader_counter& counter = map.m_reader_counters[reader_counter_for_thread(map.m_nb_mutexes)];
+            while(true) {
+                const std::size_t epoch = map.m_reader_epoch.load(std::memory_order_seq_cst);
+                m_nb_readers = std::addressof(counter.nb_readers[epoch % 2]);
+                m_nb_readers->fetch_add(1, std::memory_order_seq_cst);
+                
+                if(map.m_reader_epoch.load(std::memory_order_seq_cst) == epoch) {
+                    return;
+                }
+                
+                m_nb_readers->fetch_sub(1, std::memory_order_release);
+            }
+        }
+        
+        reader_guard(const reader_guard& other) = delete;
+        reader_guard& operator=(const reader_guard& other) = delete;
+        
+        ~reader_guard() {
+            m_nb_readers->fetch_sub(1, std::memory_order_release);
+        }
+        
+    private:
+        std::atomic<std::size_t>* m_nb_readers;
+    };
+    
+    /*
+     * The number of locks is a power of two to avoid a division on each lookup.
+     */
+    static std::size_t round_up_lock_count(std::size_t lock_count) noexcept {
+        std::size_t rounded_lock_count = 1;
+        while(rounded_lock_count < lock_count) {
+            rounded_lock_count *= 2;
+        }
+        
+        return rounded_lock_count;
+    }
+    
+    static std::size_t mutex_for_segment(std::size_t isegment, std::size_t nb_mutexes) noexcept {
+        return isegment & (nb_mutexes - 1);
+    }
+    
+    /*
+     * The threads are assigned to the counters in a round-robin way on their first lookup.
+     */
+    static std::size_t reader_counter_for_thread(std::size_t nb_counters) noexcept {
+        static std::atomic<std::size_t> next_thread_index(0);
+        static thread_local const std::size_t thread_index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+        
+        return thread_index & (nb_counters - 1);
+    }
+    
+    /*
+     * Only called by the thread holding the mutex, which is the only one modifying the version.
+     */
+    static void begin_write(segment_mutex& mutex) noexcept {
+        mutex.version.store(mutex.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    static void end_write(segment_mutex& mutex) noexcept {
+        mutex.version.store(mutex.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    enum class optimistic_read_result {
+        found,
+        not_found,
+        retry,
+        use_locks
+    };
+    
+public:
+    static const size_type DEFAULT_INIT_BUCKETS_SIZE = 16;
+    static const size_type DEFAULT_LOCK_COUNT = 64;
+    static constexpr float DEFAULT_MAX_LOAD_FACTOR = (NeighborhoodSize <= 30)?0.8f:0.9f;
+    
+    
+    explicit concurrent_hopscotch_map(size_type bucket_count = DEFAULT_INIT_BUCKETS_SIZE,
+                                      size_type lock_count = DEFAULT_LOCK_COUNT,
+                                      const Hash& hash = Hash(),
+                                      const KeyEqual& equal = KeyEqual(),
+                                      const Allocator& alloc = Allocator()):
+                                            Hash(hash), KeyEqual(equal),
+                                            m_mutexes(round_up_lock_count(lock_count)),
+                                            m_nb_mutexes(round_up_lock_count(lock_count)),
+                                            m_growth_policy(bucket_count),
+                                            m_buckets(buckets_allocator(alloc)),
+                                            m_occupancy(alloc),
+                                            m_buckets_views(buckets_views_allocator(alloc)),
+                                            m_buckets_view(nullptr),
+                                            m_bucket_count(bucket_count),
+                                            m_reader_counters(round_up_lock_count(lock_count)),
+                                            m_reader_epoch(0),
+                                            m_overflow_elements(alloc),
+                                            m_nb_elements(0),
+                                            m_nb_overflow_elements(0)
+    {
+        m_buckets.resize(bucket_count + NeighborhoodSize - 1);
+        m_occupancy.resize(m_buckets.size());
+        m_buckets_views.push_back(buckets_view{m_buckets.data(), bucket_count - 1});
+        m_buckets_view.store(std::addressof(m_buckets_views.back()), std::memory_order_release);
+        
+        set_max_load_factor(DEFAULT_MAX_LOAD_FACTOR);
+    }
+    
+    concurrent_hopscotch_map(const concurrent_hopscotch_map& other) = delete;
+    concurrent_hopscotch_map& operator=(const concurrent_hopscotch_map& other) = delete;
+    
+    
+    allocator_type get_allocator() const {
+        return m_overflow_elements.get_allocator();
+    }
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    
+    size_type size() const noexcept {
+        return m_nb_elements.load(std::memory_order_relaxed);
+    }
+    
+    
+    /*
+     * Modifiers
+     */
+    void clear() {
+        all_segments_lock lock(m_mutexes.get(), m_nb_mutexes);
+        
+        for(auto& bucket: m_buckets) {
+            bucket.clear();
+        }
+        
+        m_occupancy.clear();
+        m_overflow_elements.clear();
+        m_nb_elements.store(0, std::memory_order_relaxed);
+        m_nb_overflow_elements.store(0, std::memory_order_relaxed);
+    }
+    
+    /**
+     * Return true if the value was inserted, false if there was already a value with the same key.
+     */
+    bool insert(const value_type& value) {
+        return insert_impl(value.first, [](value_type& /*value*/) {}, value);
+    }
+    
+    bool insert(value_type&& value) {
+        return insert_impl(value.first, [](value_type& /*value*/) {}, std::move(value));
+    }
+    
+    /**
+     * Construct the value with args and insert it, return true if the value was inserted.
+     */
+    template<class... Args>
+    bool emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+    
+    /**
+     * Insert the value constructed with the key and args if there is no value with the key in the map
+     * (args are not used otherwise). Return true if the value was inserted.
+     */
+    template<class... Args>
+    bool try_emplace(const key_type& key, Args&&... args) {
+        return insert_impl(key, [](value_type& /*value*/) {},
+                           std::piecewise_construct, std::forward_as_tuple(key),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    
+    /**
+     * Insert the value (key, obj) or assign obj to the mapped value if the key is already in the map.
+     * Return true if the value was inserted, false if it was assigned.
+     */
+    template<class M>
+    bool insert_or_assign(const key_type& key, M&& obj) {
+        return insert_impl(key, [&](value_type& value) { value.second = std::forward<M>(obj); },
+                           key, std::forward<M>(obj));
+    }
+    
+    /**
+     * Return the number of erased values (0 or 1).
+     */
+    size_type erase(const key_type& key) {
+        const std::size_t hash = hash_key(key);
+        
+        segments_lock lock(true);
+        const std::size_t ibucket_for_hash = lock_segments_for_hash(lock, hash, 0, NeighborhoodSize - 1);
+        
+        const std::size_t ibucket = find_in_buckets(key, hash, ibucket_for_hash);
+        if(ibucket < m_buckets.size()) {
+            erase_from_bucket(ibucket, ibucket_for_hash);
+            return 1;
+        }
+        
+        if(m_buckets[ibucket_for_hash].has_overflow()) {
+            std::lock_guard<std::mutex> overflow_lock(m_overflow_mutex);
+            
+            auto it_overflow = std::find_if(m_overflow_elements.begin(), m_overflow_elements.end(),
+                                            [&](const value_type& value) {
+                                                return compare_keys(key, value.first);
+                                            });
+            if(it_overflow != m_overflow_elements.end()) {
+                erase_from_overflow(it_overflow, ibucket_for_hash);
+                return 1;
+            }
+        }
+        
+        return 0;
+    }
+    
+    
+    /*
+     * Lookup
+     */
+    
+    /**
+     * Copy the value mapped to key in value_out and return true. Return false, and leave value_out unchanged,
+     * if the key is not in the map.
+     */
+    bool find(const key_type& key, T& value_out) const {
+        return find_and_call(key, [&](const value_type& value) { value_out = value.second; });
+    }
+    
+    /**
+     * Return a copy of the value mapped to key. Throw std::out_of_range if the key is not in the map.
+     */
+    T at(const key_type& key) const {
+        return at_impl(key, std::integral_constant<bool, OPTIMISTIC_READS>());
+    }
+    
+    /**
+     * Call function(T&) on the value mapped to key while the locks of its neighborhood are held and return true.
+     * Return false, without calling function, if the key is not in the map.
+     * 
+     * The function must not call any method of the map.
+     */
+    template<class Function>
+    bool visit(const key_type& key, Function function) {
+        return find_and_call_locked(key, hash_key(key), true, [&](const value_type& value) {
+            // The map is not const, it is the only place where the constness is dropped.
+            function(const_cast<value_type&>(value).second);
+        });
+    }
+    
+    /**
+     * Same as visit(const key_type&, Function) but call function(const T&). If the lookups are optimistic,
+     * function is called on a copy of the value without any lock held.
+     */
+    template<class Function>
+    bool visit(const key_type& key, Function function) const {
+        return find_and_call(key, [&](const value_type& value) { function(value.second); });
+    }
+    
+    size_type count(const key_type& key) const {
+        return find_and_call(key, [](const value_type& /*value*/) {})?1:0;
+    }
+    
+    bool contains(const key_type& key) const {
+        return count(key) != 0;
+    }
+    
+    
+    /*
+     * Bucket interface
+     */
+    size_type bucket_count() const {
+        return m_bucket_count.load(std::memory_order_acquire);
+    }
+    
+    size_type lock_count() const noexcept {
+        return m_nb_mutexes;
+    }
+    
+    
+    /*
+     *  Hash policy
+     */
+    float load_factor() const {
+        return float(size())/float(bucket_count());
+    }
+    
+    float max_load_factor() const {
+        // m_max_load_factor is only modified while all the segments are locked
+        segments_lock lock(false);
+        lock.lock(m_mutexes.get(), m_nb_mutexes, 0, 0);
+        
+        return m_max_load_factor;
+    }
+    
+    void max_load_factor(float ml) {
+        all_segments_lock lock(m_mutexes.get(), m_nb_mutexes);
+        set_max_load_factor(ml);
+    }
+    
+    void rehash(size_type count_) {
+        all_segments_lock lock(m_mutexes.get(), m_nb_mutexes);
+        
+        count_ = std::max(count_, size_type(std::ceil(float(size())/m_max_load_factor)));
+        rehash_impl(count_);
+    }
+    
+    void reserve(size_type count_) {
+        all_segments_lock lock(m_mutexes.get(), m_nb_mutexes);
+        
+        count_ = size_type(std::ceil(float(count_)/m_max_load_factor));
+        count_ = std::max(count_, size_type(std::ceil(float(size())/m_max_load_factor)));
+        rehash_impl(count_);
+    }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const {
+        return static_cast<const Hash&>(*this);
+    }
+    
+    key_equal key_eq() const {
+        return static_cast<const KeyEqual&>(*this);
+    }
+    
+private:
+    template<class K>
+    std::size_t hash_key(const K& key) const {
+        return Hash::operator()(key);
+    }
+    
+    template<class K1, class K2>
+    bool compare_keys(const K1& key1, const K2& key2) const {
+        return KeyEqual::operator()(key1, key2);
+    }
+    
+    std::size_t bucket_for_hash(std::size_t hash) const {
+        return m_growth_policy.bucket_for_hash(hash);
+    }
+    
+    /*
+     * Lock the segments of the buckets in [ibucket_for_hash - nb_buckets_before, ibucket_for_hash + nb_buckets_after]
+     * and return ibucket_for_hash, the bucket of the hash.
+     * 
+     * The bucket count only changes while all the segments are locked, if it changed once the segments
+     * are locked the buckets to lock are computed again.
+     */
+    std::size_t lock_segments_for_hash(segments_lock& lock, std::size_t hash,
+                                       std::size_t nb_buckets_before, std::size_t nb_buckets_after) const
+    {
+        while(true) {
+            const std::size_t mask = bucket_count() - 1;
+            const std::size_t ibucket_for_hash = hash & mask;
+            const std::size_t nb_buckets = mask + 1 + NeighborhoodSize - 1;
+            
+            const std::size_t ibucket_first = ibucket_for_hash - std::min(ibucket_for_hash, nb_buckets_before);
+            const std::size_t ibucket_last = std::min(ibucket_for_hash + nb_buckets_after, nb_buckets - 1);
+            lock.lock(m_mutexes.get(), m_nb_mutexes, ibucket_first/SEGMENT_SIZE, ibucket_last/SEGMENT_SIZE);
+            
+            if(bucket_count() == mask + 1) {
+                tsl_assert(ibucket_for_hash == bucket_for_hash(hash));
+                return ibucket_for_hash;
+            }
+            
+            lock.unlock();
+        }
+    }
+    
+    /*
+     * Call function(value) on the value with the key, or on a copy of it if the lookup is optimistic.
+     * Return false, without calling function, if the key is not in the map.
+     */
+    template<class K, class Function>
+    bool find_and_call(const K& key, Function function) const {
+        const std::size_t hash = hash_key(key);
+        
+        for(std::size_t itry = 0; OPTIMISTIC_READS && itry < MAX_OPTIMISTIC_READ_TRIES; itry++) {
+            const optimistic_read_result result = find_and_call_optimistic(key, hash, function, 
+                                                                           std::integral_constant<bool, OPTIMISTIC_READS>());
+            if(result == optimistic_read_result::found || result == optimistic_read_result::not_found) {
+                return result == optimistic_read_result::found;
+            }
+            else if(result == optimistic_read_result::use_locks) {
+                break;
+            }
+        }
+        
+        return find_and_call_locked(key, hash, false, function);
+    }
+    
+    /*
+     * Call function(value) on the value with the key while the locks of its neighborhood are held.
+     * Return false, without calling function, if the key is not in the map.
+     */
+    template<class K, class Function>
+    bool find_and_call_locked(const K& key, std::size_t hash, bool write, Function function) const {
+        segments_lock lock(write);
+        const std::size_t ibucket_for_hash = lock_segments_for_hash(lock, hash, 0, NeighborhoodSize - 1);
+        
+        const value_type* value = find_value(key, hash, ibucket_for_hash);
+        if(value == nullptr) {
+            return false;
+        }
+        
+        function(*value);
+        return true;
+    }
+    
+    /*
+     * Search the key in the neighborhood of its bucket without any lock. The value is copied before checking
+     * that no writer modified the segments of the neighborhood during the search, function is then called 
+     * on the copy. 
+     * 
+     * The bucket array is checked again once the versions are read, if a rehash completed since it was read
+     * the versions may already be the ones of the new bucket array. The lookup is registered in a reader_guard
+     * while it reads the bucket array, but not while function is called.
+     */
+    template<class K, class Function>
+    optimistic_read_result find_and_call_optimistic(const K& key, std::size_t hash, Function& function,
+                                                    std::true_type /*optimistic_reads*/) const 
+    {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type value_copy;
+        std::size_t ineighbor;
+        bool has_overflow;
+        {
+            reader_guard guard(*this);
+            
+            const buckets_view* view = m_buckets_view.load(std::memory_order_acquire);
+            const std::size_t ibucket_for_hash = hash & view->mask;
+            
+            const std::size_t ibucket_last = ibucket_for_hash + NeighborhoodSize - 1;
+            const segment_mutex& first_mutex = 
+                        m_mutexes[mutex_for_segment(ibucket_for_hash/SEGMENT_SIZE, m_nb_mutexes)];
+            const segment_mutex& last_mutex = m_mutexes[mutex_for_segment(ibucket_last/SEGMENT_SIZE, m_nb_mutexes)];
+            
+            const std::size_t first_version = first_mutex.version.load(std::memory_order_acquire);
+            const std::size_t last_version = last_mutex.version.load(std::memory_order_acquire);
+            if(first_version % 2 != 0 || last_version % 2 != 0 || 
+               view != m_buckets_view.load(std::memory_order_relaxed)) 
+            {
+                return optimistic_read_result::retry;
+            }
+            
+            
+            const bucket* bucket_for_hash = view->buckets + ibucket_for_hash;
+            has_overflow = bucket_for_hash->has_overflow();
+            ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+                bucket_for_hash->neighborhood_infos(),
+                [&](std::size_t ineighbor_candidate) {
+                    const bucket& candidate = bucket_for_hash[ineighbor_candidate];
+                    return (!StoreHash || candidate.bucket_hash_equal(hash)) &&
+                           compare_keys(candidate.value_storage()->first, key);
+                });
+            
+            if(ineighbor < NeighborhoodSize) {
+                std::memcpy(std::addressof(value_copy), bucket_for_hash[ineighbor].value_storage(), 
+                            sizeof(value_type));
+            }
+            
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(first_mutex.version.load(std::memory_order_relaxed) != first_version || 
+               last_mutex.version.load(std::memory_order_relaxed) != last_version) 
+            {
+                return optimistic_read_result::retry;
+            }
+        }
+        
+        
+        if(ineighbor < NeighborhoodSize) {
+            function(*reinterpret_cast<const value_type*>(std::addressof(value_copy)));
+            return optimistic_read_result::found;
+        }
+        
+        return has_overflow?optimistic_read_result::use_locks:optimistic_read_result::not_found;
+    }
+    
+    template<class K, class Function>
+    optimistic_read_result find_and_call_optimistic(const K& /*key*/, std::size_t /*hash*/, Function& /*function*/,
+                                                    std::false_type /*optimistic_reads*/) const 
+    {
+        return optimistic_read_result::use_locks;
+    }
+    
+    /*
+     * The value is copied in a storage by find_and_call as T may not be default-constructible. 
+     * T is trivially copyable if the reads are optimistic, the copy doesn't have to be destroyed.
+     */
+    template<class K>
+    T at_impl(const K& key, std::true_type /*optimistic_reads*/) const {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type value_copy;
+        const bool found = find_and_call(key, [&](const value_type& value) {
+            ::new (static_cast<void*>(std::addressof(value_copy))) T(value.second);
+        });
+        
+        if(!found) {
+            throw std::out_of_range("Couldn't find key.");
+        }
+        
+        return *reinterpret_cast<const T*>(std::addressof(value_copy));
+    }
+    
+    template<class K>
+    T at_impl(const K& key, std::false_type /*optimistic_reads*/) const {
+        const std::size_t hash = hash_key(key);
+        
+        segments_lock lock(false);
+        const std::size_t ibucket_for_hash = lock_segments_for_hash(lock, hash, 0, NeighborhoodSize - 1);
+        
+        const value_type* value = find_value(key, hash, ibucket_for_hash);
+        if(value == nullptr) {
+            throw std::out_of_range("Couldn't find key.");
+        }
+        
+        return value->second;
+    }
+    
+    /*
+     * Return a pointer to the value with the key or nullptr if none. The segments of the neighborhood
+     * of ibucket_for_hash must be locked.
+     * 
+     * The lock of the overflow list is released before returning a value of the list. The other threads
+     * may insert or erase values in the list but they can't erase this value while the segment
+     * of ibucket_for_hash is locked and the nodes of a std::list are not moved.
+     */
+    template<class K>
+    const value_type* find_value(const K& key, std::size_t hash, std::size_t ibucket_for_hash) const {
+        const std::size_t ibucket = find_in_buckets(key, hash, ibucket_for_hash);
+        if(ibucket < m_buckets.size()) {
+            return std::addressof(m_buckets[ibucket].value());
+        }
+        
+        if(m_buckets[ibucket_for_hash].has_overflow()) {
+            std::lock_guard<std::mutex> overflow_lock(m_overflow_mutex);
+            
+            for(const value_type& value: m_overflow_elements) {
+                if(compare_keys(key, value.first)) {
+                    return std::addressof(value);
+                }
+            }
+        }
+        
+        return nullptr;
+    }
+    
+    /*
+     * Return the bucket of the value with the key in the neighborhood of ibucket_for_hash,
+     * m_buckets.size() if none.
+     */
+    template<class K>
+    std::size_t find_in_buckets(const K& key, std::size_t hash, std::size_t ibucket_for_hash) const {
+        (void) hash; // Avoid warning of unused variable when StoreHash is false;
+        
+        const std::size_t ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+            m_buckets[ibucket_for_hash].neighborhood_infos(),
+            [&](std::size_t ineighbor_candidate) {
+                const bucket& candidate = m_buckets[ibucket_for_hash + ineighbor_candidate];
+                return (!StoreHash || candidate.bucket_hash_equal(hash)) &&
+                       compare_keys(candidate.value().first, key);
+            });
+        
+        return (ineighbor < NeighborhoodSize)?ibucket_for_hash + ineighbor:m_buckets.size();
+    }
+    
+    /*
+     * Insert the value constructed with value_type_args if there is no value with the key,
+     * otherwise call on_existing_value(value) on the value already in the map.
+     */
+    template<class K, class OnExistingValue, class... Args>
+    bool insert_impl(const K& key, OnExistingValue on_existing_value, Args&&... value_type_args) {
+        const std::size_t hash = hash_key(key);
+        
+        while(true) {
+            segments_lock lock(true);
+            const std::size_t ibucket_for_hash = lock_segments_for_hash(lock, hash, NeighborhoodSize - 1,
+                                                                        MAX_PROBES_FOR_EMPTY_BUCKET - 1);
+            const std::size_t mask = bucket_count() - 1;
+            
+            const value_type* value = find_value(key, hash, ibucket_for_hash);
+            if(value != nullptr) {
+                on_existing_value(const_cast<value_type&>(*value));
+                return false;
+            }
+            
+            if(size() - m_nb_overflow_elements.load(std::memory_order_relaxed) >= m_load_threshold) {
+                lock.unlock();
+                grow(mask);
+                continue;
+            }
+            
+            if(insert_in_neighborhood(ibucket_for_hash, hash, std::forward<Args>(value_type_args)...)) {
+                return true;
+            }
+            
+            // Load factor is too low or a rehash will not change the neighborhood, put the value in overflow list
+            if(size() < m_min_load_factor_rehash_threshold || !will_neighborhood_change_on_rehash(ibucket_for_hash)) {
+                std::lock_guard<std::mutex> overflow_lock(m_overflow_mutex);
+                insert_in_overflow(ibucket_for_hash, std::forward<Args>(value_type_args)...);
+                
+                return true;
+            }
+            
+            lock.unlock();
+            grow(mask);
+        }
+    }
+    
+    /*
+     * Insert the value in the neighborhood of ibucket_for_hash in m_buckets, see place_in_neighborhood.
+     * 
+     * Only the buckets in [ibucket_for_hash - NeighborhoodSize + 1, ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET)
+     * are read and modified.
+     */
+    template<class... Args>
+    bool insert_in_neighborhood(std::size_t ibucket_for_hash, std::size_t hash, Args&&... value_type_args) {
+        if(!place_in_neighborhood(m_buckets, m_occupancy, ibucket_for_hash, hash, 
+                                  std::forward<Args>(value_type_args)...)) 
+        {
+            return false;
+        }
+        
+        m_nb_elements.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    /*
+     * Find an empty bucket in [ibucket_for_hash, ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET) of buckets 
+     * and move it in the neighborhood of ibucket_for_hash to construct the value in it. 
+     * Return false if it's not possible.
+     */
+    template<class BucketsContainer, class... Args>
+    static bool place_in_neighborhood(BucketsContainer& buckets, occupancy_bitmap& occupancy, 
+                                      std::size_t ibucket_for_hash, std::size_t hash, Args&&... value_type_args) 
+    {
+        const std::size_t limit = std::min(ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET, buckets.size());
+        std::size_t ibucket_empty = occupancy.find_next_empty(ibucket_for_hash, limit);
+        
+        while(ibucket_empty < buckets.size()) {
+            if(ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
+                tsl_assert(ibucket_empty >= ibucket_for_hash);
+                buckets[ibucket_empty].set_value_of_empty_bucket(hash, std::forward<Args>(value_type_args)...);
+                occupancy.set(ibucket_empty);
+                buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_empty - ibucket_for_hash);
+                
+                return true;
+            }
+            
+            if(!tsl::detail_hopscotch_hash::swap_empty_bucket_closer<NeighborhoodSize>(buckets, occupancy,
+                                                                                      ibucket_empty))
+            {
+                break;
+            }
+        }
+        
+        return false;
+    }
+    
+    /*
+     * The lock of the overflow list must be held, unless all the segments are locked.
+     */
+    template<class... Args>
+    void insert_in_overflow(std::size_t ibucket_for_hash, Args&&... value_type_args) {
+        m_overflow_elements.emplace_back(std::forward<Args>(value_type_args)...);
+        
+        m_buckets[ibucket_for_hash].set_overflow(true);
+        m_nb_elements.fetch_add(1, std::memory_order_relaxed);
+        m_nb_overflow_elements.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void erase_from_bucket(std::size_t ibucket, std::size_t ibucket_for_hash) noexcept {
+        tsl_assert(ibucket >= ibucket_for_hash);
+        
+        m_buckets[ibucket].remove_value();
+        m_occupancy.reset(ibucket);
+        m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket - ibucket_for_hash);
+        m_nb_elements.fetch_sub(1, std::memory_order_relaxed);
+    }
+    
+    /*
+     * The lock of the overflow list must be held.
+     */
+    void erase_from_overflow(typename overflow_container_type::iterator pos, std::size_t ibucket_for_hash) {
+        m_overflow_elements.erase(pos);
+        m_nb_elements.fetch_sub(1, std::memory_order_relaxed);
+        m_nb_overflow_elements.fetch_sub(1, std::memory_order_relaxed);
+        
+        
+        // Check if we can remove the overflow flag
+        tsl_assert(m_buckets[ibucket_for_hash].has_overflow());
+        for(const value_type& value: m_overflow_elements) {
+            if(bucket_for_hash(hash_key(value.first)) == ibucket_for_hash) {
+                return;
+            }
+        }
+        
+        m_buckets[ibucket_for_hash].set_overflow(false);
+    }
+    
+    /*
+     * Return true if a rehash will change the position of a key-value in the neighborhood of
+     * ibucket_neighborhood_check. In this case a rehash is needed instead of puting the value in overflow list.
+     */
+    bool will_neighborhood_change_on_rehash(std::size_t ibucket_neighborhood_check) const {
+        const std::size_t expand_mask = m_growth_policy.next_bucket_count() - 1;
+        
+        for(std::size_t ibucket = ibucket_neighborhood_check;
+            ibucket < m_buckets.size() && (ibucket - ibucket_neighborhood_check) < NeighborhoodSize;
+            ++ibucket)
+        {
+            tsl_assert(!m_buckets[ibucket].empty());
+            
+            const std::size_t hash = StoreHash?m_buckets[ibucket].truncated_bucket_hash():
+                                               hash_key(m_buckets[ibucket].value().first);
+            if(bucket_for_hash(hash) != (hash & expand_mask)) {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    /*
+     * Double the bucket count, unless another thread already grew the map since the bucket count was mask + 1.
+     */
+    void grow(std::size_t mask) {
+        all_segments_lock lock(m_mutexes.get(), m_nb_mutexes);
+        
+        if(bucket_count() == mask + 1) {
+            rehash_impl(m_growth_policy.next_bucket_count());
+        }
+    }
+    
+    /*
+     * All the segments must be locked.
+     * 
+     * The new bucket array is filled before replacing m_buckets so that an exception leaves the map unchanged.
+     * The hashes of the values are computed and the positions of the values in the new buckets are found, 
+     * with the same displacements as an insertion, on an array of indexes of the values. The values which 
+     * don't fit in their neighborhood are then moved to new nodes of the overflow list, the only allocations 
+     * needing the values, and moved back if one of them throws. The other values, nothrow move-constructible, 
+     * are finally moved to the new buckets.
+     * 
+     * Nothing is done if the bucket count doesn't change.
+     */
+    void rehash_impl(size_type count_) {
+        tsl::power_of_two_growth_policy new_growth_policy(count_);
+        if(count_ == bucket_count()) {
+            return;
+        }
+        
+        std::vector<std::size_t> ibuckets;
+        std::vector<std::size_t> hashes;
+        ibuckets.reserve(size() - m_nb_overflow_elements.load(std::memory_order_relaxed));
+        hashes.reserve(ibuckets.capacity());
+        for(std::size_t ibucket = m_occupancy.find_next_occupied(0); ibucket < m_buckets.size();
+            ibucket = m_occupancy.find_next_occupied(ibucket + 1))
+        {
+            ibuckets.push_back(ibucket);
+            hashes.push_back(StoreHash?m_buckets[ibucket].truncated_bucket_hash():
+                                       hash_key(m_buckets[ibucket].value().first));
+        }
+        
+        std::vector<std::size_t> overflow_hashes;
+        overflow_hashes.reserve(m_nb_overflow_elements.load(std::memory_order_relaxed));
+        for(const value_type& value: m_overflow_elements) {
+            overflow_hashes.push_back(hash_key(value.first));
+        }
+        
+        
+        std::vector<index_bucket, index_buckets_allocator> index_buckets(count_ + NeighborhoodSize - 1, 
+                                                                         index_bucket(),
+                                                                         index_buckets_allocator(get_allocator()));
+        occupancy_bitmap new_occupancy(get_allocator());
+        new_occupancy.resize(index_buckets.size());
+        
+        std::vector<std::size_t> overflow_ivalues;
+        for(std::size_t ivalue = 0; ivalue < hashes.size(); ivalue++) {
+            if(!place_in_neighborhood(index_buckets, new_occupancy, new_growth_policy.bucket_for_hash(hashes[ivalue]), 
+                                      hashes[ivalue], ivalue)) 
+            {
+                overflow_ivalues.push_back(ivalue);
+            }
+        }
+        
+        buckets_container_type new_buckets(m_buckets.get_allocator());
+        new_buckets.resize(index_buckets.size());
+        m_buckets_views.push_back(buckets_view{new_buckets.data(), count_ - 1});
+        
+        overflow_container_type new_overflow_elements(get_allocator());
+        try {
+            for(const std::size_t ivalue: overflow_ivalues) {
+                new_overflow_elements.emplace_back(std::move(m_buckets[ibuckets[ivalue]].value()));
+            }
+        }
+        catch(...) {
+            auto it_overflow = new_overflow_elements.begin();
+            for(std::size_t i = 0; i < new_overflow_elements.size(); i++, ++it_overflow) {
+                bucket& old_bucket = m_buckets[ibuckets[overflow_ivalues[i]]];
+                old_bucket.remove_value();
+                old_bucket.set_value_of_empty_bucket(hashes[overflow_ivalues[i]], std::move(*it_overflow));
+            }
+            
+            m_buckets_views.pop_back();
+            throw;
+        }
+        
+        
+        // Nothing can throw below
+        for(std::size_t ibucket = new_occupancy.find_next_occupied(0); ibucket < new_buckets.size();
+            ibucket = new_occupancy.find_next_occupied(ibucket + 1))
+        {
+            const std::size_t ivalue = index_buckets[ibucket].value();
+            const std::size_t ibucket_for_hash = new_growth_policy.bucket_for_hash(hashes[ivalue]);
+            
+            new_buckets[ibucket].set_value_of_empty_bucket(hashes[ivalue], 
+                                                           std::move(m_buckets[ibuckets[ivalue]].value()));
+            new_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket - ibucket_for_hash);
+        }
+        
+        for(const std::size_t hash: overflow_hashes) {
+            new_buckets[new_growth_policy.bucket_for_hash(hash)].set_overflow(true);
+        }
+        for(const std::size_t ivalue: overflow_ivalues) {
+            new_buckets[new_growth_policy.bucket_for_hash(hashes[ivalue])].set_overflow(true);
+        }
+        m_overflow_elements.splice(m_overflow_elements.end(), new_overflow_elements);
+        m_nb_overflow_elements.fetch_add(overflow_ivalues.size(), std::memory_order_relaxed);
+        
+        m_buckets.swap(new_buckets);
+        m_occupancy.swap(new_occupancy);
+        m_growth_policy = new_growth_policy;
+        m_buckets_view.store(std::addressof(m_buckets_views.back()), std::memory_order_release);
+        m_bucket_count.store(count_, std::memory_order_release);
+        set_max_load_factor(m_max_load_factor);
+        
+        // The old buckets, now in new_buckets, are freed when leaving the function
+        if(OPTIMISTIC_READS) {
+            wait_for_readers();
+            m_buckets_views.erase(m_buckets_views.begin(), std::prev(m_buckets_views.end()));
+        }
+    }
+    
+    /*
+     * Start a new epoch and wait until the optimistic lookups registered in the previous one are done. 
+     * A lookup registered in the new epoch reads the bucket array published before the epoch changed.
+     * 
+     * All the segments must be locked, so that there is only one thread changing the epoch at a time.
+     * A lookup doesn't take any lock while it is registered, it can't wait for the rehash.
+     */
+    void wait_for_readers() {
+        const std::size_t epoch = m_reader_epoch.load(std::memory_order_relaxed);
+        m_reader_epoch.store(epoch + 1, std::memory_order_seq_cst);
+        
+        for(std::size_t icounter = 0; icounter < m_nb_mutexes; icounter++) {
+            while(m_reader_counters[icounter].nb_readers[epoch % 2].load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    
+    void set_max_load_factor(float ml) {
+        m_max_load_factor = ml;
+        m_load_threshold = size_type(float(bucket_count())*m_max_load_factor);
+        m_min_load_factor_rehash_threshold = size_type(float(bucket_count())*MIN_LOAD_FACTOR_FOR_REHASH);
+    }
+    
+private:
+    cache_aligned_array<segment_mutex> m_mutexes;
+    std::size_t m_nb_mutexes;
+    
+    /*
+     * Only modified while all the segments are locked. m_buckets_view points to the view of the data of m_buckets
+     * and of the mask of m_growth_policy, which can be read without any lock, as m_bucket_count. The views of
+     * the replaced bucket arrays are erased once no optimistic lookup is reading them.
+     */
+    tsl::power_of_two_growth_policy m_growth_policy;
+    buckets_container_type m_buckets;
+    occupancy_bitmap m_occupancy;
+    std::list<buckets_view, buckets_views_allocator> m_buckets_views;
+    std::atomic<const buckets_view*> m_buckets_view;
+    std::atomic<size_type> m_bucket_count;
+    
+    /*
+     * Optimistic lookups in progress, one counter per lock (see reader_guard and wait_for_readers).
+     */
+    cache_aligned_array<reader_counter> m_reader_counters;
+    std::atomic<std::size_t> m_reader_epoch;
+    
+    overflow_container_type m_overflow_elements;
+    mutable std::mutex m_overflow_mutex;
+    
+    std::atomic<size_type> m_nb_elements;
+    std::atomic<size_type> m_nb_overflow_elements;
+    
+    float m_max_load_factor;
+    size_type m_load_threshold;
+    size_type m_min_load_factor_rehash_threshold;
+};
+
+} // end namespace tsl
+
+#endif
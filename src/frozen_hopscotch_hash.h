@@ -0,0 +1,594 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_FROZEN_HOPSCOTCH_HASH_H
+#define TSL_FROZEN_HOPSCOTCH_HASH_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hopscotch_hash.h"
+
+
+namespace tsl {
+
+namespace detail_frozen_hopscotch_hash {
+
+/*
+ * Immutable hash table built at once from all its values, see tsl::frozen_hopscotch_map.
+ * 
+ * The buckets are the same as the ones of a hopscotch_hash with the interleaved layout and without stored hash,
+ * but the values are placed knowing all of them instead of one insertion at a time. The values are sorted
+ * by their bucket for hash and each one is put in the first empty bucket after its bucket for hash
+ * (see place_values), which minimizes both the sum and the maximum of the offsets of the values
+ * in their neighborhood. The bucket count is the smallest one of the GrowthPolicy for which all the values
+ * fit in their neighborhood.
+ * 
+ * The values which still don't fit (only with a lot of equal hashes) are stored in a vector sorted by hash.
+ * There is no occupancy bitmap, no load factor and no overflow list, nothing which is only needed to modify
+ * the table.
+ */
+template<class ValueType,
+         class KeySelect,
+         class ValueSelect,
+         class Hash,
+         class KeyEqual,
+         class Allocator,
+         unsigned int NeighborhoodSize,
+         class GrowthPolicy>
+class frozen_hopscotch_hash: private Hash, private KeyEqual, private GrowthPolicy {
+private:
+    template<typename U>
+    using has_mapped_type = typename std::integral_constant<bool, !std::is_same<U, void>::value>;
+    
+    using bucket = tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize, false>;
+    using buckets_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<bucket>;
+    using buckets_container_type = std::vector<bucket, buckets_allocator>;
+    
+    using overflow_container_type = std::vector<ValueType, Allocator>;
+    using hashes_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::size_t>;
+    using hashes_container_type = std::vector<std::size_t, hashes_allocator>;
+    
+public:
+    class frozen_hopscotch_iterator;
+    
+    using key_type = typename KeySelect::key_type;
+    using value_type = ValueType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using pointer = const value_type*;
+    using const_pointer = const value_type*;
+    using iterator = frozen_hopscotch_iterator;
+    using const_iterator = frozen_hopscotch_iterator;
+    
+    
+    /**
+     * The iterator goes through the buckets, then through the overflow values.
+     * There is no non-const iterator, the values can't be modified.
+     */
+    class frozen_hopscotch_iterator {
+        friend class frozen_hopscotch_hash;
+    private:
+        using iterator_bucket = typename buckets_container_type::const_iterator;
+        using iterator_overflow = typename overflow_container_type::const_iterator;
+        
+        frozen_hopscotch_iterator(iterator_bucket buckets_iterator, iterator_bucket buckets_end_iterator,
+                                  iterator_overflow overflow_iterator) noexcept:
+            m_buckets_iterator(buckets_iterator), m_buckets_end_iterator(buckets_end_iterator),
+            m_overflow_iterator(overflow_iterator)
+        {
+        }
+    
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const typename frozen_hopscotch_hash::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type&;
+        using pointer = value_type*;
+        
+        
+        frozen_hopscotch_iterator() noexcept {
+        }
+        
+        const typename frozen_hopscotch_hash::key_type& key() const {
+            return KeySelect()(**this);
+        }
+        
+        template<class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+        const typename U::value_type& value() const {
+            return U()(**this);
+        }
+        
+        reference operator*() const {
+            if(m_buckets_iterator != m_buckets_end_iterator) {
+                return m_buckets_iterator->value();
+            }
+            
+            return *m_overflow_iterator;
+        }
+        
+        pointer operator->() const {
+            return std::addressof(**this);
+        }
+        
+        frozen_hopscotch_iterator& operator++() {
+            if(m_buckets_iterator == m_buckets_end_iterator) {
+                ++m_overflow_iterator;
+                return *this;
+            }
+            
+            do {
+                ++m_buckets_iterator;
+            } while(m_buckets_iterator != m_buckets_end_iterator && m_buckets_iterator->empty());
+            
+            return *this;
+        }
+        
+        frozen_hopscotch_iterator operator++(int) {
+            frozen_hopscotch_iterator tmp(*this);
+            ++*this;
+            
+            return tmp;
+        }
+        
+        friend bool operator==(const frozen_hopscotch_iterator& lhs, const frozen_hopscotch_iterator& rhs) {
+            return lhs.m_buckets_iterator == rhs.m_buckets_iterator &&
+                   lhs.m_overflow_iterator == rhs.m_overflow_iterator;
+        }
+        
+        friend bool operator!=(const frozen_hopscotch_iterator& lhs, const frozen_hopscotch_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+    
+    private:
+        iterator_bucket m_buckets_iterator;
+        iterator_bucket m_buckets_end_iterator;
+        iterator_overflow m_overflow_iterator;
+    };
+    
+    
+public:
+    /*
+     * Build the table from the values of [first, last). If multiple values have equivalent keys,
+     * only the first one is kept.
+     */
+    template<class InputIt>
+    frozen_hopscotch_hash(InputIt first, InputIt last, const Hash& hash, const KeyEqual& equal,
+                          const Allocator& alloc):
+                                    frozen_hopscotch_hash(placement(first, last, hash, equal, alloc), hash, equal,
+                                                          alloc)
+    {
+    }
+    
+    
+    /*
+     * Iterators
+     */
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+    
+    const_iterator cbegin() const noexcept {
+        auto first_bucket = m_buckets.cbegin();
+        while(first_bucket != m_buckets.cend() && first_bucket->empty()) {
+            ++first_bucket;
+        }
+        
+        return const_iterator(first_bucket, m_buckets.cend(), m_overflow_values.cbegin());
+    }
+    
+    const_iterator end() const noexcept {
+        return cend();
+    }
+    
+    const_iterator cend() const noexcept {
+        return const_iterator(m_buckets.cend(), m_buckets.cend(), m_overflow_values.cend());
+    }
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const noexcept {
+        return m_nb_elements == 0;
+    }
+    
+    size_type size() const noexcept {
+        return m_nb_elements;
+    }
+    
+    
+    /*
+     * Lookup
+     */
+    template<class K, class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    const typename U::value_type& at(const K& key) const {
+        return at(key, hash_key(key));
+    }
+    
+    template<class K, class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    const typename U::value_type& at(const K& key, std::size_t hash) const {
+        const const_iterator it = find(key, hash);
+        if(it == cend()) {
+            throw std::out_of_range("Couldn't find key.");
+        }
+        
+        return it.value();
+    }
+    
+    template<class K>
+    size_type count(const K& key) const {
+        return count(key, hash_key(key));
+    }
+    
+    template<class K>
+    size_type count(const K& key, std::size_t hash) const {
+        return (find(key, hash) != cend())?1:0;
+    }
+    
+    template<class K>
+    const_iterator find(const K& key) const {
+        return find(key, hash_key(key));
+    }
+    
+    template<class K>
+    const_iterator find(const K& key, std::size_t hash) const {
+        const auto it_bucket = m_buckets.cbegin() + bucket_for_hash(hash);
+        
+        // Same lookup as hopscotch_hash::find_in_buckets
+        const std::size_t ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+            it_bucket->neighborhood_infos(),
+            [&](std::size_t ineighbor_candidate) {
+                return compare_keys(KeySelect()(it_bucket[difference_type(ineighbor_candidate)].value()), key);
+            });
+        
+        if(ineighbor < NeighborhoodSize) {
+            return const_iterator(it_bucket + difference_type(ineighbor), m_buckets.cend(),
+                                  m_overflow_values.cbegin());
+        }
+        
+        if(it_bucket->has_overflow()) {
+            return find_in_overflow(key, hash);
+        }
+        
+        return cend();
+    }
+    
+    template<class K>
+    bool contains(const K& key) const {
+        return contains(key, hash_key(key));
+    }
+    
+    template<class K>
+    bool contains(const K& key, std::size_t hash) const {
+        return count(key, hash) != 0;
+    }
+    
+    
+    /*
+     * Bucket interface
+     */
+    size_type bucket_count() const {
+        return m_bucket_count;
+    }
+    
+    
+    /*
+     *  Hash policy
+     */
+    float load_factor() const {
+        return float(m_nb_elements)/float(bucket_count());
+    }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const {
+        return static_cast<const Hash&>(*this);
+    }
+    
+    key_equal key_eq() const {
+        return static_cast<const KeyEqual&>(*this);
+    }
+    
+    allocator_type get_allocator() const {
+        return m_overflow_values.get_allocator();
+    }
+    
+    
+    /*
+     * Other
+     */
+    size_type overflow_size() const noexcept {
+        return m_overflow_values.size();
+    }
+    
+    /*
+     * Sum of the offsets of the values in the buckets from their bucket for hash.
+     */
+    size_type total_neighbor_offset() const noexcept {
+        return m_total_neighbor_offset;
+    }
+    
+private:
+    /*
+     * Values and their position in the buckets, computed before the construction of the table
+     * as the GrowthPolicy must be constructed with the final bucket count.
+     */
+    class placement {
+    public:
+        template<class InputIt>
+        placement(InputIt first, InputIt last, const Hash& hash, const KeyEqual& equal, const Allocator& alloc):
+                    m_values(first, last, alloc), m_nb_overflow_values(0), m_total_neighbor_offset(0)
+        {
+            m_hashes.reserve(m_values.size());
+            for(const ValueType& value: m_values) {
+                m_hashes.push_back(hash(KeySelect()(value)));
+            }
+            remove_duplicates(equal);
+            
+            // Try the bucket counts of the GrowthPolicy in increasing order, in steps of about 1/16,
+            // until all the values fit in their neighborhood or the load factor becomes too low. 
+            // A bigger bucket count may not reduce the number of values which don't fit, the placement
+            // of the next one can still be better. If some values never fit (a lot of equal hashes), 
+            // the smallest bucket count with the fewest values which don't fit is kept.
+            size_type bucket_count = std::max(size_type(1), size_type(m_values.size()));
+            place_values(bucket_count);
+            
+            size_type best_bucket_count = bucket_count;
+            size_type best_nb_overflow_values = m_nb_overflow_values;
+            while(m_nb_overflow_values > 0 &&
+                  float(m_values.size()) >= float(bucket_count)*MIN_LOAD_FACTOR_FOR_GROWTH)
+            {
+                bucket_count = bucket_count + bucket_count/16 + 1;
+                place_values(bucket_count);
+                
+                if(m_nb_overflow_values < best_nb_overflow_values) {
+                    best_bucket_count = bucket_count;
+                    best_nb_overflow_values = m_nb_overflow_values;
+                }
+            }
+            
+            if(bucket_count != best_bucket_count) {
+                place_values(best_bucket_count);
+            }
+        }
+        
+        /*
+         * Remove the values with a key equivalent to the key of a previous value.
+         */
+        void remove_duplicates(const KeyEqual& equal) {
+            std::vector<std::size_t> indexes(m_values.size());
+            for(std::size_t i = 0; i < indexes.size(); i++) {
+                indexes[i] = i;
+            }
+            std::stable_sort(indexes.begin(), indexes.end(), [&](std::size_t lhs, std::size_t rhs) {
+                return m_hashes[lhs] < m_hashes[rhs];
+            });
+            
+            std::vector<bool> duplicates(m_values.size(), false);
+            bool has_duplicates = false;
+            for(std::size_t i = 0; i < indexes.size(); i++) {
+                for(std::size_t j = i + 1; j < indexes.size() && m_hashes[indexes[j]] == m_hashes[indexes[i]]; j++) {
+                    if(!duplicates[indexes[j]] &&
+                       equal(KeySelect()(m_values[indexes[i]]), KeySelect()(m_values[indexes[j]])))
+                    {
+                        duplicates[indexes[j]] = true;
+                        has_duplicates = true;
+                    }
+                }
+            }
+            
+            if(!has_duplicates) {
+                return;
+            }
+            
+            std::size_t ikept = 0;
+            for(std::size_t i = 0; i < m_values.size(); i++) {
+                if(!duplicates[i]) {
+                    if(ikept != i) {
+                        m_values[ikept] = std::move(m_values[i]);
+                        m_hashes[ikept] = m_hashes[i];
+                    }
+                    ikept++;
+                }
+            }
+            m_values.erase(m_values.begin() + difference_type(ikept), m_values.end());
+            m_hashes.resize(ikept);
+        }
+        
+        /*
+         * Sort the values by bucket for hash and put each one in the first empty bucket after its bucket
+         * for hash. As the buckets are filled in order, it's the bucket after the previous value or
+         * the bucket for hash itself. A value which can't be put in its neighborhood goes in the overflow values
+         * and doesn't take any bucket.
+         * 
+         * bucket_count is updated by the GrowthPolicy.
+         */
+        void place_values(size_type& bucket_count) {
+            const GrowthPolicy growth_policy(bucket_count);
+            m_bucket_count = bucket_count;
+            
+            m_buckets_for_hash.resize(m_values.size());
+            m_order.resize(m_values.size());
+            for(std::size_t i = 0; i < m_values.size(); i++) {
+                m_buckets_for_hash[i] = growth_policy.bucket_for_hash(m_hashes[i]);
+                m_order[i] = i;
+            }
+            std::stable_sort(m_order.begin(), m_order.end(), [&](std::size_t lhs, std::size_t rhs) {
+                return m_buckets_for_hash[lhs] < m_buckets_for_hash[rhs];
+            });
+            
+            const std::size_t nb_buckets = bucket_count + NeighborhoodSize - 1;
+            m_positions.resize(m_values.size());
+            m_nb_overflow_values = 0;
+            m_total_neighbor_offset = 0;
+            
+            std::size_t ibucket_next_empty = 0;
+            for(const std::size_t ivalue: m_order) {
+                const std::size_t ibucket_for_hash = m_buckets_for_hash[ivalue];
+                const std::size_t ibucket = std::max(ibucket_for_hash, ibucket_next_empty);
+                
+                if(ibucket - ibucket_for_hash < NeighborhoodSize && ibucket < nb_buckets) {
+                    m_positions[ivalue] = ibucket;
+                    m_total_neighbor_offset += ibucket - ibucket_for_hash;
+                    ibucket_next_empty = ibucket + 1;
+                }
+                else {
+                    m_positions[ivalue] = OVERFLOW_POSITION;
+                    m_nb_overflow_values++;
+                }
+            }
+        }
+    
+    public:
+        overflow_container_type m_values;
+        hashes_container_type m_hashes;
+        
+        std::vector<std::size_t> m_buckets_for_hash;
+        std::vector<std::size_t> m_order;
+        std::vector<std::size_t> m_positions;
+        
+        size_type m_bucket_count;
+        size_type m_nb_overflow_values;
+        size_type m_total_neighbor_offset;
+    };
+    
+    /*
+     * bucket_count_policy is the bucket count of the placement, it is not modified by the GrowthPolicy
+     * which already gave it.
+     */
+    frozen_hopscotch_hash(placement&& values_placement, const Hash& hash, const KeyEqual& equal,
+                          const Allocator& alloc):
+                                    frozen_hopscotch_hash(std::move(values_placement),
+                                                          size_type(values_placement.m_bucket_count),
+                                                          hash, equal, alloc)
+    {
+    }
+    
+    frozen_hopscotch_hash(placement&& values_placement, size_type bucket_count_policy,
+                          const Hash& hash, const KeyEqual& equal, const Allocator& alloc):
+                                    Hash(hash), KeyEqual(equal), GrowthPolicy(bucket_count_policy),
+                                    m_buckets(buckets_allocator(alloc)),
+                                    m_overflow_values(alloc),
+                                    m_overflow_hashes(hashes_allocator(alloc)),
+                                    m_bucket_count(values_placement.m_bucket_count),
+                                    m_nb_elements(values_placement.m_values.size()),
+                                    m_total_neighbor_offset(values_placement.m_total_neighbor_offset)
+    {
+        tsl_assert(bucket_count_policy == values_placement.m_bucket_count);
+        
+        m_buckets.resize(m_bucket_count + NeighborhoodSize - 1);
+        m_overflow_values.reserve(values_placement.m_nb_overflow_values);
+        m_overflow_hashes.reserve(values_placement.m_nb_overflow_values);
+        
+        // Values in the order of their bucket for hash, the overflow values are then sorted by hash
+        // with a stable sort to keep the order of the buckets for equal hashes
+        std::vector<std::size_t> overflow_indexes;
+        for(const std::size_t ivalue: values_placement.m_order) {
+            const std::size_t ibucket_for_hash = values_placement.m_buckets_for_hash[ivalue];
+            const std::size_t ibucket = values_placement.m_positions[ivalue];
+            
+            if(ibucket == OVERFLOW_POSITION) {
+                m_buckets[ibucket_for_hash].set_overflow(true);
+                overflow_indexes.push_back(ivalue);
+            }
+            else {
+                m_buckets[ibucket].set_value_of_empty_bucket(0, std::move(values_placement.m_values[ivalue]));
+                m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket - ibucket_for_hash);
+            }
+        }
+        
+        std::stable_sort(overflow_indexes.begin(), overflow_indexes.end(), [&](std::size_t lhs, std::size_t rhs) {
+            return values_placement.m_hashes[lhs] < values_placement.m_hashes[rhs];
+        });
+        for(const std::size_t ivalue: overflow_indexes) {
+            m_overflow_values.push_back(std::move(values_placement.m_values[ivalue]));
+            m_overflow_hashes.push_back(values_placement.m_hashes[ivalue]);
+        }
+    }
+    
+    template<class K>
+    std::size_t hash_key(const K& key) const {
+        return Hash::operator()(key);
+    }
+    
+    template<class K1, class K2>
+    bool compare_keys(const K1& key1, const K2& key2) const {
+        return KeyEqual::operator()(key1, key2);
+    }
+    
+    std::size_t bucket_for_hash(std::size_t hash) const {
+        return GrowthPolicy::bucket_for_hash(hash);
+    }
+    
+    template<class K>
+    const_iterator find_in_overflow(const K& key, std::size_t hash) const {
+        auto it_hash = std::lower_bound(m_overflow_hashes.cbegin(), m_overflow_hashes.cend(), hash);
+        for(; it_hash != m_overflow_hashes.cend() && *it_hash == hash; ++it_hash) {
+            const auto it_value = m_overflow_values.cbegin() + (it_hash - m_overflow_hashes.cbegin());
+            if(compare_keys(KeySelect()(*it_value), key)) {
+                return const_iterator(m_buckets.cend(), m_buckets.cend(), it_value);
+            }
+        }
+        
+        return cend();
+    }
+    
+private:
+    static const std::size_t OVERFLOW_POSITION = std::size_t(-1);
+    
+    /*
+     * Same as hopscotch_hash::MIN_LOAD_FACTOR_FOR_REHASH, below this load factor the values which don't fit
+     * in their neighborhood go in the overflow values instead of increasing the bucket count.
+     */
+    static constexpr float MIN_LOAD_FACTOR_FOR_GROWTH = 0.1f;
+    
+private:
+    buckets_container_type m_buckets;
+    overflow_container_type m_overflow_values;
+    hashes_container_type m_overflow_hashes;
+    
+    size_type m_bucket_count;
+    size_type m_nb_elements;
+    size_type m_total_neighbor_offset;
+};
+
+} // end namespace detail_frozen_hopscotch_hash
+
+} // end namespace tsl
+
+#endif
@@ -0,0 +1,341 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_FROZEN_HOPSCOTCH_MAP_H
+#define TSL_FROZEN_HOPSCOTCH_MAP_H
+
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "frozen_hopscotch_hash.h"
+#include "hopscotch_hash.h"
+#include "hopscotch_map.h"
+
+
+namespace tsl {
+
+/**
+ * Immutable hash map built at once from all its key-values, for dictionaries which are never modified
+ * once built. It can be built from a range of key-values or from a tsl::hopscotch_map with tsl::freeze.
+ * 
+ * The buckets and the lookups are the same as the ones of a tsl::hopscotch_map, but the key-values are placed
+ * knowing all of them instead of one insertion at a time. Each key-value is put in the first empty bucket
+ * after its bucket for hash, in the order of the buckets for hash, which minimizes the offsets of the key-values
+ * in their neighborhoods, and so the number of buckets a lookup goes through. The bucket count is the smallest
+ * one of the GrowthPolicy, in steps of about 1/16, for which all the key-values fit in their neighborhood.
+ * The map doesn't have the occupancy bitmap, the overflow list and the other state only needed for insertions,
+ * the few key-values which may not fit in their neighborhood (with a lot of equal hashes) are stored
+ * in a vector sorted by hash.
+ * 
+ * For the template parameters, see tsl::hopscotch_map. The hash is not stored in the buckets.
+ * 
+ * Iterators are never invalidated, except by the destruction of the map.
+ */
+template<class Key,
+         class T,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>,
+         class Allocator = std::allocator<std::pair<Key, T>>,
+         unsigned int NeighborhoodSize = 62,
+         class GrowthPolicy = tsl::power_of_two_growth_policy>
+class frozen_hopscotch_map {
+private:
+    template<typename U>
+    using has_is_transparent = tsl::detail_hopscotch_hash::has_is_transparent<U>;
+    
+    class KeySelect {
+    public:
+        using key_type = Key;
+        
+        const key_type& operator()(const std::pair<Key, T>& key_value) const {
+            return key_value.first;
+        }
+    };
+    
+    class ValueSelect {
+    public:
+        using value_type = T;
+        
+        const value_type& operator()(const std::pair<Key, T>& key_value) const {
+            return key_value.second;
+        }
+    };
+    
+    using ht = detail_frozen_hopscotch_hash::frozen_hopscotch_hash<std::pair<Key, T>, KeySelect, ValueSelect,
+                                                                   Hash, KeyEqual, Allocator,
+                                                                   NeighborhoodSize, GrowthPolicy>;
+    
+public:
+    using key_type = typename ht::key_type;
+    using mapped_type = T;
+    using value_type = typename ht::value_type;
+    using size_type = typename ht::size_type;
+    using difference_type = typename ht::difference_type;
+    using hasher = typename ht::hasher;
+    using key_equal = typename ht::key_equal;
+    using allocator_type = typename ht::allocator_type;
+    using reference = typename ht::reference;
+    using const_reference = typename ht::const_reference;
+    using pointer = typename ht::pointer;
+    using const_pointer = typename ht::const_pointer;
+    using iterator = typename ht::iterator;
+    using const_iterator = typename ht::const_iterator;
+    
+    
+    
+    /*
+     * Constructors
+     */
+    /**
+     * Build the map from the key-values of [first, last). If multiple key-values have equivalent keys,
+     * only the first one is kept.
+     */
+    template<class InputIt>
+    frozen_hopscotch_map(InputIt first, InputIt last,
+                         const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual(),
+                         const Allocator& alloc = Allocator()) : m_ht(first, last, hash, equal, alloc)
+    {
+    }
+    
+    frozen_hopscotch_map(std::initializer_list<value_type> init,
+                         const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual(),
+                         const Allocator& alloc = Allocator()) :
+                         frozen_hopscotch_map(init.begin(), init.end(), hash, equal, alloc)
+    {
+    }
+    
+    allocator_type get_allocator() const { return m_ht.get_allocator(); }
+    
+    
+    /*
+     * Iterators
+     */
+    const_iterator begin() const noexcept { return m_ht.begin(); }
+    const_iterator cbegin() const noexcept { return m_ht.cbegin(); }
+    
+    const_iterator end() const noexcept { return m_ht.end(); }
+    const_iterator cend() const noexcept { return m_ht.cend(); }
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const noexcept { return m_ht.empty(); }
+    size_type size() const noexcept { return m_ht.size(); }
+    
+    
+    /*
+     * Lookup
+     */
+    const T& at(const Key& key) const { return m_ht.at(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    const T& at(const Key& key, std::size_t precalculated_hash) const { return m_ht.at(key, precalculated_hash); }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const T& at(const K& key) const { return m_ht.at(key); }
+    
+    /**
+     * @copydoc at(const K& key)
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const T& at(const K& key, std::size_t precalculated_hash) const { return m_ht.at(key, precalculated_hash); }
+    
+    
+    size_type count(const Key& key) const { return m_ht.count(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    size_type count(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.count(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    size_type count(const K& key) const { return m_ht.count(key); }
+    
+    /**
+     * @copydoc count(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    size_type count(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.count(key, precalculated_hash);
+    }
+    
+    
+    const_iterator find(const Key& key) const { return m_ht.find(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    const_iterator find(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.find(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const_iterator find(const K& key) const { return m_ht.find(key); }
+    
+    /**
+     * @copydoc find(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const_iterator find(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.find(key, precalculated_hash);
+    }
+    
+    
+    bool contains(const Key& key) const { return m_ht.contains(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    bool contains(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.contains(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    bool contains(const K& key) const { return m_ht.contains(key); }
+    
+    /**
+     * @copydoc contains(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    bool contains(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.contains(key, precalculated_hash);
+    }
+    
+    
+    /*
+     * Bucket interface
+     */
+    size_type bucket_count() const { return m_ht.bucket_count(); }
+    
+    
+    /*
+     *  Hash policy
+     */
+    float load_factor() const { return m_ht.load_factor(); }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const { return m_ht.hash_function(); }
+    key_equal key_eq() const { return m_ht.key_eq(); }
+    
+    
+    /*
+     * Other
+     */
+    
+    /**
+     * Number of key-values which don't fit in their neighborhood.
+     */
+    size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
+    
+    /**
+     * Sum of the distances between the buckets of the key-values and their buckets for hash.
+     */
+    size_type total_neighbor_offset() const noexcept { return m_ht.total_neighbor_offset(); }
+    
+    
+    friend bool operator==(const frozen_hopscotch_map& lhs, const frozen_hopscotch_map& rhs) {
+        if(lhs.size() != rhs.size()) {
+            return false;
+        }
+        
+        for(const auto& element_lhs : lhs) {
+            const auto it_element_rhs = rhs.find(element_lhs.first);
+            if(it_element_rhs == rhs.cend() || element_lhs.second != it_element_rhs->second) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    friend bool operator!=(const frozen_hopscotch_map& lhs, const frozen_hopscotch_map& rhs) {
+        return !operator==(lhs, rhs);
+    }
+    
+private:
+    ht m_ht;
+};
+
+
+/**
+ * Build a tsl::frozen_hopscotch_map with the key-values and the parameters of map.
+ */
+template<class Key, class T, class Hash, class KeyEqual, class Allocator, unsigned int NeighborhoodSize,
+         bool StoreHash, class GrowthPolicy, class BucketLayout>
+frozen_hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize, GrowthPolicy>
+freeze(const hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize, StoreHash,
+                           GrowthPolicy, BucketLayout>& map)
+{
+    return frozen_hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize, GrowthPolicy>(
+                map.begin(), map.end(), map.hash_function(), map.key_eq(), map.get_allocator());
+}
+
+} // end namespace tsl
+
+#endif
@@ -40,6 +40,7 @@
 #include <memory>
 #include <ratio>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -49,6 +50,43 @@
 #define TSL_NO_RANGE_ERASE_WITH_CONST_ITERATOR
 #endif
 
+/*
+ * Counters of the internal operations of the maps and sets (see tsl::hopscotch_counters), 
+ * only kept if TSL_HOPSCOTCH_ENABLE_COUNTERS is defined.
+ */
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+#include <atomic>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ * SIMD instructions used to compare the fingerprints of tsl::fingerprint_bucket_layout.
+ * Define TSL_HOPSCOTCH_NO_SIMD to use the scalar version.
+ */
+#ifndef TSL_HOPSCOTCH_NO_SIMD
+    #if defined(__AVX2__)
+    #define TSL_HOPSCOTCH_AVX2
+    #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TSL_HOPSCOTCH_SSE2
+    #include <emmintrin.h>
+    #endif
+#endif
+
+/*
+ * C++20 coroutines used by the interleaved lookups (see hopscotch_map::find_batch_interleaved).
+ * TSL_HOPSCOTCH_COROUTINES is defined if the compiler supports them, unless TSL_HOPSCOTCH_NO_COROUTINES is defined.
+ */
+#if !defined(TSL_HOPSCOTCH_NO_COROUTINES) && defined(__cpp_impl_coroutine) && defined(__has_include)
+    #if __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+    #define TSL_HOPSCOTCH_COROUTINES
+    #include <coroutine>
+    #endif
+#endif
+
 
 
 /*
@@ -270,9 +308,212 @@ private:
 };
 
 
+/**
+ * Store the metadata of a bucket (neighborhood bitmap, empty and overflow flags and the optional stored hash)
+ * alongside its value in one array of buckets. Default layout.
+ */
+struct interleaved_bucket_layout {
+};
+
+/**
+ * Store the metadata of all the buckets (neighborhood bitmap, empty and overflow flags and the optional stored hash) 
+ * in a dense array separated from the array of values.
+ * 
+ * A lookup only reads the metadata of the neighborhood and the values it compares, and the padding needed 
+ * to align a value after its metadata is avoided (e.g. 20 bytes per bucket instead of 24 for 
+ * a std::pair<std::int64_t, std::int64_t> with a NeighborhoodSize of 30).
+ * The iteration and the accesses to a bucket touch two arrays instead of one.
+ */
+struct split_bucket_layout {
+};
+
+/**
+ * Same as tsl::split_bucket_layout with an additional array storing a one byte fingerprint of the hash 
+ * of each value (one more byte per bucket). 
+ * 
+ * On lookup, the fingerprints of the whole neighborhood are compared at once with SSE2 or AVX2 instructions 
+ * (if enabled at compilation) and the keys are only compared for the neighbors with the same fingerprint. 
+ * Useful when KeyEqual is expensive (e.g. std::string) and StoreHash is not wanted.
+ */
+struct fingerprint_bucket_layout {
+};
+
+
+/**
+ * Structural statistics of a hash map or set, returned by the stats() method of the maps and sets.
+ * 
+ * They show how well the hash function spreads the keys: with a good hash function most values are 
+ * in their bucket for hash or close to it and the overflow list stays empty.
+ * 
+ * The statistics take into account the buckets of an incremental rehash in progress.
+ */
+struct hopscotch_stats {
+    /**
+     * displacement_histogram[i] is the number of values stored at a distance of i buckets from 
+     * their bucket for hash. Its size is NeighborhoodSize. The values of the overflow list are not counted.
+     */
+    std::vector<std::size_t> displacement_histogram;
+    
+    /**
+     * neighborhood_fill_histogram[i] is the number of buckets which have i values in their neighborhood 
+     * (the number of bits set in their neighborhood bitmap). Its size is NeighborhoodSize + 1.
+     */
+    std::vector<std::size_t> neighborhood_fill_histogram;
+    
+    /**
+     * Number of buckets with their overflow flag set, a lookup of a key which hashes to one of these buckets 
+     * also searches the overflow list.
+     */
+    std::size_t nb_buckets_with_overflow = 0;
+    
+    /**
+     * Number of values in the overflow list, same as overflow_size().
+     */
+    std::size_t nb_overflow_elements = 0;
+    
+    /**
+     * Bytes allocated for the buckets and the occupancy bitmap.
+     */
+    std::size_t buckets_memory_size = 0;
+    
+    /**
+     * Estimation of the bytes allocated for the nodes of the overflow list, from the size of the values 
+     * and the usual size of the links of a node of std::list (two pointers) or std::set (three pointers 
+     * and the color).
+     */
+    std::size_t overflow_memory_size = 0;
+};
+
+
+/**
+ * Counters of the internal operations of a hash map or set since its construction (or the last call 
+ * to reset_counters()), returned by the counters() method of the maps and sets. The counters are only 
+ * kept, and the methods only available, if TSL_HOPSCOTCH_ENABLE_COUNTERS is defined before including 
+ * the headers. Otherwise they don't cost anything.
+ * 
+ * The counters stay with the map on rehash and swap, a copy or a move of the map starts with zero counters. 
+ * The work done to move the values in the new buckets of a rehash is not counted. 
+ */
+struct hopscotch_counters {
+    /**
+     * Number of searches of a key in a neighborhood, by the lookups but also by insert and erase. 
+     * The searches in the old buckets of an incremental rehash in progress are not counted.
+     */
+    std::uint64_t nb_lookups = 0;
+    
+    /**
+     * Number of calls to KeyEqual, nb_key_comparisons/nb_lookups is the average number of key 
+     * comparisons per lookup. The comparisons done by the std::set overflow container of 
+     * the hopscotch_sc_map and hopscotch_sc_set are not counted.
+     */
+    std::uint64_t nb_key_comparisons = 0;
+    
+    /**
+     * Number of values inserted, in a bucket or in the overflow list.
+     */
+    std::uint64_t nb_inserts = 0;
+    
+    /**
+     * Number of attempts to move an empty bucket closer to the bucket for hash of a value to insert 
+     * by displacing another value, nb_displacements/nb_inserts is the average number per insert.
+     */
+    std::uint64_t nb_displacements = 0;
+    
+    /**
+     * Number of inserts which didn't find any empty bucket in the probed range after the bucket for hash.
+     */
+    std::uint64_t nb_failed_empty_bucket_searches = 0;
+    
+    /**
+     * Number of values inserted in the overflow list.
+     */
+    std::uint64_t nb_overflow_inserts = 0;
+    
+    /**
+     * Number of rehashes triggered because the neighborhood of a value to insert was full and a rehash 
+     * would change it.
+     */
+    std::uint64_t nb_rehashes_on_full_neighborhood = 0;
+    
+    /**
+     * Number of rehashes triggered because the number of values in the buckets reached 
+     * max_load_factor()*bucket_count().
+     */
+    std::uint64_t nb_rehashes_on_load_threshold = 0;
+};
+
+
 namespace detail_hopscotch_hash {
     
     
+/*
+ * Internal operations counted in a tsl::hopscotch_counters.
+ */
+enum class hopscotch_counter {
+    lookups,
+    key_comparisons,
+    inserts,
+    displacements,
+    failed_empty_bucket_searches,
+    overflow_inserts,
+    rehashes_on_full_neighborhood,
+    rehashes_on_load_threshold,
+    nb_counters
+};
+
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+/*
+ * Storage of the counters of a hopscotch_hash.
+ * 
+ * The counters are incremented with a relaxed load and store instead of an atomic increment which is 
+ * much slower. The lookups on the same map from several threads are then not a data race but some 
+ * increments may be lost.
+ */
+class hopscotch_counters_storage {
+public:
+    hopscotch_counters_storage() noexcept {
+        reset();
+    }
+    
+    hopscotch_counters_storage(const hopscotch_counters_storage& other) = delete;
+    hopscotch_counters_storage& operator=(const hopscotch_counters_storage& other) = delete;
+    
+    void increment(hopscotch_counter counter, std::uint64_t n) const noexcept {
+        std::atomic<std::uint64_t>& value = m_values[static_cast<std::size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    
+    tsl::hopscotch_counters get() const noexcept {
+        tsl::hopscotch_counters counters;
+        counters.nb_lookups = load(hopscotch_counter::lookups);
+        counters.nb_key_comparisons = load(hopscotch_counter::key_comparisons);
+        counters.nb_inserts = load(hopscotch_counter::inserts);
+        counters.nb_displacements = load(hopscotch_counter::displacements);
+        counters.nb_failed_empty_bucket_searches = load(hopscotch_counter::failed_empty_bucket_searches);
+        counters.nb_overflow_inserts = load(hopscotch_counter::overflow_inserts);
+        counters.nb_rehashes_on_full_neighborhood = load(hopscotch_counter::rehashes_on_full_neighborhood);
+        counters.nb_rehashes_on_load_threshold = load(hopscotch_counter::rehashes_on_load_threshold);
+        
+        return counters;
+    }
+    
+    void reset() noexcept {
+        for(std::atomic<std::uint64_t>& value: m_values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+    
+private:
+    std::uint64_t load(hopscotch_counter counter) const noexcept {
+        return m_values[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    
+private:
+    mutable std::atomic<std::uint64_t> m_values[static_cast<std::size_t>(hopscotch_counter::nb_counters)];
+};
+#endif
+    
+    
     
 template<typename T>
 struct make_void {
@@ -298,6 +539,76 @@ struct has_key_compare<T, typename make_void<typename T::key_compare>::type> : s
 };
 
 
+/*
+ * is_bulk_insertable<InputIt, ValueType>::value is true if a range of InputIt can be traversed more than once
+ * and its elements are ValueType (and not only something ValueType can be constructed from).
+ */
+template<class InputIt, class ValueType>
+struct is_bulk_insertable: std::integral_constant<bool, 
+                        std::is_base_of<std::forward_iterator_tag, 
+                                        typename std::iterator_traits<InputIt>::iterator_category>::value &&
+                        std::is_same<typename std::decay<typename std::iterator_traits<InputIt>::reference>::type, 
+                                     ValueType>::value> {
+};
+
+
+/*
+ * has_raw_bytes_overload<T, CharPointer>::value is true if a T object can be called with (CharPointer, std::size_t),
+ * the optional overload of the serializers (const char*) and deserializers (char*) to write and read raw bytes.
+ */
+template<typename T, typename CharPointer, typename = void>
+struct has_raw_bytes_overload: std::false_type {
+};
+
+template<typename T, typename CharPointer>
+struct has_raw_bytes_overload<T, CharPointer,
+                              typename make_void<decltype(std::declval<T&>()(std::declval<CharPointer>(),
+                                                                             std::size_t(0)))>::type>: std::true_type {
+};
+
+/*
+ * Serialization of a value as its raw bytes. Only supported if the value is trivially copyable, or is a pair
+ * of trivially copyable types (std::pair itself is not trivially copyable), in which case the two members
+ * are written one after the other so that the padding bytes of the pair are not written.
+ */
+template<typename U>
+struct raw_bytes_serialization {
+    static const bool supported = std::is_trivially_copyable<U>::value;
+
+    template<class Serializer>
+    static void serialize(Serializer& serializer, const U& value) {
+        serializer(reinterpret_cast<const char*>(std::addressof(value)), sizeof(U));
+    }
+
+    template<class Deserializer>
+    static U deserialize(Deserializer& deserializer) {
+        typename std::aligned_storage<sizeof(U), alignof(U)>::type storage;
+        deserializer(reinterpret_cast<char*>(std::addressof(storage)), sizeof(U));
+
+        return *reinterpret_cast<const U*>(std::addressof(storage));
+    }
+};
+
+template<typename U1, typename U2>
+struct raw_bytes_serialization<std::pair<U1, U2>> {
+    static const bool supported = raw_bytes_serialization<U1>::supported && raw_bytes_serialization<U2>::supported;
+
+    template<class Serializer>
+    static void serialize(Serializer& serializer, const std::pair<U1, U2>& value) {
+        raw_bytes_serialization<U1>::serialize(serializer, value.first);
+        raw_bytes_serialization<U2>::serialize(serializer, value.second);
+    }
+
+    template<class Deserializer>
+    static std::pair<U1, U2> deserialize(Deserializer& deserializer) {
+        U1 first = raw_bytes_serialization<U1>::deserialize(deserializer);
+        U2 second = raw_bytes_serialization<U2>::deserialize(deserializer);
+
+        return std::pair<U1, U2>(first, second);
+    }
+};
+
+
 
 
 
@@ -332,6 +643,154 @@ class smallest_type_for_min_bits<MinBits, typename std::enable_if<(MinBits > 32)
 public:
     using type = std::uint_least64_t;
 };
+
+
+/*
+ * Return the number of trailing zero bits in value, value must not be 0.
+ */
+inline unsigned int count_trailing_zeros(std::uint_least64_t value) noexcept {
+    tsl_assert(value != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    
+    return static_cast<unsigned int>(index);
+#else
+    unsigned int nb_zeros = 0;
+    while((value & 1) == 0) {
+        value >>= 1;
+        nb_zeros++;
+    }
+    
+    return nb_zeros;
+#endif
+}
+
+/*
+ * Hint the processor to load the cache line containing address. Does nothing if the compiler doesn't provide 
+ * a way to do it.
+ */
+inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void) address;
+#endif
+}
+
+
+/*
+ * Lookup kernels used by hopscotch_hash to search the neighborhood of a bucket.
+ * 
+ * All of them return the smallest index 'i' < NeighborhoodSize for which the bit 'i' is set in neighborhood_infos 
+ * and predicate(i) is true, or NeighborhoodSize if there is none.
+ */
+
+/*
+ * Shift the bitmap one bit at a time. The number of iterations is the position of the most significant 
+ * set bit (or of the match), independently of the number of set bits.
+ */
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor_shift_loop(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate) {
+    std::size_t ineighbor = 0;
+    while(neighborhood_infos != 0) {
+        if((neighborhood_infos & 1) == 1 && predicate(ineighbor)) {
+            return ineighbor;
+        }
+        
+        ineighbor++;
+        neighborhood_infos = NeighborhoodBitmap(neighborhood_infos >> 1);
+    }
+    
+    return NeighborhoodSize;
+}
+
+/*
+ * Jump from one set bit to the next with count_trailing_zeros. The number of iterations is the number of 
+ * set bits (or of set bits before the match).
+ */
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor_bit_scan(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate) {
+    std::uint_least64_t remaining_neighbors = neighborhood_infos;
+    while(remaining_neighbors != 0) {
+        const std::size_t ineighbor = count_trailing_zeros(remaining_neighbors);
+        if(predicate(ineighbor)) {
+            return ineighbor;
+        }
+        
+        // Clear the least significant set bit
+        remaining_neighbors &= remaining_neighbors - 1;
+    }
+    
+    return NeighborhoodSize;
+}
+
+template<unsigned int NeighborhoodSize, unsigned int IStep, class Predicate>
+inline std::size_t find_neighbor_unrolled_impl(std::uint_least64_t /*remaining_neighbors*/, Predicate&& /*predicate*/,
+                                               std::true_type /*end of neighborhood*/) 
+{
+    return NeighborhoodSize;
+}
+
+template<unsigned int NeighborhoodSize, unsigned int IStep, class Predicate>
+inline std::size_t find_neighbor_unrolled_impl(std::uint_least64_t remaining_neighbors, Predicate&& predicate,
+                                               std::false_type /*end of neighborhood*/) 
+{
+    if(remaining_neighbors == 0) {
+        return NeighborhoodSize;
+    }
+    
+    const std::size_t ineighbor = count_trailing_zeros(remaining_neighbors);
+    if(predicate(ineighbor)) {
+        return ineighbor;
+    }
+    
+    return find_neighbor_unrolled_impl<NeighborhoodSize, IStep + 1>(
+                remaining_neighbors & (remaining_neighbors - 1), std::forward<Predicate>(predicate), 
+                std::integral_constant<bool, IStep + 1 >= NeighborhoodSize>());
+}
+
+/*
+ * Same as find_neighbor_bit_scan but with the loop fully unrolled at compilation time. There can't be 
+ * more than NeighborhoodSize set bits, the number of steps is thus bounded by a constant.
+ */
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor_unrolled(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate) {
+    return find_neighbor_unrolled_impl<NeighborhoodSize, 0>(std::uint_least64_t(neighborhood_infos), 
+                                                            std::forward<Predicate>(predicate), 
+                                                            std::false_type());
+}
+
+/*
+ * Unroll the bit scan for small neighborhoods and keep a loop for the bigger ones to limit the size 
+ * of the code generated for each lookup (see benchmarks/lookup_kernel_bench.cpp).
+ */
+static const unsigned int MAX_NEIGHBORHOOD_SIZE_UNROLLED_LOOKUP = 16;
+
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate, 
+                                 std::true_type /*unrolled*/) 
+{
+    return find_neighbor_unrolled<NeighborhoodSize>(neighborhood_infos, std::forward<Predicate>(predicate));
+}
+
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate, 
+                                 std::false_type /*unrolled*/) 
+{
+    return find_neighbor_bit_scan<NeighborhoodSize>(neighborhood_infos, std::forward<Predicate>(predicate));
+}
+
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap, class Predicate>
+inline std::size_t find_neighbor(NeighborhoodBitmap neighborhood_infos, Predicate&& predicate) {
+    return find_neighbor<NeighborhoodSize>(
+                neighborhood_infos, std::forward<Predicate>(predicate),
+                std::integral_constant<bool, (NeighborhoodSize <= MAX_NEIGHBORHOOD_SIZE_UNROLLED_LOOKUP)>());
+}
         
 
 
@@ -402,8 +861,14 @@ private:
     hash_type m_hash;
 };
 
-template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash>
-class hopscotch_bucket: public hopscotch_bucket_hash<StoreHash> {
+/*
+ * Metadata of a bucket: the (optional) stored hash and the neighborhood bitmap with its reserved bits.
+ * 
+ * hopscotch_bucket stores the metadata next to the value while hopscotch_split_buckets stores 
+ * the metadata of all the buckets in their own array.
+ */
+template<unsigned int NeighborhoodSize, bool StoreHash>
+class hopscotch_bucket_infos: public hopscotch_bucket_hash<StoreHash> {
 private:
     static const size_t MIN_NEIGHBORHOOD_SIZE = 4;
     static const size_t MAX_NEIGHBORHOOD_SIZE = SMALLEST_TYPE_MAX_BITS_SUPPORTED - NB_RESERVED_BITS_IN_NEIGHBORHOOD; 
@@ -425,68 +890,33 @@ private:
     
     using bucket_hash = hopscotch_bucket_hash<StoreHash>;
     
+    template<class, unsigned int, bool, bool, bool>
+    friend class hopscotch_split_bucket_reference;
+    
+    template<class, unsigned int, bool, bool, class>
+    friend class hopscotch_split_buckets;
+    
 public:
-    using value_type = ValueType;
     using neighborhood_bitmap = 
                 typename smallest_type_for_min_bits<NeighborhoodSize + NB_RESERVED_BITS_IN_NEIGHBORHOOD>::type;
 
 
-    hopscotch_bucket() noexcept: bucket_hash(), m_neighborhood_infos(0) {
+    hopscotch_bucket_infos() noexcept: bucket_hash(), m_neighborhood_infos(0) {
         tsl_assert(empty());
     }
     
-    
-    hopscotch_bucket(const hopscotch_bucket& bucket) 
-        noexcept(std::is_nothrow_copy_constructible<value_type>::value): bucket_hash(bucket), 
-                                                                         m_neighborhood_infos(0) 
-    {
-        if(!bucket.empty()) {
-            ::new (static_cast<void*>(std::addressof(m_value))) value_type(bucket.value());
-        }
-        
-        m_neighborhood_infos = bucket.m_neighborhood_infos;
-    }
-    
-    hopscotch_bucket(hopscotch_bucket&& bucket)
-        noexcept(std::is_nothrow_move_constructible<value_type>::value) : bucket_hash(std::move(bucket)),
-                                                                          m_neighborhood_infos(0) 
-    {
-        if(!bucket.empty()) {
-            ::new (static_cast<void*>(std::addressof(m_value))) value_type(std::move(bucket.value()));
-        }
-        
-        m_neighborhood_infos = bucket.m_neighborhood_infos;
-    }
-     
-    hopscotch_bucket& operator=(const hopscotch_bucket& bucket) 
-        noexcept(std::is_nothrow_copy_constructible<value_type>::value) 
-    {
-        if(this != &bucket) {
-            remove_value();
-            
-            bucket_hash::operator=(bucket);
-            if(!bucket.empty()) {
-                ::new (static_cast<void*>(std::addressof(m_value))) value_type(bucket.value());
-            }
-            
-            m_neighborhood_infos = bucket.m_neighborhood_infos;
-        }
-        
-        return *this;
-    }
-    
-    hopscotch_bucket& operator=(hopscotch_bucket&& ) = delete;
-     
-    ~hopscotch_bucket() noexcept {
-        if(!empty()) {
-            destroy_value();
-        }
-    }
-    
     neighborhood_bitmap neighborhood_infos() const noexcept {
         return neighborhood_bitmap(m_neighborhood_infos >> NB_RESERVED_BITS_IN_NEIGHBORHOOD);
     }
     
+    /*
+     * Return the neighborhood bitmap restricted to the neighbors which may contain a value with this hash.
+     * Without fingerprints, all the neighbors may contain it.
+     */
+    neighborhood_bitmap neighborhood_infos_for_hash(std::size_t /*hash*/) const noexcept {
+        return neighborhood_infos();
+    }
+    
     void set_overflow(bool has_overflow) noexcept {
         if(has_overflow) {
             m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos | 2);
@@ -519,89 +949,1211 @@ public:
         return false;
     }
     
-    value_type& value() noexcept {
-        tsl_assert(!empty());
-        return *reinterpret_cast<value_type*>(std::addressof(m_value));
-    }
-    
-    const value_type& value() const noexcept {
-        tsl_assert(!empty());
-        return *reinterpret_cast<const value_type*>(std::addressof(m_value));
-    }
+    static std::size_t max_size() noexcept {
+        if(StoreHash) {
+            return std::numeric_limits<typename bucket_hash::hash_type>::max();
+        }
+        else {
+            return std::numeric_limits<std::size_t>::max();
+        }
+    }
+    
+protected:
+    void copy_infos(const hopscotch_bucket_infos& infos) noexcept {
+        this->copy_hash(infos);
+        m_neighborhood_infos = infos.m_neighborhood_infos;
+    }
+    
+    void clear_infos() noexcept {
+        m_neighborhood_infos = 0;
+        tsl_assert(empty());
+    }
+    
+    void set_empty(bool is_empty) noexcept {
+        if(is_empty) {
+            m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos & ~1);
+        }
+        else {
+            m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos | 1);
+        }
+    }
+    
+private:
+    neighborhood_bitmap m_neighborhood_infos;
+};
+
+
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash>
+class hopscotch_bucket: public hopscotch_bucket_infos<NeighborhoodSize, StoreHash> {
+private:
+    using bucket_infos = hopscotch_bucket_infos<NeighborhoodSize, StoreHash>;
+    
+public:
+    using value_type = ValueType;
+    using neighborhood_bitmap = typename bucket_infos::neighborhood_bitmap;
+
+
+    hopscotch_bucket() noexcept: bucket_infos() {
+    }
+    
+    
+    hopscotch_bucket(const hopscotch_bucket& bucket) 
+        noexcept(std::is_nothrow_copy_constructible<value_type>::value): bucket_infos()
+    {
+        if(!bucket.empty()) {
+            ::new (static_cast<void*>(std::addressof(m_value))) value_type(bucket.value());
+        }
+        
+        this->copy_infos(bucket);
+    }
+    
+    hopscotch_bucket(hopscotch_bucket&& bucket)
+        noexcept(std::is_nothrow_move_constructible<value_type>::value) : bucket_infos()
+    {
+        if(!bucket.empty()) {
+            ::new (static_cast<void*>(std::addressof(m_value))) value_type(std::move(bucket.value()));
+        }
+        
+        this->copy_infos(bucket);
+    }
+     
+    hopscotch_bucket& operator=(const hopscotch_bucket& bucket) 
+        noexcept(std::is_nothrow_copy_constructible<value_type>::value) 
+    {
+        if(this != &bucket) {
+            remove_value();
+            
+            if(!bucket.empty()) {
+                ::new (static_cast<void*>(std::addressof(m_value))) value_type(bucket.value());
+            }
+            
+            this->copy_infos(bucket);
+        }
+        
+        return *this;
+    }
+    
+    hopscotch_bucket& operator=(hopscotch_bucket&& ) = delete;
+     
+    ~hopscotch_bucket() noexcept {
+        if(!this->empty()) {
+            destroy_value();
+        }
+    }
+    
+    value_type& value() noexcept {
+        tsl_assert(!this->empty());
+        return *reinterpret_cast<value_type*>(std::addressof(m_value));
+    }
+    
+    const value_type& value() const noexcept {
+        tsl_assert(!this->empty());
+        return *reinterpret_cast<const value_type*>(std::addressof(m_value));
+    }
+    
+    /*
+     * Same as value() without checking that the bucket is not empty. Only used by the optimistic reads of
+     * tsl::concurrent_hopscotch_map which may read a bucket while another thread modifies it.
+     */
+    const value_type* value_storage() const noexcept {
+        return reinterpret_cast<const value_type*>(std::addressof(m_value));
+    }
+    
+    template<typename... Args>
+    void set_value_of_empty_bucket(std::size_t hash, Args&&... value_type_args) {
+        tsl_assert(this->empty());
+        
+        ::new (static_cast<void*>(std::addressof(m_value))) value_type(std::forward<Args>(value_type_args)...);
+        this->set_empty(false);
+        this->set_hash(hash);
+    }
+    
+    void swap_value_into_empty_bucket(hopscotch_bucket& empty_bucket) {
+        tsl_assert(empty_bucket.empty());
+        if(!this->empty()) {
+            ::new (static_cast<void*>(std::addressof(empty_bucket.m_value))) value_type(std::move(value()));
+            empty_bucket.copy_hash(*this);
+            empty_bucket.set_empty(false);
+            
+            destroy_value();
+            this->set_empty(true);
+        }
+    }
+    
+    void remove_value() noexcept {
+        if(!this->empty()) {
+            destroy_value();
+            this->set_empty(true);
+        }
+    }
+    
+    void clear() noexcept {
+        if(!this->empty()) {
+            destroy_value();
+        }
+        
+        this->clear_infos();
+    }
+    
+private:
+    void destroy_value() noexcept {
+        try {
+            tsl_assert(!this->empty());
+            
+            value().~value_type();
+        }
+        catch(...) {
+            std::terminate();
+        }
+    }
+    
+private:
+    using storage = typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type;
+    
+    storage m_value;
+};
+
+
+/*
+ * Fingerprint of a hash stored by tsl::fingerprint_bucket_layout. The bits of the hash are folded into a byte.
+ * 
+ * If StoreHash is true, only the 32 stored bits of the hash are folded as it's the truncated stored hash 
+ * which is passed to the buckets on rehash.
+ */
+template<bool StoreHash>
+inline std::uint8_t hash_fingerprint(std::size_t hash) noexcept {
+    std::uint_least64_t folded_hash = StoreHash?std::uint_least32_t(hash):hash;
+    folded_hash ^= folded_hash >> 32;
+    folded_hash ^= folded_hash >> 16;
+    folded_hash ^= folded_hash >> 8;
+    
+    return std::uint8_t(folded_hash);
+}
+
+/*
+ * Number of bytes after the last bucket that must be readable in the array of fingerprints, a neighborhood
+ * is compared with 16 or 32 bytes loads and NeighborhoodSize is <= 62.
+ */
+static const std::size_t FINGERPRINTS_PADDING = 64;
+
+/*
+ * Return the neighborhood bitmap with only the bits of the neighbors for which the fingerprint, 
+ * in fingerprints[ineighbor], is equal to 'fingerprint'.
+ * 
+ * With SSE2 or AVX2 all the fingerprints of the neighborhood are compared at once, 
+ * otherwise only the fingerprints of the neighbors present in the bitmap are checked.
+ */
+template<unsigned int NeighborhoodSize, class NeighborhoodBitmap>
+inline NeighborhoodBitmap filter_neighborhood_by_fingerprint(NeighborhoodBitmap neighborhood_infos, 
+                                                             const std::uint8_t* fingerprints, 
+                                                             std::uint8_t fingerprint) noexcept 
+{
+#if defined(TSL_HOPSCOTCH_AVX2)
+    std::uint_least64_t matches = 0;
+    const __m256i fingerprint_vector = _mm256_set1_epi8(char(fingerprint));
+    for(std::size_t i = 0; i < NeighborhoodSize; i += 32) {
+        const __m256i fingerprints_vector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fingerprints + i));
+        const std::uint32_t mask = std::uint32_t(
+                                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(fingerprints_vector, fingerprint_vector)));
+        matches |= std::uint_least64_t(mask) << i;
+    }
+    
+    return NeighborhoodBitmap(neighborhood_infos & matches);
+#elif defined(TSL_HOPSCOTCH_SSE2)
+    std::uint_least64_t matches = 0;
+    const __m128i fingerprint_vector = _mm_set1_epi8(char(fingerprint));
+    for(std::size_t i = 0; i < NeighborhoodSize; i += 16) {
+        const __m128i fingerprints_vector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fingerprints + i));
+        const std::uint32_t mask = std::uint32_t(
+                                        _mm_movemask_epi8(_mm_cmpeq_epi8(fingerprints_vector, fingerprint_vector)));
+        matches |= std::uint_least64_t(mask) << i;
+    }
+    
+    return NeighborhoodBitmap(neighborhood_infos & matches);
+#else
+    NeighborhoodBitmap filtered_neighborhood_infos = neighborhood_infos;
+    for(std::size_t ineighbor = 0; neighborhood_infos != 0; ineighbor++) {
+        if((neighborhood_infos & 1) == 1 && fingerprints[ineighbor] != fingerprint) {
+            filtered_neighborhood_infos = NeighborhoodBitmap(filtered_neighborhood_infos ^ (1ull << ineighbor));
+        }
+        
+        neighborhood_infos = NeighborhoodBitmap(neighborhood_infos >> 1);
+    }
+    
+    return filtered_neighborhood_infos;
+#endif
+}
+
+
+/*
+ * Pointer to the fingerprint of a bucket in hopscotch_split_buckets. Empty if StoreFingerprint is false.
+ */
+template<bool StoreFingerprint, bool IsConst>
+class hopscotch_split_bucket_fingerprint {
+public:
+    using fingerprint_pointer = typename std::conditional<IsConst, const std::uint8_t*, std::uint8_t*>::type;
+    
+    explicit hopscotch_split_bucket_fingerprint(fingerprint_pointer /*fingerprint*/) noexcept {
+    }
+    
+    fingerprint_pointer fingerprint() const noexcept {
+        return nullptr;
+    }
+    
+protected:
+    template<unsigned int NeighborhoodSize, bool StoreHash, class NeighborhoodBitmap>
+    NeighborhoodBitmap filter_neighborhood(NeighborhoodBitmap neighborhood_infos, std::size_t /*hash*/) const noexcept {
+        return neighborhood_infos;
+    }
+    
+    template<bool StoreHash>
+    void set_fingerprint(std::size_t /*hash*/) const noexcept {
+    }
+    
+    void copy_fingerprint(const hopscotch_split_bucket_fingerprint& /*bucket*/) const noexcept {
+    }
+    
+    void advance_fingerprint(std::ptrdiff_t /*n*/) noexcept {
+    }
+};
+
+template<bool IsConst>
+class hopscotch_split_bucket_fingerprint<true, IsConst> {
+public:
+    using fingerprint_pointer = typename std::conditional<IsConst, const std::uint8_t*, std::uint8_t*>::type;
+    
+    explicit hopscotch_split_bucket_fingerprint(fingerprint_pointer fingerprint) noexcept: m_fingerprint(fingerprint) {
+    }
+    
+    fingerprint_pointer fingerprint() const noexcept {
+        return m_fingerprint;
+    }
+    
+protected:
+    template<unsigned int NeighborhoodSize, bool StoreHash, class NeighborhoodBitmap>
+    NeighborhoodBitmap filter_neighborhood(NeighborhoodBitmap neighborhood_infos, std::size_t hash) const noexcept {
+        return filter_neighborhood_by_fingerprint<NeighborhoodSize>(neighborhood_infos, m_fingerprint, 
+                                                                    hash_fingerprint<StoreHash>(hash));
+    }
+    
+    template<bool StoreHash>
+    void set_fingerprint(std::size_t hash) const noexcept {
+        *m_fingerprint = hash_fingerprint<StoreHash>(hash);
+    }
+    
+    void copy_fingerprint(const hopscotch_split_bucket_fingerprint& bucket) const noexcept {
+        *m_fingerprint = *bucket.m_fingerprint;
+    }
+    
+    void advance_fingerprint(std::ptrdiff_t n) noexcept {
+        m_fingerprint += n;
+    }
+    
+private:
+    fingerprint_pointer m_fingerprint;
+};
+
+
+/*
+ * Reference to a bucket of hopscotch_split_buckets. 
+ * 
+ * The metadata of the bucket, its value and its optional fingerprint are stored in different arrays, 
+ * the reference holds a pointer in each of them and offers the same interface as hopscotch_bucket 
+ * so that hopscotch_hash can use all the layouts interchangeably.
+ */
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, bool StoreFingerprint, bool IsConst>
+class hopscotch_split_bucket_reference: public hopscotch_split_bucket_fingerprint<StoreFingerprint, IsConst> {
+private:
+    using bucket_infos = hopscotch_bucket_infos<NeighborhoodSize, StoreHash>;
+    using bucket_fingerprint = hopscotch_split_bucket_fingerprint<StoreFingerprint, IsConst>;
+    using infos_pointer = typename std::conditional<IsConst, const bucket_infos*, bucket_infos*>::type;
+    using value_pointer = typename std::conditional<IsConst, const ValueType*, ValueType*>::type;
+    using fingerprint_pointer = typename bucket_fingerprint::fingerprint_pointer;
+    
+public:
+    using value_type = ValueType;
+    using neighborhood_bitmap = typename bucket_infos::neighborhood_bitmap;
+    
+    
+    hopscotch_split_bucket_reference(infos_pointer infos, value_pointer value, 
+                                     fingerprint_pointer fingerprint) noexcept: bucket_fingerprint(fingerprint),
+                                                                                m_infos(infos), 
+                                                                                m_value(value) 
+    {
+    }
+    
+    /*
+     * Allow the use of operator-> on the iterators of hopscotch_split_buckets.
+     */
+    const hopscotch_split_bucket_reference* operator->() const noexcept {
+        return this;
+    }
+    
+    neighborhood_bitmap neighborhood_infos() const noexcept {
+        return m_infos->neighborhood_infos();
+    }
+    
+    neighborhood_bitmap neighborhood_infos_for_hash(std::size_t hash) const noexcept {
+        return this->template filter_neighborhood<NeighborhoodSize, StoreHash>(m_infos->neighborhood_infos(), hash);
+    }
+    
+    void set_overflow(bool has_overflow) const noexcept {
+        m_infos->set_overflow(has_overflow);
+    }
+    
+    bool has_overflow() const noexcept {
+        return m_infos->has_overflow();
+    }
+    
+    bool empty() const noexcept {
+        return m_infos->empty();
+    }
+    
+    void toggle_neighbor_presence(std::size_t ineighbor) const noexcept {
+        m_infos->toggle_neighbor_presence(ineighbor);
+    }
+    
+    bool check_neighbor_presence(std::size_t ineighbor) const noexcept {
+        return m_infos->check_neighbor_presence(ineighbor);
+    }
+    
+    bool bucket_hash_equal(std::size_t hash) const noexcept {
+        return m_infos->bucket_hash_equal(hash);
+    }
+    
+    std::size_t truncated_bucket_hash() const noexcept {
+        return m_infos->truncated_bucket_hash();
+    }
+    
+    typename std::conditional<IsConst, const value_type&, value_type&>::type value() const noexcept {
+        tsl_assert(!empty());
+        return *m_value;
+    }
+    
+    template<typename... Args>
+    void set_value_of_empty_bucket(std::size_t hash, Args&&... value_type_args) const {
+        tsl_assert(empty());
+        
+        ::new (static_cast<void*>(m_value)) value_type(std::forward<Args>(value_type_args)...);
+        m_infos->set_empty(false);
+        m_infos->set_hash(hash);
+        this->template set_fingerprint<StoreHash>(hash);
+    }
+    
+    void swap_value_into_empty_bucket(const hopscotch_split_bucket_reference& empty_bucket) const {
+        tsl_assert(empty_bucket.empty());
+        if(!empty()) {
+            ::new (static_cast<void*>(empty_bucket.m_value)) value_type(std::move(value()));
+            empty_bucket.m_infos->copy_hash(*m_infos);
+            empty_bucket.copy_fingerprint(*this);
+            empty_bucket.m_infos->set_empty(false);
+            
+            destroy_value();
+            m_infos->set_empty(true);
+        }
+    }
+    
+    void remove_value() const noexcept {
+        if(!empty()) {
+            destroy_value();
+            m_infos->set_empty(true);
+        }
+    }
+    
+    void clear() const noexcept {
+        if(!empty()) {
+            destroy_value();
+        }
+        
+        m_infos->clear_infos();
+    }
+    
+private:
+    void destroy_value() const noexcept {
+        try {
+            tsl_assert(!empty());
+            
+            m_value->~value_type();
+        }
+        catch(...) {
+            std::terminate();
+        }
+    }
+    
+private:
+    infos_pointer m_infos;
+    value_pointer m_value;
+};
+
+
+/*
+ * Random access iterator over the buckets of hopscotch_split_buckets. Dereferencing the iterator
+ * returns a hopscotch_split_bucket_reference by value.
+ */
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, bool StoreFingerprint, bool IsConst>
+class hopscotch_split_buckets_iterator: private hopscotch_split_bucket_fingerprint<StoreFingerprint, IsConst> {
+    template<typename, unsigned int, bool, bool, bool>
+    friend class hopscotch_split_buckets_iterator;
+    
+private:
+    using bucket_infos = hopscotch_bucket_infos<NeighborhoodSize, StoreHash>;
+    using bucket_fingerprint = hopscotch_split_bucket_fingerprint<StoreFingerprint, IsConst>;
+    using infos_pointer = typename std::conditional<IsConst, const bucket_infos*, bucket_infos*>::type;
+    using value_pointer = typename std::conditional<IsConst, const ValueType*, ValueType*>::type;
+    using fingerprint_pointer = typename bucket_fingerprint::fingerprint_pointer;
+    
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = hopscotch_split_bucket_reference<ValueType, NeighborhoodSize, StoreHash, 
+                                                        StoreFingerprint, IsConst>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    using pointer = value_type;
+    
+    
+    hopscotch_split_buckets_iterator() noexcept: bucket_fingerprint(nullptr), m_infos(nullptr), m_value(nullptr) {
+    }
+    
+    hopscotch_split_buckets_iterator(infos_pointer infos, value_pointer value, 
+                                     fingerprint_pointer fingerprint) noexcept: bucket_fingerprint(fingerprint),
+                                                                                m_infos(infos), 
+                                                                                m_value(value) 
+    {
+    }
+    
+    // Copy constructor from iterator to const_iterator.
+    template<bool TIsConst = IsConst, typename std::enable_if<TIsConst>::type* = nullptr>
+    hopscotch_split_buckets_iterator(
+            const hopscotch_split_buckets_iterator<ValueType, NeighborhoodSize, StoreHash, 
+                                                   StoreFingerprint, !TIsConst>& other) noexcept: 
+                        bucket_fingerprint(other.fingerprint()), m_infos(other.m_infos), m_value(other.m_value)
+    {
+    }
+    
+    hopscotch_split_buckets_iterator(const hopscotch_split_buckets_iterator& other) = default;
+    hopscotch_split_buckets_iterator& operator=(const hopscotch_split_buckets_iterator& other) = default;
+    
+    reference operator*() const noexcept {
+        return reference(m_infos, m_value, this->fingerprint());
+    }
+    
+    pointer operator->() const noexcept {
+        return pointer(m_infos, m_value, this->fingerprint());
+    }
+    
+    reference operator[](difference_type n) const noexcept {
+        return *(*this + n);
+    }
+    
+    hopscotch_split_buckets_iterator& operator++() noexcept {
+        return *this += 1;
+    }
+    
+    hopscotch_split_buckets_iterator operator++(int) noexcept {
+        hopscotch_split_buckets_iterator tmp(*this);
+        ++*this;
+        
+        return tmp;
+    }
+    
+    hopscotch_split_buckets_iterator& operator--() noexcept {
+        return *this -= 1;
+    }
+    
+    hopscotch_split_buckets_iterator operator--(int) noexcept {
+        hopscotch_split_buckets_iterator tmp(*this);
+        --*this;
+        
+        return tmp;
+    }
+    
+    hopscotch_split_buckets_iterator& operator+=(difference_type n) noexcept {
+        m_infos += n;
+        m_value += n;
+        this->advance_fingerprint(n);
+        
+        return *this;
+    }
+    
+    hopscotch_split_buckets_iterator& operator-=(difference_type n) noexcept {
+        return *this += -n;
+    }
+    
+    friend hopscotch_split_buckets_iterator operator+(hopscotch_split_buckets_iterator it, difference_type n) noexcept {
+        return it += n;
+    }
+    
+    friend hopscotch_split_buckets_iterator operator+(difference_type n, hopscotch_split_buckets_iterator it) noexcept {
+        return it += n;
+    }
+    
+    friend hopscotch_split_buckets_iterator operator-(hopscotch_split_buckets_iterator it, difference_type n) noexcept {
+        return it -= n;
+    }
+    
+    friend difference_type operator-(const hopscotch_split_buckets_iterator& lhs, 
+                                     const hopscotch_split_buckets_iterator& rhs) noexcept 
+    {
+        return lhs.m_infos - rhs.m_infos;
+    }
+    
+    friend bool operator==(const hopscotch_split_buckets_iterator& lhs, 
+                           const hopscotch_split_buckets_iterator& rhs) noexcept 
+    { 
+        return lhs.m_infos == rhs.m_infos; 
+    }
+    
+    friend bool operator!=(const hopscotch_split_buckets_iterator& lhs, 
+                           const hopscotch_split_buckets_iterator& rhs) noexcept 
+    { 
+        return !(lhs == rhs); 
+    }
+    
+    friend bool operator<(const hopscotch_split_buckets_iterator& lhs, 
+                          const hopscotch_split_buckets_iterator& rhs) noexcept 
+    { 
+        return lhs.m_infos < rhs.m_infos; 
+    }
+    
+private:
+    infos_pointer m_infos;
+    value_pointer m_value;
+};
+
+
+/*
+ * Container of buckets used by hopscotch_hash with tsl::split_bucket_layout and tsl::fingerprint_bucket_layout.
+ * 
+ * The neighborhood bitmaps, the empty and overflow flags and the (optional) stored hashes of all the buckets
+ * are stored in a dense array of hopscotch_bucket_infos. The values are stored in a separate uninitialized 
+ * array of value_type of the same size. A lookup will read the metadata of the bucket to get the neighborhood 
+ * bitmap and will only access the values it has to compare.
+ * 
+ * If StoreFingerprint is true, a third array stores a one byte fingerprint of the hash of each value 
+ * (see hash_fingerprint) followed by FINGERPRINTS_PADDING bytes so that the whole neighborhood 
+ * of a bucket can be compared with SIMD loads.
+ * 
+ * The interface is a subset of the one of std::vector used by hopscotch_hash.
+ */
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, bool StoreFingerprint, class Allocator>
+class hopscotch_split_buckets {
+private:
+    using bucket_infos = hopscotch_bucket_infos<NeighborhoodSize, StoreHash>;
+    
+    using infos_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<bucket_infos>;
+    using infos_container_type = std::vector<bucket_infos, infos_allocator>;
+    
+    using values_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ValueType>;
+    using values_allocator_traits = std::allocator_traits<values_allocator>;
+    
+    using fingerprints_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint8_t>;
+    using fingerprints_container_type = std::vector<std::uint8_t, fingerprints_allocator>;
+    
+public:
+    using value_type = ValueType;
+    using size_type = std::size_t;
+    using allocator_type = infos_allocator;
+    using reference = hopscotch_split_bucket_reference<ValueType, NeighborhoodSize, StoreHash, 
+                                                       StoreFingerprint, false>;
+    using const_reference = hopscotch_split_bucket_reference<ValueType, NeighborhoodSize, StoreHash, 
+                                                             StoreFingerprint, true>;
+    using iterator = hopscotch_split_buckets_iterator<ValueType, NeighborhoodSize, StoreHash, 
+                                                      StoreFingerprint, false>;
+    using const_iterator = hopscotch_split_buckets_iterator<ValueType, NeighborhoodSize, StoreHash, 
+                                                            StoreFingerprint, true>;
+    
+    
+    explicit hopscotch_split_buckets(const Allocator& alloc): m_infos(infos_allocator(alloc)), 
+                                                              m_values_allocator(alloc),
+                                                              m_values(nullptr),
+                                                              m_fingerprints(fingerprints_allocator(alloc))
+    {
+    }
+    
+    hopscotch_split_buckets(const hopscotch_split_buckets& other): 
+                m_infos(std::allocator_traits<infos_allocator>::select_on_container_copy_construction(
+                                                                other.m_infos.get_allocator())),
+                m_values_allocator(values_allocator_traits::select_on_container_copy_construction(
+                                                                other.m_values_allocator)),
+                m_values(nullptr),
+                m_fingerprints(other.m_fingerprints)
+    {
+        // std::vector(size_type, const Allocator&) is only available since C++14
+        m_infos.resize(other.m_infos.size());
+        m_values = allocate_values(m_infos.size());
+        
+        size_type ibucket = 0;
+        try {
+            for(; ibucket < other.m_infos.size(); ibucket++) {
+                if(!other.m_infos[ibucket].empty()) {
+                    ::new (static_cast<void*>(m_values + ibucket)) value_type(other.m_values[ibucket]);
+                }
+                
+                m_infos[ibucket].copy_infos(other.m_infos[ibucket]);
+            }
+        }
+        catch(...) {
+            destroy_values(ibucket);
+            deallocate_values();
+            
+            throw;
+        }
+    }
+    
+    hopscotch_split_buckets(hopscotch_split_buckets&& other) noexcept: m_infos(std::move(other.m_infos)), 
+                                                                       m_values_allocator(other.m_values_allocator),
+                                                                       m_values(other.m_values),
+                                                                       m_fingerprints(std::move(other.m_fingerprints))
+    {
+        other.m_infos.clear();
+        other.m_values = nullptr;
+        other.m_fingerprints.clear();
+    }
+    
+    hopscotch_split_buckets& operator=(const hopscotch_split_buckets& other) {
+        if(this != &other) {
+            hopscotch_split_buckets tmp(other);
+            swap(tmp);
+        }
+        
+        return *this;
+    }
+    
+    hopscotch_split_buckets& operator=(hopscotch_split_buckets&& other) noexcept {
+        other.swap(*this);
+        
+        return *this;
+    }
+    
+    ~hopscotch_split_buckets() noexcept {
+        destroy_values(m_infos.size());
+        deallocate_values();
+    }
+    
+    allocator_type get_allocator() const {
+        return m_infos.get_allocator();
+    }
+    
+    /*
+     * Only used on an empty container by the constructors of hopscotch_hash.
+     */
+    void resize(size_type count) {
+        tsl_assert(m_infos.empty() && m_values == nullptr);
+        
+        m_values = allocate_values(count);
+        try {
+            m_infos.resize(count);
+            if(StoreFingerprint) {
+                m_fingerprints.resize(count + FINGERPRINTS_PADDING);
+            }
+        }
+        catch(...) {
+            deallocate_values();
+            m_infos.clear();
+            
+            throw;
+        }
+    }
+    
+    iterator begin() noexcept { 
+        return iterator(m_infos.data(), m_values, fingerprints_data()); 
+    }
+    
+    const_iterator begin() const noexcept { 
+        return cbegin(); 
+    }
+    
+    const_iterator cbegin() const noexcept { 
+        return const_iterator(m_infos.data(), m_values, fingerprints_data()); 
+    }
+    
+    iterator end() noexcept { 
+        return begin() + m_infos.size(); 
+    }
+    
+    const_iterator end() const noexcept { 
+        return cend(); 
+    }
+    
+    const_iterator cend() const noexcept { 
+        return cbegin() + m_infos.size(); 
+    }
+    
+    reference operator[](size_type ibucket) noexcept {
+        tsl_assert(ibucket < m_infos.size());
+        return *(begin() + ibucket);
+    }
+    
+    const_reference operator[](size_type ibucket) const noexcept {
+        tsl_assert(ibucket < m_infos.size());
+        return *(cbegin() + ibucket);
+    }
+    
+    /*
+     * Prefetch the metadata and the value of the bucket.
+     */
+    void prefetch(size_type ibucket) const noexcept {
+        tsl_assert(ibucket < m_infos.size());
+        tsl::detail_hopscotch_hash::prefetch(m_infos.data() + ibucket);
+        tsl::detail_hopscotch_hash::prefetch(m_values + ibucket);
+    }
+    
+    size_type size() const noexcept {
+        return m_infos.size();
+    }
+    
+    bool empty() const noexcept {
+        return m_infos.empty();
+    }
+    
+    size_type max_size() const noexcept {
+        return std::min(m_infos.max_size(), size_type(values_allocator_traits::max_size(m_values_allocator)));
+    }
+    
+    /*
+     * Bytes allocated for the metadata, the values and the fingerprints.
+     */
+    size_type memory_size() const noexcept {
+        return m_infos.capacity()*sizeof(bucket_infos) + m_infos.size()*sizeof(value_type) + 
+               m_fingerprints.capacity();
+    }
     
-    template<typename... Args>
-    void set_value_of_empty_bucket(std::size_t hash, Args&&... value_type_args) {
-        tsl_assert(empty());
+    void swap(hopscotch_split_buckets& other) noexcept {
+        using std::swap;
         
-        ::new (static_cast<void*>(std::addressof(m_value))) value_type(std::forward<Args>(value_type_args)...);
-        set_empty(false);
-        this->set_hash(hash);
+        swap(m_infos, other.m_infos);
+        swap(m_values_allocator, other.m_values_allocator);
+        swap(m_values, other.m_values);
+        swap(m_fingerprints, other.m_fingerprints);
     }
     
-    void swap_value_into_empty_bucket(hopscotch_bucket& empty_bucket) {
-        tsl_assert(empty_bucket.empty());
-        if(!empty()) {
-            ::new (static_cast<void*>(std::addressof(empty_bucket.m_value))) value_type(std::move(value()));
-            empty_bucket.copy_hash(*this);
-            empty_bucket.set_empty(false);
-            
-            destroy_value();
-            set_empty(true);
+    friend void swap(hopscotch_split_buckets& lhs, hopscotch_split_buckets& rhs) noexcept {
+        lhs.swap(rhs);
+    }
+    
+private:
+    value_type* allocate_values(size_type count) {
+        if(count == 0) {
+            return nullptr;
         }
+        
+        return std::addressof(*values_allocator_traits::allocate(m_values_allocator, count));
     }
     
-    void remove_value() noexcept {
-        if(!empty()) {
-            destroy_value();
-            set_empty(true);
+    void deallocate_values() noexcept {
+        if(m_values != nullptr) {
+            values_allocator_traits::deallocate(m_values_allocator, m_values, m_infos.size());
+            m_values = nullptr;
+        }
+    }
+    
+    void destroy_values(size_type count) noexcept {
+        for(size_type ibucket = 0; ibucket < count; ibucket++) {
+            if(!m_infos[ibucket].empty()) {
+                m_values[ibucket].~value_type();
+            }
         }
     }
     
+    std::uint8_t* fingerprints_data() noexcept {
+        return StoreFingerprint?m_fingerprints.data():nullptr;
+    }
+    
+    const std::uint8_t* fingerprints_data() const noexcept {
+        return StoreFingerprint?m_fingerprints.data():nullptr;
+    }
+    
+private:
+    infos_container_type m_infos;
+    values_allocator m_values_allocator;
+    value_type* m_values;
+    fingerprints_container_type m_fingerprints;
+};
+
+
+/*
+ * buckets_container<ValueType, NeighborhoodSize, StoreHash, Allocator, BucketLayout>::type is the 
+ * container of buckets used by hopscotch_hash for the BucketLayout.
+ */
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, class Allocator, class BucketLayout>
+struct buckets_container {
+};
+
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, class Allocator>
+struct buckets_container<ValueType, NeighborhoodSize, StoreHash, Allocator, tsl::interleaved_bucket_layout> {
+    using bucket = hopscotch_bucket<ValueType, NeighborhoodSize, StoreHash>;
+    using type = std::vector<bucket, typename std::allocator_traits<Allocator>::template rebind_alloc<bucket>>;
+};
+
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, class Allocator>
+struct buckets_container<ValueType, NeighborhoodSize, StoreHash, Allocator, tsl::split_bucket_layout> {
+    using type = hopscotch_split_buckets<ValueType, NeighborhoodSize, StoreHash, false, Allocator>;
+};
+
+template<typename ValueType, unsigned int NeighborhoodSize, bool StoreHash, class Allocator>
+struct buckets_container<ValueType, NeighborhoodSize, StoreHash, Allocator, tsl::fingerprint_bucket_layout> {
+    using type = hopscotch_split_buckets<ValueType, NeighborhoodSize, StoreHash, true, Allocator>;
+};
+
+/*
+ * Bytes allocated by a container of buckets.
+ */
+template<class Bucket, class Allocator>
+std::size_t buckets_memory_size(const std::vector<Bucket, Allocator>& buckets) noexcept {
+    return buckets.capacity()*sizeof(Bucket);
+}
+
+template<class Buckets>
+std::size_t buckets_memory_size(const Buckets& buckets) noexcept {
+    return buckets.memory_size();
+}
+
+
+
+/*
+ * Dense bitmap with one bit per bucket of hopscotch_hash, the bit of a bucket is set if the bucket contains a value.
+ * 
+ * It duplicates the information given by the empty() method of the buckets but 64 buckets fit in a word,
+ * find_empty_bucket and the iterators can skip full (respectively empty) buckets a word at a time with
+ * count_trailing_zeros without having to read the buckets themselves.
+ * 
+ * The bits after the last bucket in the last word are always 0.
+ */
+template<class Allocator>
+class hopscotch_occupancy_bitmap {
+public:
+    using word_type = std::uint_least64_t;
+    using size_type = std::size_t;
+    
+    static const size_type NB_BITS_IN_WORD = 64;
+    
+private:
+    using words_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<word_type>;
+    using words_container_type = std::vector<word_type, words_allocator>;
+    
+public:
+    explicit hopscotch_occupancy_bitmap(const Allocator& alloc): m_words(words_allocator(alloc)), m_nb_buckets(0) {
+    }
+    
+    hopscotch_occupancy_bitmap(const hopscotch_occupancy_bitmap& other) = default;
+    
+    hopscotch_occupancy_bitmap(hopscotch_occupancy_bitmap&& other) noexcept: m_words(std::move(other.m_words)),
+                                                                             m_nb_buckets(other.m_nb_buckets)
+    {
+        other.m_words.clear();
+        other.m_nb_buckets = 0;
+    }
+    
+    hopscotch_occupancy_bitmap& operator=(const hopscotch_occupancy_bitmap& other) = default;
+    
+    /*
+     * Resize the bitmap to nb_buckets empty buckets.
+     */
+    void resize(size_type nb_buckets) {
+        m_words.assign((nb_buckets + NB_BITS_IN_WORD - 1)/NB_BITS_IN_WORD, 0);
+        m_nb_buckets = nb_buckets;
+    }
+    
     void clear() noexcept {
-        if(!empty()) {
-            destroy_value();
+        std::fill(m_words.begin(), m_words.end(), word_type(0));
+    }
+    
+    void set(size_type ibucket) noexcept {
+        tsl_assert(ibucket < m_nb_buckets);
+        m_words[ibucket/NB_BITS_IN_WORD] |= word_type(1) << (ibucket % NB_BITS_IN_WORD);
+    }
+    
+    void reset(size_type ibucket) noexcept {
+        tsl_assert(ibucket < m_nb_buckets);
+        m_words[ibucket/NB_BITS_IN_WORD] &= ~(word_type(1) << (ibucket % NB_BITS_IN_WORD));
+    }
+    
+    bool test(size_type ibucket) const noexcept {
+        tsl_assert(ibucket < m_nb_buckets);
+        return ((m_words[ibucket/NB_BITS_IN_WORD] >> (ibucket % NB_BITS_IN_WORD)) & 1) == 1;
+    }
+    
+    /*
+     * Return the index of the first empty bucket in [ibucket, limit) or size() if none.
+     */
+    size_type find_next_empty(size_type ibucket, size_type limit) const noexcept {
+        tsl_assert(limit <= m_nb_buckets);
+        
+        while(ibucket < limit) {
+            const size_type ibit = ibucket % NB_BITS_IN_WORD;
+            const word_type empty_buckets = word_type(~m_words[ibucket/NB_BITS_IN_WORD]) >> ibit;
+            
+            if(empty_buckets != 0) {
+                const size_type ibucket_empty = ibucket + count_trailing_zeros(empty_buckets);
+                return (ibucket_empty < limit)?ibucket_empty:m_nb_buckets;
+            }
+            
+            ibucket += NB_BITS_IN_WORD - ibit;
         }
         
-        m_neighborhood_infos = 0;
-        tsl_assert(empty());
+        return m_nb_buckets;
     }
     
-    static std::size_t max_size() noexcept {
-        if(StoreHash) {
-            return std::numeric_limits<typename bucket_hash::hash_type>::max();
+    /*
+     * Return the index of the first bucket containing a value in [ibucket, nb_buckets) or nb_buckets if none.
+     * 
+     * Static as the iterators only keep a pointer to the words, which stays valid if the hopscotch_hash
+     * is moved or swapped.
+     */
+    static size_type find_next_occupied(const word_type* words, size_type ibucket, size_type nb_buckets) noexcept {
+        while(ibucket < nb_buckets) {
+            const size_type ibit = ibucket % NB_BITS_IN_WORD;
+            const word_type occupied_buckets = words[ibucket/NB_BITS_IN_WORD] >> ibit;
+            
+            if(occupied_buckets != 0) {
+                return ibucket + count_trailing_zeros(occupied_buckets);
+            }
+            
+            ibucket += NB_BITS_IN_WORD - ibit;
+        }
+        
+        return nb_buckets;
+    }
+    
+    size_type find_next_occupied(size_type ibucket) const noexcept {
+        return find_next_occupied(m_words.data(), ibucket, m_nb_buckets);
+    }
+    
+    const word_type* data() const noexcept {
+        return m_words.data();
+    }
+    
+    size_type size() const noexcept {
+        return m_nb_buckets;
+    }
+    
+    size_type memory_size() const noexcept {
+        return m_words.capacity()*sizeof(word_type);
+    }
+    
+    void swap(hopscotch_occupancy_bitmap& other) {
+        using std::swap;
+        
+        swap(m_words, other.m_words);
+        swap(m_nb_buckets, other.m_nb_buckets);
+    }
+    
+private:
+    words_container_type m_words;
+    size_type m_nb_buckets;
+};
+
+
+/*
+ * Try to swap the empty bucket ibucket_empty_in_out of buckets with a bucket preceding it while keeping 
+ * the neighborhood conditions correct. The occupancy bitmap of the buckets is updated accordingly.
+ * 
+ * If a swap was possible, the position of ibucket_empty_in_out will be closer to 0 and true will re returned.
+ * 
+ * Only the buckets in [ibucket_empty_in_out - NeighborhoodSize + 1, ibucket_empty_in_out] are read and modified.
+ */
+template<unsigned int NeighborhoodSize, class BucketsContainer, class OccupancyBitmap>
+bool swap_empty_bucket_closer(BucketsContainer& buckets, OccupancyBitmap& occupancy, 
+                              std::size_t& ibucket_empty_in_out) 
+{
+    tsl_assert(ibucket_empty_in_out >= NeighborhoodSize);
+    const std::size_t neighborhood_start = ibucket_empty_in_out - NeighborhoodSize + 1;
+    
+    for(std::size_t to_check = neighborhood_start; to_check < ibucket_empty_in_out; to_check++) {
+        auto neighborhood_infos = buckets[to_check].neighborhood_infos();
+        std::size_t to_swap = to_check;
+        
+        while(neighborhood_infos != 0 && to_swap < ibucket_empty_in_out) {
+            if((neighborhood_infos & 1) == 1) {
+                tsl_assert(buckets[ibucket_empty_in_out].empty());
+                tsl_assert(!buckets[to_swap].empty());
+                
+                buckets[to_swap].swap_value_into_empty_bucket(buckets[ibucket_empty_in_out]);
+                occupancy.set(ibucket_empty_in_out);
+                occupancy.reset(to_swap);
+                
+                tsl_assert(!buckets[to_check].check_neighbor_presence(ibucket_empty_in_out - to_check));
+                tsl_assert(buckets[to_check].check_neighbor_presence(to_swap - to_check));
+                
+                buckets[to_check].toggle_neighbor_presence(ibucket_empty_in_out - to_check);
+                buckets[to_check].toggle_neighbor_presence(to_swap - to_check);
+                
+                
+                ibucket_empty_in_out = to_swap;
+                
+                return true;
+            }
+            
+            to_swap++;
+            neighborhood_infos = decltype(neighborhood_infos)(neighborhood_infos >> 1);
+        }
+    }
+    
+    return false;
+}
+
+
+
+#ifdef TSL_HOPSCOTCH_COROUTINES
+/*
+ * Allocator of the coroutine frames of the interleaved lookups of hopscotch_hash. 
+ * 
+ * The frame of a finished lookup is kept in a free list and reused by the next lookup instead of going 
+ * through the global operator new each time. All the frames allocated by a pool are expected to have the same size,
+ * the blocks of other sizes are not reused. Each block starts with a header containing a pointer to its pool 
+ * (used to find the pool on deallocation) or to the next free block (while in the free list).
+ */
+class hopscotch_lookup_frame_pool {
+public:
+    hopscotch_lookup_frame_pool() noexcept: m_block_size(0), m_free_blocks(nullptr) {
+    }
+    
+    hopscotch_lookup_frame_pool(const hopscotch_lookup_frame_pool& other) = delete;
+    hopscotch_lookup_frame_pool& operator=(const hopscotch_lookup_frame_pool& other) = delete;
+    
+    ~hopscotch_lookup_frame_pool() {
+        while(m_free_blocks != nullptr) {
+            void* block = m_free_blocks;
+            m_free_blocks = header(block);
+            ::operator delete(block);
+        }
+    }
+    
+    void* allocate(std::size_t frame_size) {
+        const std::size_t block_size = HEADER_SIZE + frame_size;
+        
+        void* block;
+        if(m_free_blocks != nullptr && block_size == m_block_size) {
+            block = m_free_blocks;
+            m_free_blocks = header(block);
         }
         else {
-            return std::numeric_limits<std::size_t>::max();
+            block = ::operator new(block_size);
+            if(m_block_size == 0) {
+                m_block_size = block_size;
+            }
         }
+        
+        header(block) = this;
+        return static_cast<char*>(block) + HEADER_SIZE;
     }
     
-private:
-    void set_empty(bool is_empty) noexcept {
-        if(is_empty) {
-            m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos & ~1);
+    static void deallocate(void* frame, std::size_t frame_size) noexcept {
+        void* block = static_cast<char*>(frame) - HEADER_SIZE;
+        hopscotch_lookup_frame_pool& pool = *static_cast<hopscotch_lookup_frame_pool*>(header(block));
+        
+        if(HEADER_SIZE + frame_size == pool.m_block_size) {
+            header(block) = pool.m_free_blocks;
+            pool.m_free_blocks = block;
         }
         else {
-            m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos | 1);
+            ::operator delete(block);
         }
     }
     
-    void destroy_value() noexcept {
-        try {
-            tsl_assert(!empty());
-            
-            value().~value_type();
+private:
+    static void*& header(void* block) noexcept {
+        return *static_cast<void**>(block);
+    }
+    
+private:
+    static const std::size_t HEADER_SIZE = alignof(std::max_align_t);
+    static_assert(HEADER_SIZE >= sizeof(void*), "");
+    
+    std::size_t m_block_size;
+    void* m_free_blocks;
+};
+
+
+/*
+ * Coroutine of a lookup interleaved with other ones by hopscotch_hash::for_each_interleaved. The lookup starts
+ * as soon as the coroutine is called and suspends each time it has prefetched something it will need. 
+ * 
+ * The coroutine must be a member function of hopscotch_hash with a hopscotch_lookup_frame_pool& as first 
+ * parameter, its frame is allocated from this pool.
+ */
+class hopscotch_lookup_task {
+public:
+    class promise_type {
+    public:
+        hopscotch_lookup_task get_return_object() noexcept { 
+            return hopscotch_lookup_task(std::coroutine_handle<promise_type>::from_promise(*this)); 
         }
-        catch(...) {
-            std::terminate();
+        
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept { }
+        void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+        
+        template<class Object, class... Args>
+        static void* operator new(std::size_t frame_size, const Object& /*object*/, 
+                                  hopscotch_lookup_frame_pool& pool, const Args&... /*args*/) 
+        {
+            return pool.allocate(frame_size);
+        }
+        
+        static void operator delete(void* frame, std::size_t frame_size) noexcept {
+            hopscotch_lookup_frame_pool::deallocate(frame, frame_size);
+        }
+        
+    private:
+        friend class hopscotch_lookup_task;
+        
+        std::exception_ptr m_exception;
+    };
+    
+    hopscotch_lookup_task() noexcept: m_handle(nullptr) {
+    }
+    
+    hopscotch_lookup_task(const hopscotch_lookup_task& other) = delete;
+    
+    hopscotch_lookup_task(hopscotch_lookup_task&& other) noexcept: m_handle(other.m_handle) {
+        other.m_handle = nullptr;
+    }
+    
+    hopscotch_lookup_task& operator=(hopscotch_lookup_task&& other) noexcept {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    
+    ~hopscotch_lookup_task() {
+        if(m_handle) {
+            m_handle.destroy();
+        }
+    }
+    
+    bool done() const noexcept {
+        tsl_assert(m_handle);
+        return m_handle.done();
+    }
+    
+    /*
+     * Resume the lookup until its next suspension point.
+     */
+    void resume() {
+        tsl_assert(m_handle && !m_handle.done());
+        m_handle.resume();
+    }
+    
+    /*
+     * Rethrow the exception thrown by the lookup if there is one.
+     */
+    void rethrow_exception() const {
+        tsl_assert(m_handle && m_handle.done());
+        if(m_handle.promise().m_exception) {
+            std::rethrow_exception(m_handle.promise().m_exception);
         }
     }
     
 private:
-    using storage = typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type;
+    explicit hopscotch_lookup_task(std::coroutine_handle<promise_type> handle) noexcept: m_handle(handle) {
+    }
     
-    neighborhood_bitmap m_neighborhood_infos;
-    storage m_value;
+private:
+    std::coroutine_handle<promise_type> m_handle;
 };
+#endif
+
 
 
 /**
@@ -616,6 +2168,8 @@ private:
  * 
  * OverflowContainer will be used as containers for overflown elements. Usually it should be a list<ValueType>
  * or a set<Key>/map<Key, T>.
+ * 
+ * BucketLayout should be tsl::interleaved_bucket_layout, tsl::split_bucket_layout or tsl::fingerprint_bucket_layout.
  */
 template<class ValueType,
          class KeySelect,
@@ -626,7 +2180,8 @@ template<class ValueType,
          unsigned int NeighborhoodSize,
          bool StoreHash,
          class GrowthPolicy,
-         class OverflowContainer>
+         class OverflowContainer,
+         class BucketLayout>
 class hopscotch_hash: private Hash, private KeyEqual, private GrowthPolicy {
 private:
     template<typename U>
@@ -651,11 +2206,18 @@ public:
     using const_iterator = hopscotch_iterator<true>;
     
 private:
-    using hopscotch_bucket = tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize, StoreHash>;
-    using neighborhood_bitmap = typename hopscotch_bucket::neighborhood_bitmap;
+    using bucket_infos = tsl::detail_hopscotch_hash::hopscotch_bucket_infos<NeighborhoodSize, StoreHash>;
+    using neighborhood_bitmap = typename bucket_infos::neighborhood_bitmap;
+    
+    using buckets_container_type = typename tsl::detail_hopscotch_hash::buckets_container<ValueType, NeighborhoodSize, 
+                                                                                         StoreHash, Allocator, 
+                                                                                         BucketLayout>::type;
+    using occupancy_bitmap = tsl::detail_hopscotch_hash::hopscotch_occupancy_bitmap<Allocator>;
     
-    using buckets_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<hopscotch_bucket>;
-    using buckets_container_type = std::vector<hopscotch_bucket, buckets_allocator>;  
+#ifdef TSL_HOPSCOTCH_COROUTINES
+    using lookup_frame_pool = tsl::detail_hopscotch_hash::hopscotch_lookup_frame_pool;
+    using lookup_task = tsl::detail_hopscotch_hash::hopscotch_lookup_task;
+#endif
     
     using overflow_container_type = OverflowContainer;
     
@@ -690,13 +2252,24 @@ public:
         using iterator_overflow = typename std::conditional<is_const, 
                                                             typename hopscotch_hash::const_iterator_overflow, 
                                                             typename hopscotch_hash::iterator_overflow>::type;
+        using hopscotch_hash_pointer = typename std::conditional<is_const, 
+                                                                 const hopscotch_hash*, 
+                                                                 hopscotch_hash*>::type;
     
         
+        /*
+         * If rehash_source is not null, the iterator continues with the buckets of rehash_source 
+         * once it reaches buckets_end_iterator (see incremental_rehash).
+         */
         hopscotch_iterator(iterator_bucket buckets_iterator, iterator_bucket buckets_end_iterator, 
-                           iterator_overflow overflow_iterator) noexcept : 
+                           iterator_overflow overflow_iterator, const occupancy_bitmap& occupancy, 
+                           hopscotch_hash_pointer rehash_source = nullptr) noexcept : 
             m_buckets_iterator(buckets_iterator), m_buckets_end_iterator(buckets_end_iterator),
-            m_overflow_iterator(overflow_iterator)
+            m_overflow_iterator(overflow_iterator), 
+            m_occupancy(occupancy.data()), m_nb_buckets(occupancy.size()),
+            m_rehash_source(rehash_source)
         {
+            next_buckets_range_if_end();
         }
         
     public:
@@ -710,12 +2283,21 @@ public:
         hopscotch_iterator() noexcept {
         }
         
-        hopscotch_iterator(const hopscotch_iterator<false>& other) noexcept :
+        // Copy constructor from iterator to const_iterator.
+        template<bool TIsConst = is_const, typename std::enable_if<TIsConst>::type* = nullptr>
+        hopscotch_iterator(const hopscotch_iterator<!TIsConst>& other) noexcept :
             m_buckets_iterator(other.m_buckets_iterator), m_buckets_end_iterator(other.m_buckets_end_iterator),
-            m_overflow_iterator(other.m_overflow_iterator)
+            m_overflow_iterator(other.m_overflow_iterator), 
+            m_occupancy(other.m_occupancy), m_nb_buckets(other.m_nb_buckets),
+            m_rehash_source(other.m_rehash_source)
         {
         }
         
+        hopscotch_iterator(const hopscotch_iterator& other) = default;
+        hopscotch_iterator(hopscotch_iterator&& other) = default;
+        hopscotch_iterator& operator=(const hopscotch_iterator& other) = default;
+        hopscotch_iterator& operator=(hopscotch_iterator&& other) = default;
+        
         const typename hopscotch_hash::key_type& key() const {
             if(m_buckets_iterator != m_buckets_end_iterator) {
                 return KeySelect()(m_buckets_iterator->value());
@@ -759,9 +2341,12 @@ public:
                 return *this;
             }
             
-            do {
-                ++m_buckets_iterator;
-            } while(m_buckets_iterator != m_buckets_end_iterator && m_buckets_iterator->empty());
+            // Jump directly to the next non-empty bucket (or the end) with the occupancy bitmap.
+            const std::size_t ibucket = m_nb_buckets - std::size_t(m_buckets_end_iterator - m_buckets_iterator);
+            const std::size_t ibucket_next = occupancy_bitmap::find_next_occupied(m_occupancy, ibucket + 1, 
+                                                                                  m_nb_buckets);
+            m_buckets_iterator += difference_type(ibucket_next - ibucket);
+            next_buckets_range_if_end();
             
             return *this; 
         }
@@ -774,18 +2359,46 @@ public:
         }
         
         friend bool operator==(const hopscotch_iterator& lhs, const hopscotch_iterator& rhs) { 
-            return lhs.m_buckets_iterator == rhs.m_buckets_iterator && 
-                   lhs.m_overflow_iterator == rhs.m_overflow_iterator; 
+            const bool lhs_in_overflow = lhs.m_buckets_iterator == lhs.m_buckets_end_iterator;
+            if(lhs_in_overflow != (rhs.m_buckets_iterator == rhs.m_buckets_end_iterator)) {
+                return false;
+            }
+            
+            // The bucket iterators may come from the buckets of the old table during an incremental rehash,
+            // use the occupancy bitmap to check that both come from the same table before comparing them.
+            return lhs_in_overflow?lhs.m_overflow_iterator == rhs.m_overflow_iterator:
+                                   lhs.m_occupancy == rhs.m_occupancy && 
+                                   lhs.m_buckets_iterator == rhs.m_buckets_iterator; 
         }
         
         friend bool operator!=(const hopscotch_iterator& lhs, const hopscotch_iterator& rhs) { 
             return !(lhs == rhs); 
         }
         
+    private:
+        /*
+         * Go to the first non-empty bucket of m_rehash_source if we are at the end of the current buckets.
+         */
+        void next_buckets_range_if_end() noexcept {
+            if(m_buckets_iterator == m_buckets_end_iterator && m_rehash_source != nullptr) {
+                m_buckets_iterator = m_rehash_source->m_buckets.begin() + 
+                                     m_rehash_source->m_occupancy.find_next_occupied(0);
+                m_buckets_end_iterator = m_rehash_source->m_buckets.end();
+                m_occupancy = m_rehash_source->m_occupancy.data();
+                m_nb_buckets = m_rehash_source->m_occupancy.size();
+                m_rehash_source = nullptr;
+            }
+        }
+        
     private:
         iterator_bucket m_buckets_iterator;
         iterator_bucket m_buckets_end_iterator;
         iterator_overflow m_overflow_iterator;
+        
+        const typename occupancy_bitmap::word_type* m_occupancy;
+        std::size_t m_nb_buckets;
+        
+        hopscotch_hash_pointer m_rehash_source;
     };
     
 
@@ -800,8 +2413,13 @@ public:
                                             KeyEqual(equal),
                                             GrowthPolicy(bucket_count),
                                             m_buckets(alloc), 
+                                            m_occupancy(alloc),
                                             m_overflow_elements(alloc),
-                                            m_nb_elements(0)
+                                            m_nb_elements(0),
+                                            m_min_load_factor(0.0f),
+                                            m_try_shrink_on_next_insert(false),
+                                            m_incremental_rehash(false),
+                                            m_rehash_source_ibucket(0)
     {
         if(bucket_count > max_bucket_count()) {
             throw std::length_error("The map exceeds its maxmimum size.");
@@ -809,6 +2427,7 @@ public:
         
         static_assert(NeighborhoodSize - 1 > 0, "");
         m_buckets.resize(bucket_count + NeighborhoodSize - 1);
+        m_occupancy.resize(m_buckets.size());
         
         
         this->max_load_factor(max_load_factor);
@@ -824,8 +2443,13 @@ public:
                                                           KeyEqual(equal),
                                                           GrowthPolicy(bucket_count),
                                                           m_buckets(alloc), 
+                                                          m_occupancy(alloc),
                                                           m_overflow_elements(comp, alloc),
-                                                          m_nb_elements(0)
+                                                          m_nb_elements(0),
+                                                          m_min_load_factor(0.0f),
+                                                          m_try_shrink_on_next_insert(false),
+                                                          m_incremental_rehash(false),
+                                                          m_rehash_source_ibucket(0)
     {
         
         if(bucket_count > max_bucket_count()) {
@@ -837,12 +2461,30 @@ public:
         // Can't directly construct with the appropriate size in the initializer 
         // as m_buckets(bucket_count, alloc) is not supported by GCC 4.8
         m_buckets.resize(bucket_count + NeighborhoodSize - 1);
+        m_occupancy.resize(m_buckets.size());
         
         
         this->max_load_factor(max_load_factor);
     }
     
-    hopscotch_hash(const hopscotch_hash& other) = default;
+    hopscotch_hash(const hopscotch_hash& other): 
+                          Hash(static_cast<const Hash&>(other)),
+                          KeyEqual(static_cast<const KeyEqual&>(other)),
+                          GrowthPolicy(static_cast<const GrowthPolicy&>(other)),
+                          m_buckets(other.m_buckets),
+                          m_occupancy(other.m_occupancy),
+                          m_overflow_elements(other.m_overflow_elements),
+                          m_nb_elements(other.m_nb_elements),
+                          m_max_load_factor(other.m_max_load_factor),
+                          m_load_threshold(other.m_load_threshold),
+                          m_min_load_factor_rehash_threshold(other.m_min_load_factor_rehash_threshold),
+                          m_min_load_factor(other.m_min_load_factor),
+                          m_try_shrink_on_next_insert(other.m_try_shrink_on_next_insert),
+                          m_incremental_rehash(other.m_incremental_rehash),
+                          m_rehash_source(other.copy_rehash_source()),
+                          m_rehash_source_ibucket(other.m_rehash_source_ibucket)
+    {
+    }
     
     hopscotch_hash(hopscotch_hash&& other) 
                         noexcept(
@@ -850,22 +2492,51 @@ public:
                             std::is_nothrow_move_constructible<KeyEqual>::value &&
                             std::is_nothrow_move_constructible<GrowthPolicy>::value &&
                             std::is_nothrow_move_constructible<buckets_container_type>::value &&
+                            std::is_nothrow_move_constructible<occupancy_bitmap>::value &&
                             std::is_nothrow_move_constructible<overflow_container_type>::value
                         )
                         : Hash(std::move(static_cast<Hash&>(other))),
                           KeyEqual(std::move(static_cast<KeyEqual&>(other))),
                           GrowthPolicy(std::move(static_cast<GrowthPolicy&>(other))),
                           m_buckets(std::move(other.m_buckets)),
+                          m_occupancy(std::move(other.m_occupancy)),
                           m_overflow_elements(std::move(other.m_overflow_elements)),
                           m_nb_elements(other.m_nb_elements),
                           m_max_load_factor(other.m_max_load_factor),
                           m_load_threshold(other.m_load_threshold),
-                          m_min_load_factor_rehash_threshold(other.m_min_load_factor_rehash_threshold)
+                          m_min_load_factor_rehash_threshold(other.m_min_load_factor_rehash_threshold),
+                          m_min_load_factor(other.m_min_load_factor),
+                          m_try_shrink_on_next_insert(other.m_try_shrink_on_next_insert),
+                          m_incremental_rehash(other.m_incremental_rehash),
+                          m_rehash_source(std::move(other.m_rehash_source)),
+                          m_rehash_source_ibucket(other.m_rehash_source_ibucket)
     {
         other.clear();
     }
     
-    hopscotch_hash& operator=(const hopscotch_hash& other) = default;
+    hopscotch_hash& operator=(const hopscotch_hash& other) {
+        if(&other != this) {
+            std::unique_ptr<hopscotch_hash> rehash_source = other.copy_rehash_source();
+            
+            static_cast<Hash&>(*this) = static_cast<const Hash&>(other);
+            static_cast<KeyEqual&>(*this) = static_cast<const KeyEqual&>(other);
+            static_cast<GrowthPolicy&>(*this) = static_cast<const GrowthPolicy&>(other);
+            m_buckets = other.m_buckets;
+            m_occupancy = other.m_occupancy;
+            m_overflow_elements = other.m_overflow_elements;
+            m_nb_elements = other.m_nb_elements;
+            m_max_load_factor = other.m_max_load_factor;
+            m_load_threshold = other.m_load_threshold;
+            m_min_load_factor_rehash_threshold = other.m_min_load_factor_rehash_threshold;
+            m_min_load_factor = other.m_min_load_factor;
+            m_try_shrink_on_next_insert = other.m_try_shrink_on_next_insert;
+            m_incremental_rehash = other.m_incremental_rehash;
+            m_rehash_source = std::move(rehash_source);
+            m_rehash_source_ibucket = other.m_rehash_source_ibucket;
+        }
+        
+        return *this;
+    }
     
     hopscotch_hash& operator=(hopscotch_hash&& other) {
         other.swap(*this);
@@ -883,12 +2554,8 @@ public:
      * Iterators
      */
     iterator begin() noexcept {
-        auto begin = m_buckets.begin();
-        while(begin != m_buckets.end() && begin->empty()) {
-            ++begin;
-        }
-        
-        return iterator(begin, m_buckets.end(), m_overflow_elements.begin());
+        auto begin = m_buckets.begin() + m_occupancy.find_next_occupied(0);
+        return iterator(begin, m_buckets.end(), m_overflow_elements.begin(), m_occupancy, m_rehash_source.get());
     }
     
     const_iterator begin() const noexcept {
@@ -896,16 +2563,13 @@ public:
     }
     
     const_iterator cbegin() const noexcept {
-        auto begin = m_buckets.cbegin();
-        while(begin != m_buckets.cend() && begin->empty()) {
-            ++begin;
-        }
-        
-        return const_iterator(begin, m_buckets.cend(), m_overflow_elements.cbegin());
+        auto begin = m_buckets.cbegin() + m_occupancy.find_next_occupied(0);
+        return const_iterator(begin, m_buckets.cend(), m_overflow_elements.cbegin(), m_occupancy, 
+                              m_rehash_source.get());
     }
     
     iterator end() noexcept {
-        return iterator(m_buckets.end(), m_buckets.end(), m_overflow_elements.end());
+        return iterator(m_buckets.end(), m_buckets.end(), m_overflow_elements.end(), m_occupancy);
     }
     
     const_iterator end() const noexcept {
@@ -913,7 +2577,7 @@ public:
     }
     
     const_iterator cend() const noexcept {
-        return const_iterator(m_buckets.cend(), m_buckets.cend(), m_overflow_elements.cend());
+        return const_iterator(m_buckets.cend(), m_buckets.cend(), m_overflow_elements.cend(), m_occupancy);
     }
     
     
@@ -921,27 +2585,31 @@ public:
      * Capacity
      */
     bool empty() const noexcept {
-        return m_nb_elements == 0;
+        return size() == 0;
     }
     
     size_type size() const noexcept {
-        return m_nb_elements;
+        return (m_rehash_source != nullptr)?m_nb_elements + m_rehash_source->m_nb_elements:m_nb_elements;
     }
     
     size_type max_size() const noexcept {
-        return hopscotch_bucket::max_size();
+        return bucket_infos::max_size();
     }
     
     /*
      * Modifiers
      */
     void clear() noexcept {
-        for(auto& bucket : m_buckets) {
-            bucket.clear();
+        for(auto it_bucket = m_buckets.begin(); it_bucket != m_buckets.end(); ++it_bucket) {
+            it_bucket->clear();
         }
         
+        m_occupancy.clear();
         m_overflow_elements.clear();
         m_nb_elements = 0;
+        
+        m_rehash_source.reset();
+        m_rehash_source_ibucket = 0;
     }
     
     
@@ -997,9 +2665,7 @@ public:
             }
         }
         
-        for(; first != last; ++first) {
-            insert(*first);
-        }
+        insert_bulk(first, last);
     }
     
     
@@ -1084,17 +2750,28 @@ public:
     }
     
     iterator erase(const_iterator pos) {
+        m_try_shrink_on_next_insert = true;
+        
         const std::size_t ibucket_for_hash = bucket_for_hash(hash_key(pos.key()));
         
-        if(pos.m_buckets_iterator != pos.m_buckets_end_iterator) {
+        if(pos.m_buckets_iterator != pos.m_buckets_end_iterator && !is_in_rehash_source(pos)) {
             auto it_bucket = m_buckets.begin() + std::distance(m_buckets.cbegin(), pos.m_buckets_iterator);
             erase_from_bucket(it_bucket, ibucket_for_hash);
             
-            return ++iterator(it_bucket, m_buckets.end(), m_overflow_elements.begin()); 
+            return ++iterator(it_bucket, m_buckets.end(), m_overflow_elements.begin(), m_occupancy, 
+                              m_rehash_source.get()); 
+        }
+        else if(pos.m_buckets_iterator != pos.m_buckets_end_iterator) {
+            hopscotch_hash& source = *m_rehash_source;
+            auto it_bucket = source.m_buckets.begin() + std::distance(source.m_buckets.cbegin(), 
+                                                                      pos.m_buckets_iterator);
+            source.erase_from_bucket(it_bucket, source.bucket_for_hash(hash_key(pos.key())));
+            
+            return ++iterator(it_bucket, source.m_buckets.end(), m_overflow_elements.begin(), source.m_occupancy);
         }
         else {
             auto it_next_overflow = erase_from_overflow(pos.m_overflow_iterator, ibucket_for_hash);
-            return iterator(m_buckets.end(), m_buckets.end(), it_next_overflow);
+            return iterator(m_buckets.end(), m_buckets.end(), it_next_overflow, m_occupancy);
         }
     }
     
@@ -1118,6 +2795,8 @@ public:
     
     template<class K>
     size_type erase(const K& key, std::size_t hash) {
+        m_try_shrink_on_next_insert = true;
+        
         const std::size_t ibucket_for_hash = bucket_for_hash(hash);
         
         auto it_find = find_in_buckets(key, hash, m_buckets.begin() + ibucket_for_hash);
@@ -1136,6 +2815,18 @@ public:
             }
         }
         
+        if(m_rehash_source != nullptr) {
+            hopscotch_hash& source = *m_rehash_source;
+            const std::size_t ibucket_for_hash_source = source.bucket_for_hash(hash);
+            
+            auto it_find_source = source.find_in_buckets(key, hash, source.m_buckets.begin() + ibucket_for_hash_source);
+            if(it_find_source != source.m_buckets.end()) {
+                source.erase_from_bucket(it_find_source, ibucket_for_hash_source);
+                
+                return 1;
+            }
+        }
+        
         return 0;
     }
     
@@ -1146,11 +2837,17 @@ public:
         swap(static_cast<KeyEqual&>(*this), static_cast<KeyEqual&>(other));
         swap(static_cast<GrowthPolicy&>(*this), static_cast<GrowthPolicy&>(other));
         swap(m_buckets, other.m_buckets);
+        m_occupancy.swap(other.m_occupancy);
         swap(m_overflow_elements, other.m_overflow_elements);
         swap(m_nb_elements, other.m_nb_elements);
         swap(m_max_load_factor, other.m_max_load_factor);
         swap(m_load_threshold, other.m_load_threshold);
         swap(m_min_load_factor_rehash_threshold, other.m_min_load_factor_rehash_threshold);
+        swap(m_min_load_factor, other.m_min_load_factor);
+        swap(m_try_shrink_on_next_insert, other.m_try_shrink_on_next_insert);
+        swap(m_incremental_rehash, other.m_incremental_rehash);
+        swap(m_rehash_source, other.m_rehash_source);
+        swap(m_rehash_source_ibucket, other.m_rehash_source_ibucket);
     }
     
     
@@ -1226,126 +2923,592 @@ public:
     iterator find(const K& key, std::size_t hash) {
         return find_impl(key, hash, m_buckets.begin() + bucket_for_hash(hash));
     }
-    
-    
-    template<class K>
-    const_iterator find(const K& key) const {
-        return find(key, hash_key(key));
+    
+    
+    template<class K>
+    const_iterator find(const K& key) const {
+        return find(key, hash_key(key));
+    }
+    
+    template<class K>
+    const_iterator find(const K& key, std::size_t hash) const {
+        return find_impl(key, hash, m_buckets.begin() + bucket_for_hash(hash));
+    }
+    
+    
+    template<class K>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return equal_range(key, hash_key(key));
+    }
+    
+    template<class K>
+    std::pair<iterator, iterator> equal_range(const K& key, std::size_t hash) {
+        iterator it = find(key, hash);
+        return std::make_pair(it, (it == end())?it:std::next(it));
+    }
+    
+    
+    template<class K>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return equal_range(key, hash_key(key));
+    }
+    
+    template<class K>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key, std::size_t hash) const {
+        const_iterator it = find(key, hash);
+        return std::make_pair(it, (it == cend())?it:std::next(it));
+    }
+    
+    
+    template<class K>
+    void prefetch(const K& key) const {
+        prefetch(key, hash_key(key));
+    }
+    
+    template<class K>
+    void prefetch(const K& /*key*/, std::size_t hash) const noexcept {
+        prefetch_bucket(bucket_for_hash(hash));
+    }
+    
+    
+    /*
+     * Batch lookups, the keys of [first, last) are looked up in order with for_each_prefetched 
+     * and the result of each lookup is written in out. Return the output iterator after the last result.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        using K = typename std::iterator_traits<ForwardIt>::value_type;
+        
+        for_each_prefetched(first, last, [&](const K& key) { return hash_key(key); },
+                            [&](ForwardIt it, std::size_t hash) { *out = find(*it, hash); ++out; });
+        return out;
+    }
+    
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        using K = typename std::iterator_traits<ForwardIt>::value_type;
+        
+        for_each_prefetched(first, last, [&](const K& key) { return hash_key(key); },
+                            [&](ForwardIt it, std::size_t hash) { *out = find(*it, hash); ++out; });
+        return out;
+    }
+    
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        using K = typename std::iterator_traits<ForwardIt>::value_type;
+        
+        for_each_prefetched(first, last, [&](const K& key) { return hash_key(key); },
+                            [&](ForwardIt it, std::size_t hash) { *out = count(*it, hash); ++out; });
+        return out;
+    }
+    
+    template<class ForwardIt, class OutputIt, class U = ValueSelect, 
+             typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    OutputIt at_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        using K = typename std::iterator_traits<ForwardIt>::value_type;
+        
+        for_each_prefetched(first, last, [&](const K& key) { return hash_key(key); },
+                            [&](ForwardIt it, std::size_t hash) { *out = at(*it, hash); ++out; });
+        return out;
+    }
+    
+#ifdef TSL_HOPSCOTCH_COROUTINES
+    /*
+     * Same as find_batch and count_batch but the lookups are interleaved with for_each_interleaved.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight) {
+        for_each_interleaved(first, last, nb_in_flight, 
+                             [&](const_iterator it) { *out = mutable_iterator(it); ++out; });
+        return out;
+    }
+    
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight) const {
+        for_each_interleaved(first, last, nb_in_flight, [&](const_iterator it) { *out = it; ++out; });
+        return out;
+    }
+    
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight) const {
+        for_each_interleaved(first, last, nb_in_flight, 
+                             [&](const_iterator it) { *out = size_type((it != cend())?1:0); ++out; });
+        return out;
+    }
+    
+#endif
+    /*
+     * Bucket interface 
+     */
+    size_type bucket_count() const {
+        /*
+         * So that the last bucket can have NeighborhoodSize neighbors, the size of the bucket array is a little
+         * bigger than the real number of buckets. We could use some of the buckets at the beginning, but
+         * it is easier this way and we avoid weird behaviour with iterators.
+         */
+        return m_buckets.size() - NeighborhoodSize + 1; 
+    }
+    
+    size_type max_bucket_count() const {
+        const std::size_t max_bucket_count = std::min(GrowthPolicy::max_bucket_count(), m_buckets.max_size());
+        return max_bucket_count - NeighborhoodSize + 1;
+    }
+    
+    
+    /*
+     *  Hash policy 
+     */
+    float load_factor() const {
+        return float(size())/float(bucket_count());
+    }
+    
+    float max_load_factor() const {
+        return m_max_load_factor;
+    }
+    
+    void max_load_factor(float ml) {
+        m_max_load_factor = ml;
+        m_load_threshold = size_type(float(bucket_count())*m_max_load_factor);
+        m_min_load_factor_rehash_threshold = size_type(bucket_count()*MIN_LOAD_FACTOR_FOR_REHASH);
+        
+        m_min_load_factor = std::min(m_min_load_factor, m_max_load_factor*MAXIMUM_MIN_TO_MAX_LOAD_FACTOR_RATIO);
+    }
+    
+    float min_load_factor() const {
+        return m_min_load_factor;
+    }
+    
+    void min_load_factor(float ml) {
+        m_min_load_factor = std::min({std::max(ml, 0.0f), float(MAXIMUM_MIN_LOAD_FACTOR), 
+                                      m_max_load_factor*MAXIMUM_MIN_TO_MAX_LOAD_FACTOR_RATIO});
+    }
+    
+    void rehash(size_type count_) {
+        complete_incremental_rehash();
+        
+        count_ = std::max(count_, size_type(std::ceil(float(size())/max_load_factor())));
+        rehash_impl(count_);
+    }
+    
+    /*
+     * Same as rehash but the values are moved into the new buckets by nb_threads threads when possible, 
+     * see move_buckets_in_parallel. Use std::thread::hardware_concurrency() threads if nb_threads is 0.
+     */
+    void parallel_rehash(size_type count_, std::size_t nb_threads) {
+        complete_incremental_rehash();
+        
+        if(nb_threads == 0) {
+            nb_threads = std::thread::hardware_concurrency();
+        }
+        
+        count_ = std::max(count_, size_type(std::ceil(float(size())/max_load_factor())));
+        rehash_impl(count_, nb_threads);
+    }
+    
+    void reserve(size_type count_) {
+        rehash(size_type(std::ceil(float(count_)/max_load_factor())));
+    }
+    
+    void shrink_to_fit() {
+        complete_incremental_rehash();
+        shrink_impl(size(), max_load_factor());
+    }
+    
+    bool incremental_rehash() const noexcept {
+        return m_incremental_rehash;
+    }
+    
+    void incremental_rehash(bool enable) {
+        if(!enable) {
+            complete_incremental_rehash();
+        }
+        
+        m_incremental_rehash = enable;
+    }
+    
+    bool rehash_in_progress() const noexcept {
+        return m_rehash_source != nullptr;
+    }
+    
+    bool rehash_step(size_type count_) {
+        if(m_rehash_source != nullptr) {
+            migrate_rehash_source(count_);
+        }
+        
+        return m_rehash_source != nullptr;
+    }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const {
+        return static_cast<Hash>(*this);
+    }
+    
+    key_equal key_eq() const {
+        return static_cast<KeyEqual>(*this);
+    }
+    
+    /*
+     * Other
+     */
+    iterator mutable_iterator(const_iterator pos) {
+        if(pos.m_buckets_iterator != pos.m_buckets_end_iterator && !is_in_rehash_source(pos)) {
+            // Get a non-const iterator
+            auto it = m_buckets.begin() + std::distance(m_buckets.cbegin(), pos.m_buckets_iterator);
+            return iterator(it, m_buckets.end(), m_overflow_elements.begin(), m_occupancy, m_rehash_source.get());
+        }
+        else if(pos.m_buckets_iterator != pos.m_buckets_end_iterator) {
+            // Get a non-const iterator
+            hopscotch_hash& source = *m_rehash_source;
+            auto it = source.m_buckets.begin() + std::distance(source.m_buckets.cbegin(), pos.m_buckets_iterator);
+            return iterator(it, source.m_buckets.end(), m_overflow_elements.begin(), source.m_occupancy);
+        }
+        else {
+            // Get a non-const iterator
+            auto it = mutable_overflow_iterator(pos.m_overflow_iterator);
+            
+            return iterator(m_buckets.end(), m_buckets.end(), it, m_occupancy);
+        }
+    }
+    
+    size_type overflow_size() const noexcept {
+        return m_overflow_elements.size();
+    }
+    
+    template<class U = OverflowContainer, typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
+    typename U::key_compare key_comp() const {
+        return m_overflow_elements.key_comp();
+    }
+    
+    /*
+     * Walk the buckets (and the ones of the rehash source if any) to get their displacement and 
+     * neighborhood fill histograms, O(bucket_count()).
+     */
+    tsl::hopscotch_stats stats() const {
+        tsl::hopscotch_stats stats;
+        stats.displacement_histogram.assign(NeighborhoodSize, 0);
+        stats.neighborhood_fill_histogram.assign(NeighborhoodSize + 1, 0);
+        
+        add_buckets_stats(stats);
+        if(m_rehash_source != nullptr) {
+            m_rehash_source->add_buckets_stats(stats);
+        }
+        
+        const std::size_t nb_links = has_key_compare<OverflowContainer>::value?4:2;
+        stats.nb_overflow_elements = m_overflow_elements.size();
+        stats.overflow_memory_size = m_overflow_elements.size()*(sizeof(value_type) + nb_links*sizeof(void*));
+        
+        return stats;
+    }
+    
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+    tsl::hopscotch_counters counters() const noexcept {
+        return m_counters.get();
+    }
+    
+    void reset_counters() noexcept {
+        m_counters.reset();
+    }
+#endif
+
+
+    /*
+     * Serialization
+     *
+     * Format: header (protocol version, NeighborhoodSize, StoreHash, bucket layout, size of the raw values
+     * or 0), bucket_count, number of elements in the buckets and overflow list, number of values still in
+     * the buckets of an incremental rehash in progress, max and min load factors. Then for each bucket of
+     * m_buckets its bitmap with the reserved bits and, if it has a value, its stored hash if StoreHash,
+     * its fingerprint with tsl::fingerprint_bucket_layout and its value. Then the overflow elements and
+     * the values of the rehash source.
+     */
+    template<class Serializer>
+    void serialize(Serializer& serializer) const {
+        using raw_values = std::integral_constant<bool, use_raw_bytes_serialization<Serializer, const char*>()>;
+
+        serialize_u64(serializer, SERIALIZATION_PROTOCOL_VERSION);
+        serialize_u64(serializer, NeighborhoodSize);
+        serialize_u64(serializer, StoreHash?1:0);
+        serialize_u64(serializer, bucket_layout_id());
+        serialize_u64(serializer, raw_values::value?sizeof(value_type):0);
+
+        serialize_u64(serializer, bucket_count());
+        serialize_u64(serializer, m_nb_elements - m_overflow_elements.size());
+        serialize_u64(serializer, m_overflow_elements.size());
+        serialize_u64(serializer, (m_rehash_source != nullptr)?m_rehash_source->m_nb_elements:0);
+        serializer(m_max_load_factor);
+        serializer(m_min_load_factor);
+
+        for(auto it_bucket = m_buckets.cbegin(); it_bucket != m_buckets.cend(); ++it_bucket) {
+            const std::uint_least64_t infos = (std::uint_least64_t(it_bucket->neighborhood_infos()) <<
+                                                   NB_RESERVED_BITS_IN_NEIGHBORHOOD) |
+                                              (it_bucket->has_overflow()?2:0) | (it_bucket->empty()?0:1);
+            serialize_u64(serializer, infos);
+
+            if(!it_bucket->empty()) {
+                if(StoreHash) {
+                    serializer(std::uint32_t(it_bucket->truncated_bucket_hash()));
+                }
+
+                if(STORE_FINGERPRINT) {
+                    serializer(bucket_fingerprint(*it_bucket, std::integral_constant<bool, STORE_FINGERPRINT>()));
+                }
+
+                serialize_value(serializer, it_bucket->value(), raw_values());
+            }
+        }
+
+        for(const value_type& value: m_overflow_elements) {
+            serialize_value(serializer, value, raw_values());
+        }
+
+        if(m_rehash_source != nullptr) {
+            const hopscotch_hash& source = *m_rehash_source;
+            for(std::size_t ibucket = source.m_occupancy.find_next_occupied(0); ibucket < source.m_buckets.size();
+                ibucket = source.m_occupancy.find_next_occupied(ibucket + 1))
+            {
+                serialize_value(serializer, source.m_buckets[ibucket].value(), raw_values());
+            }
+        }
+    }
+
+    /*
+     * Replace the content of the hash table, which must be empty, by the serialized one.
+     *
+     * If hash_compatible is true, the buckets are restored as they were serialized without hashing
+     * any key, the hash function, the growth policy and the template parameters must be the same as the ones
+     * of the serialized table (std::runtime_error is thrown if the parameters stored in the header differ).
+     * Otherwise the values are inserted one by one.
+     */
+    template<class Deserializer>
+    void deserialize(Deserializer& deserializer, bool hash_compatible) {
+        using raw_values = std::integral_constant<bool, use_raw_bytes_serialization<Deserializer, char*>()>;
+        tsl_assert(empty());
+
+        if(deserialize_u64(deserializer) != SERIALIZATION_PROTOCOL_VERSION) {
+            throw std::runtime_error("Can't deserialize the hash table, the protocol version of the header is "
+                                     "not supported.");
+        }
+
+        const std::uint_least64_t neighborhood_size = deserialize_u64(deserializer);
+        const bool store_hash = deserialize_u64(deserializer) != 0;
+        const std::uint_least64_t bucket_layout = deserialize_u64(deserializer);
+        const std::uint_least64_t raw_values_size = deserialize_u64(deserializer);
+        if(raw_values_size != (raw_values::value?sizeof(value_type):0)) {
+            throw std::runtime_error("Can't deserialize the hash table, the values were not serialized as raw bytes "
+                                     "of the same size as the values of the deserializer.");
+        }
+
+        const std::uint_least64_t serialized_bucket_count = deserialize_u64(deserializer);
+        const std::uint_least64_t nb_elements_in_buckets = deserialize_u64(deserializer);
+        const std::uint_least64_t nb_overflow_elements = deserialize_u64(deserializer);
+        const std::uint_least64_t nb_rehash_source_elements = deserialize_u64(deserializer);
+        const float max_load_factor = deserializer.template operator()<float>();
+        const float min_load_factor = deserializer.template operator()<float>();
+
+        if(serialized_bucket_count > max_bucket_count()) {
+            throw std::runtime_error("Can't deserialize the hash table, the bucket count is too big.");
+        }
+
+        const bool same_parameters = neighborhood_size == NeighborhoodSize && store_hash == StoreHash &&
+                                     bucket_layout == bucket_layout_id();
+        if(hash_compatible && !same_parameters) {
+            throw std::runtime_error("Can't deserialize the hash table as hash compatible, the template parameters "
+                                     "of the serialized table are different.");
+        }
+
+        const size_type nb_elements = size_type(nb_elements_in_buckets + nb_overflow_elements +
+                                                nb_rehash_source_elements);
+        hopscotch_hash new_map = new_hopscotch_hash(hash_compatible?size_type(serialized_bucket_count):0);
+        new_map.max_load_factor(max_load_factor);
+        new_map.min_load_factor(min_load_factor);
+        if(hash_compatible && new_map.bucket_count() != serialized_bucket_count) {
+            throw std::runtime_error("Can't deserialize the hash table as hash compatible, the growth policy "
+                                     "doesn't give the serialized bucket count.");
+        }
+
+        if(!hash_compatible) {
+            new_map.reserve(nb_elements);
+        }
+
+
+        const std::uint_least64_t nb_buckets = serialized_bucket_count + neighborhood_size - 1;
+        for(std::uint_least64_t ibucket = 0; ibucket < nb_buckets; ibucket++) {
+            const std::uint_least64_t infos = deserialize_u64(deserializer);
+            if((infos & 1) == 0) {
+                if(hash_compatible && infos != 0) {
+                    new_map.restore_bucket_infos(size_type(ibucket), infos);
+                }
+
+                continue;
+            }
+
+            const std::size_t hash = store_hash?deserializer.template operator()<std::uint32_t>():0;
+            const std::uint8_t fingerprint = (bucket_layout == bucket_layout_id(tsl::fingerprint_bucket_layout()))?
+                                                 deserializer.template operator()<std::uint8_t>():0;
+
+            if(hash_compatible) {
+                new_map.restore_bucket_infos(size_type(ibucket), infos);
+
+                auto&& bucket = new_map.m_buckets[size_type(ibucket)];
+                bucket.set_value_of_empty_bucket(hash, deserialize_value(deserializer, raw_values()));
+                set_bucket_fingerprint(bucket, fingerprint, std::integral_constant<bool, STORE_FINGERPRINT>());
+
+                new_map.m_occupancy.set(size_type(ibucket));
+                new_map.m_nb_elements++;
+            }
+            else {
+                new_map.insert(deserialize_value(deserializer, raw_values()));
+            }
+        }
+
+        for(std::uint_least64_t i = 0; i < nb_overflow_elements; i++) {
+            if(hash_compatible) {
+                new_map.m_overflow_elements.insert(new_map.m_overflow_elements.end(),
+                                                   deserialize_value(deserializer, raw_values()));
+                new_map.m_nb_elements++;
+            }
+            else {
+                new_map.insert(deserialize_value(deserializer, raw_values()));
+            }
+        }
+
+        // The values of an incremental rehash in progress are not in their neighborhood, insert them
+        for(std::uint_least64_t i = 0; i < nb_rehash_source_elements; i++) {
+            new_map.insert(deserialize_value(deserializer, raw_values()));
+        }
+
+        swap(new_map);
+    }
+
+
+private:
+    /*
+     * The buckets after the first bucket_count() ones never have neighbors, they are not counted 
+     * in the neighborhood fill histogram.
+     */
+    void add_buckets_stats(tsl::hopscotch_stats& stats) const {
+        const auto it_buckets_end = m_buckets.empty()?m_buckets.cend():m_buckets.cbegin() + bucket_count();
+        for(auto it_bucket = m_buckets.cbegin(); it_bucket != it_buckets_end; ++it_bucket) {
+            std::size_t nb_neighbors = 0;
+            std::size_t displacement = 0;
+            for(neighborhood_bitmap neighbors = it_bucket->neighborhood_infos(); neighbors != 0; neighbors >>= 1) {
+                if((neighbors & 1) == 1) {
+                    stats.displacement_histogram[displacement]++;
+                    nb_neighbors++;
+                }
+                
+                displacement++;
+            }
+            
+            stats.neighborhood_fill_histogram[nb_neighbors]++;
+            if(it_bucket->has_overflow()) {
+                stats.nb_buckets_with_overflow++;
+            }
+        }
+        
+        stats.buckets_memory_size += buckets_memory_size(m_buckets) + m_occupancy.memory_size();
     }
     
-    template<class K>
-    const_iterator find(const K& key, std::size_t hash) const {
-        return find_impl(key, hash, m_buckets.begin() + bucket_for_hash(hash));
+    template<class SerializerOrDeserializer, class CharPointer>
+    static constexpr bool use_raw_bytes_serialization() {
+        return has_raw_bytes_overload<SerializerOrDeserializer, CharPointer>::value && 
+               raw_bytes_serialization<value_type>::supported;
     }
     
-    
-    template<class K>
-    std::pair<iterator, iterator> equal_range(const K& key) {
-        return equal_range(key, hash_key(key));
+    static std::uint_least64_t bucket_layout_id(tsl::interleaved_bucket_layout) noexcept {
+        return 0;
     }
     
-    template<class K>
-    std::pair<iterator, iterator> equal_range(const K& key, std::size_t hash) {
-        iterator it = find(key, hash);
-        return std::make_pair(it, (it == end())?it:std::next(it));
+    static std::uint_least64_t bucket_layout_id(tsl::split_bucket_layout) noexcept {
+        return 1;
     }
     
-    
-    template<class K>
-    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
-        return equal_range(key, hash_key(key));
+    static std::uint_least64_t bucket_layout_id(tsl::fingerprint_bucket_layout) noexcept {
+        return 2;
     }
     
-    template<class K>
-    std::pair<const_iterator, const_iterator> equal_range(const K& key, std::size_t hash) const {
-        const_iterator it = find(key, hash);
-        return std::make_pair(it, (it == cend())?it:std::next(it));
+    static std::uint_least64_t bucket_layout_id() noexcept {
+        return bucket_layout_id(BucketLayout());
     }
     
-    /*
-     * Bucket interface 
-     */
-    size_type bucket_count() const {
-        /*
-         * So that the last bucket can have NeighborhoodSize neighbors, the size of the bucket array is a little
-         * bigger than the real number of buckets. We could use some of the buckets at the beginning, but
-         * it is easier this way and we avoid weird behaviour with iterators.
-         */
-        return m_buckets.size() - NeighborhoodSize + 1; 
+    template<class Serializer>
+    static void serialize_u64(Serializer& serializer, std::uint_least64_t value) {
+        serializer(std::uint64_t(value));
     }
     
-    size_type max_bucket_count() const {
-        const std::size_t max_bucket_count = std::min(GrowthPolicy::max_bucket_count(), m_buckets.max_size());
-        return max_bucket_count - NeighborhoodSize + 1;
+    template<class Deserializer>
+    static std::uint_least64_t deserialize_u64(Deserializer& deserializer) {
+        return deserializer.template operator()<std::uint64_t>();
     }
     
-    
-    /*
-     *  Hash policy 
-     */
-    float load_factor() const {
-        return float(m_nb_elements)/float(bucket_count());
+    template<class Serializer>
+    static void serialize_value(Serializer& serializer, const value_type& value, std::true_type /*raw bytes*/) {
+        raw_bytes_serialization<value_type>::serialize(serializer, value);
     }
     
-    float max_load_factor() const {
-        return m_max_load_factor;
+    template<class Serializer>
+    static void serialize_value(Serializer& serializer, const value_type& value, std::false_type /*raw bytes*/) {
+        serializer(value);
     }
     
-    void max_load_factor(float ml) {
-        m_max_load_factor = ml;
-        m_load_threshold = size_type(float(bucket_count())*m_max_load_factor);
-        m_min_load_factor_rehash_threshold = size_type(bucket_count()*MIN_LOAD_FACTOR_FOR_REHASH);
+    template<class Deserializer>
+    static value_type deserialize_value(Deserializer& deserializer, std::true_type /*raw bytes*/) {
+        return raw_bytes_serialization<value_type>::deserialize(deserializer);
     }
     
-    void rehash(size_type count_) {
-        count_ = std::max(count_, size_type(std::ceil(float(size())/max_load_factor())));
-        rehash_impl(count_);
+    template<class Deserializer>
+    static value_type deserialize_value(Deserializer& deserializer, std::false_type /*raw bytes*/) {
+        return deserializer.template operator()<value_type>();
     }
     
-    void reserve(size_type count_) {
-        rehash(size_type(std::ceil(float(count_)/max_load_factor())));
+    template<class BucketReference>
+    static std::uint8_t bucket_fingerprint(const BucketReference& bucket, std::true_type /*store fingerprint*/) {
+        return *bucket.fingerprint();
     }
     
+    template<class BucketReference>
+    static std::uint8_t bucket_fingerprint(const BucketReference& /*bucket*/, std::false_type /*store fingerprint*/) {
+        return 0;
+    }
     
-    /*
-     * Observers
-     */
-    hasher hash_function() const {
-        return static_cast<Hash>(*this);
+    template<class BucketReference>
+    static void set_bucket_fingerprint(BucketReference&& bucket, std::uint8_t fingerprint, 
+                                       std::true_type /*store fingerprint*/) 
+    {
+        *bucket.fingerprint() = fingerprint;
     }
     
-    key_equal key_eq() const {
-        return static_cast<KeyEqual>(*this);
+    template<class BucketReference>
+    static void set_bucket_fingerprint(BucketReference&& /*bucket*/, std::uint8_t /*fingerprint*/, 
+                                       std::false_type /*store fingerprint*/) 
+    {
     }
     
     /*
-     * Other
+     * Restore the neighborhood bitmap and the overflow flag of the empty bucket ibucket from the infos 
+     * written by serialize.
      */
-    iterator mutable_iterator(const_iterator pos) {
-        if(pos.m_buckets_iterator != pos.m_buckets_end_iterator) {
-            // Get a non-const iterator
-            auto it = m_buckets.begin() + std::distance(m_buckets.cbegin(), pos.m_buckets_iterator);
-            return iterator(it, m_buckets.end(), m_overflow_elements.begin());
-        }
-        else {
-            // Get a non-const iterator
-            auto it = mutable_overflow_iterator(pos.m_overflow_iterator);
+    void restore_bucket_infos(size_type ibucket, std::uint_least64_t infos) {
+        auto&& bucket = m_buckets[ibucket];
+        tsl_assert(bucket.empty() && bucket.neighborhood_infos() == 0);
+        
+        bucket.set_overflow((infos & 2) != 0);
+        
+        std::uint_least64_t neighbors = infos >> NB_RESERVED_BITS_IN_NEIGHBORHOOD;
+        while(neighbors != 0) {
+            const std::size_t ineighbor = count_trailing_zeros(neighbors);
+            if(ineighbor >= NeighborhoodSize) {
+                break;
+            }
             
-            return iterator(m_buckets.end(), m_buckets.end(), it);
+            bucket.toggle_neighbor_presence(ineighbor);
+            neighbors &= neighbors - 1;
         }
     }
     
-    size_type overflow_size() const noexcept {
-        return m_overflow_elements.size();
-    }
-    
-    template<class U = OverflowContainer, typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
-    typename U::key_compare key_comp() const {
-        return m_overflow_elements.key_comp();
-    }
-    
-    
-private:
     template<class K>
     std::size_t hash_key(const K& key) const {
         return Hash::operator()(key);
@@ -1353,9 +3516,22 @@ private:
     
     template<class K1, class K2>
     bool compare_keys(const K1& key1, const K2& key2) const {
+        increment_counter(hopscotch_counter::key_comparisons);
         return KeyEqual::operator()(key1, key2);
     }
     
+    /*
+     * No-op if TSL_HOPSCOTCH_ENABLE_COUNTERS is not defined.
+     */
+    void increment_counter(hopscotch_counter counter, std::uint64_t n = 1) const noexcept {
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+        m_counters.increment(counter, n);
+#else
+        (void) counter;
+        (void) n;
+#endif
+    }
+    
     std::size_t bucket_for_hash(std::size_t hash) const {
         return GrowthPolicy::bucket_for_hash(hash);
     }
@@ -1367,8 +3543,9 @@ private:
     
     template<typename U = value_type, 
              typename std::enable_if<std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
-    void rehash_impl(size_type count_) {
+    void rehash_impl(size_type count_, std::size_t nb_threads = 1) {
         hopscotch_hash new_map = new_hopscotch_hash(count_);
+        m_try_shrink_on_next_insert = false;
         
         if(!m_overflow_elements.empty()) {
             new_map.m_overflow_elements.swap(m_overflow_elements);
@@ -1380,6 +3557,11 @@ private:
             }
         }
         
+        // Move what can be moved in parallel first, the loop below takes care of the remaining values
+        if(nb_threads > 1) {
+            move_buckets_in_parallel(new_map, nb_threads);
+        }
+        
         try {
             for(auto it_bucket = m_buckets.begin(); it_bucket != m_buckets.end(); ++it_bucket) {
                 if(it_bucket->empty()) {
@@ -1389,12 +3571,13 @@ private:
                 const std::size_t hash = USE_STORED_HASH_ON_REHASH?
                                             it_bucket->truncated_bucket_hash():
                                             new_map.hash_key(KeySelect()(it_bucket->value()));
-                const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+                const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+                const std::size_t offset = std::size_t(std::distance(m_buckets.begin(), it_bucket)) - ibucket_for_hash;
                 
-                new_map.insert_impl(ibucket_for_hash, hash, std::move(it_bucket->value()));
+                new_map.insert_on_rehash(new_map.bucket_for_hash(hash), offset, hash, std::move(it_bucket->value()));
                 
                 
-                erase_from_bucket(it_bucket, bucket_for_hash(hash));
+                erase_from_bucket(it_bucket, ibucket_for_hash);
             }
         } 
         /*
@@ -1428,20 +3611,22 @@ private:
     template<typename U = value_type, 
              typename std::enable_if<std::is_copy_constructible<U>::value && 
                                      !std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
-    void rehash_impl(size_type count_) {
+    void rehash_impl(size_type count_, std::size_t /*nb_threads*/ = 1) {
         hopscotch_hash new_map = new_hopscotch_hash(count_);
+        m_try_shrink_on_next_insert = false;
                 
-        for(const hopscotch_bucket& bucket: m_buckets) {
-            if(bucket.empty()) {
+        for(auto it_bucket = m_buckets.cbegin(); it_bucket != m_buckets.cend(); ++it_bucket) {
+            if(it_bucket->empty()) {
                 continue;
             }
             
             const std::size_t hash = USE_STORED_HASH_ON_REHASH?
-                                         bucket.truncated_bucket_hash():
-                                         new_map.hash_key(KeySelect()(bucket.value()));
-            const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+                                         it_bucket->truncated_bucket_hash():
+                                         new_map.hash_key(KeySelect()(it_bucket->value()));
+            const std::size_t offset = std::size_t(std::distance(m_buckets.cbegin(), it_bucket)) - 
+                                       bucket_for_hash(hash);
             
-            new_map.insert_impl(ibucket_for_hash, hash, bucket.value());
+            new_map.insert_on_rehash(new_map.bucket_for_hash(hash), offset, hash, it_bucket->value());
         }
         
         for(const value_type& value: m_overflow_elements) {
@@ -1454,6 +3639,112 @@ private:
         new_map.swap(*this);
     }
     
+    /*
+     * Move the values of the buckets into the buckets of new_map with nb_threads threads (this thread included).
+     * 
+     * Only done with the power of two growth policy when new_map has at least as many buckets. The value 
+     * in bucket ibucket_for_hash can then only go in a bucket ibucket_for_hash + k*bucket_count() of new_map.
+     * The buckets are split in stripes and each thread moves the values of its stripe with move_stripe. 
+     * As the insertion of a value only touches the buckets in [ibucket_for_hash, ibucket_for_hash + 
+     * MAX_PROBES_FOR_EMPTY_BUCKET), the stripes of two threads don't overlap in new_map as long as the values 
+     * too close to the end of a stripe are left for later. The stripes are aligned on the words of the 
+     * occupancy bitmaps for the same reason.
+     * 
+     * The values which can't be moved in parallel (close to the end of a stripe, in a different stripe than 
+     * their ibucket_for_hash or which would go in the overflow list) stay in this hopscotch_hash, both 
+     * tables are valid once the threads are done.
+     */
+    void move_buckets_in_parallel(hopscotch_hash& new_map, std::size_t nb_threads) {
+        if(!PARALLEL_REHASH_SUPPORTED || new_map.bucket_count() < bucket_count()) {
+            return;
+        }
+        
+        const std::size_t nb_bits_in_word = occupancy_bitmap::NB_BITS_IN_WORD;
+        const std::size_t nb_buckets = bucket_count();
+        
+        nb_threads = std::min(nb_threads, nb_buckets/MIN_BUCKETS_PER_REHASH_STRIPE);
+        if(nb_threads <= 1) {
+            return;
+        }
+        
+        const std::size_t stripe_size = (nb_buckets/nb_threads + nb_bits_in_word - 1)/nb_bits_in_word*nb_bits_in_word;
+        const std::size_t nb_stripes = (nb_buckets + stripe_size - 1)/stripe_size;
+        
+        std::vector<size_type> nb_moved_values(nb_stripes, 0);
+        std::vector<std::thread> threads;
+        threads.reserve(nb_stripes - 1);
+        
+        for(std::size_t istripe = 1; istripe < nb_stripes; istripe++) {
+            const std::size_t ibucket_begin = istripe*stripe_size;
+            const std::size_t ibucket_end = std::min(ibucket_begin + stripe_size, nb_buckets);
+            
+            try {
+                threads.emplace_back([this, &new_map, &nb_moved_values, istripe, ibucket_begin, ibucket_end]() {
+                    nb_moved_values[istripe] = move_stripe(new_map, ibucket_begin, ibucket_end);
+                });
+            }
+            catch(...) {
+                // Couldn't start a new thread, move the stripe from this thread
+                nb_moved_values[istripe] = move_stripe(new_map, ibucket_begin, ibucket_end);
+            }
+        }
+        
+        nb_moved_values[0] = move_stripe(new_map, 0, std::min(stripe_size, nb_buckets));
+        
+        for(std::thread& thread: threads) {
+            thread.join();
+        }
+        
+        for(const size_type nb_moved: nb_moved_values) {
+            new_map.m_nb_elements += nb_moved;
+            m_nb_elements -= nb_moved;
+        }
+    }
+    
+    /*
+     * Move into new_map the values of the buckets in [ibucket_begin, ibucket_end) with an ibucket_for_hash 
+     * in [ibucket_begin, ibucket_end - MAX_PROBES_FOR_EMPTY_BUCKET] and which find an empty bucket in 
+     * their neighborhood in new_map. Return the number of moved values.
+     * 
+     * Called concurrently by move_buckets_in_parallel, the number of elements of the tables is not updated 
+     * and nothing outside the stripe is read or written in the buckets and occupancy bitmaps.
+     */
+    size_type move_stripe(hopscotch_hash& new_map, std::size_t ibucket_begin, std::size_t ibucket_end) noexcept {
+        size_type nb_moved_values = 0;
+        
+        std::size_t ibucket = occupancy_bitmap::find_next_occupied(m_occupancy.data(), ibucket_begin, ibucket_end);
+        for(; ibucket < ibucket_end; 
+            ibucket = occupancy_bitmap::find_next_occupied(m_occupancy.data(), ibucket + 1, ibucket_end)) 
+        {
+            const std::size_t hash = USE_STORED_HASH_ON_REHASH?
+                                        m_buckets[ibucket].truncated_bucket_hash():
+                                        hash_key(KeySelect()(m_buckets[ibucket].value()));
+            const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+            if(ibucket_for_hash < ibucket_begin || ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET > ibucket_end) {
+                continue;
+            }
+            
+            const std::size_t new_ibucket_for_hash = new_map.bucket_for_hash(hash);
+            const std::size_t ibucket_empty = new_map.find_empty_bucket_on_rehash(new_ibucket_for_hash, 
+                                                                                  ibucket - ibucket_for_hash);
+            if(ibucket_empty == new_map.m_buckets.size()) {
+                continue;
+            }
+            
+            new_map.m_buckets[ibucket_empty].set_value_of_empty_bucket(hash, std::move(m_buckets[ibucket].value()));
+            new_map.m_occupancy.set(ibucket_empty);
+            new_map.m_buckets[new_ibucket_for_hash].toggle_neighbor_presence(ibucket_empty - new_ibucket_for_hash);
+            
+            m_buckets[ibucket].remove_value();
+            m_occupancy.reset(ibucket);
+            m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket - ibucket_for_hash);
+            
+            nb_moved_values++;
+        }
+        
+        return nb_moved_values;
+    }
+    
 #ifdef TSL_NO_RANGE_ERASE_WITH_CONST_ITERATOR
     iterator_overflow mutable_overflow_iterator(const_iterator_overflow it) {
         return std::next(m_overflow_elements.begin(), std::distance(m_overflow_elements.cbegin(), it));        
@@ -1474,79 +3765,345 @@ private:
         m_nb_elements--;
         
         
-        // Check if we can remove the overflow flag
-        tsl_assert(m_buckets[ibucket_for_hash].has_overflow());
-        for(const value_type& value: m_overflow_elements) {
-            const std::size_t bucket_for_value = bucket_for_hash(hash_key(KeySelect()(value)));
-            if(bucket_for_value == ibucket_for_hash) {
-                return it_next;
-            }
+        // Check if we can remove the overflow flag
+        tsl_assert(m_buckets[ibucket_for_hash].has_overflow());
+        for(const value_type& value: m_overflow_elements) {
+            const std::size_t bucket_for_value = bucket_for_hash(hash_key(KeySelect()(value)));
+            if(bucket_for_value == ibucket_for_hash) {
+                return it_next;
+            }
+        }
+        
+        m_buckets[ibucket_for_hash].set_overflow(false);
+        return it_next;
+    }
+    
+    // iterator is in bucket
+    void erase_from_bucket(iterator_buckets pos, std::size_t ibucket_for_hash) noexcept {
+        const std::size_t ibucket_for_pos = std::distance(m_buckets.begin(), pos);
+        tsl_assert(ibucket_for_pos >= ibucket_for_hash);
+        
+        m_buckets[ibucket_for_pos].remove_value();
+        m_occupancy.reset(ibucket_for_pos);
+        m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_for_pos - ibucket_for_hash);
+        m_nb_elements--;
+    }
+    
+
+    
+    template<class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj) {
+        auto it = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+        if(!it.second) {
+            it.first.value() = std::forward<M>(obj);
+        }
+        
+        return it;
+    }
+    
+    template<typename P, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(P&& key, Args&&... args_value) {
+        const std::size_t hash = hash_key(key);
+        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+        
+        // Check if already presents
+        auto it_find = find_impl(key, hash, m_buckets.begin() + ibucket_for_hash);
+        if(it_find != end()) {
+            return std::make_pair(it_find, false);
+        }
+        
+        return insert_impl(ibucket_for_hash, hash, std::piecewise_construct, 
+                                                   std::forward_as_tuple(std::forward<P>(key)), 
+                                                   std::forward_as_tuple(std::forward<Args>(args_value)...));
+    }
+    
+    template<typename P>
+    std::pair<iterator, bool> insert_impl(P&& value) {
+        const std::size_t hash = hash_key(KeySelect()(value));
+        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+        
+        // Check if already presents
+        auto it_find = find_impl(KeySelect()(value), hash, m_buckets.begin() + ibucket_for_hash);
+        if(it_find != end()) {
+            return std::make_pair(it_find, false);
+        }
+        
+        
+        return insert_impl(ibucket_for_hash, hash, std::forward<P>(value));
+    }
+    
+    /*
+     * Insert the values of the range in order with for_each_prefetched so that several of the cache misses 
+     * on the buckets are pending at the same time once the buckets don't fit in the cache anymore.
+     */
+    template<class InputIt, typename std::enable_if<is_bulk_insertable<InputIt, value_type>::value>::type* = nullptr>
+    void insert_bulk(InputIt first, InputIt last) {
+        for_each_prefetched(first, last, 
+                            [&](const value_type& value) { return hash_key(KeySelect()(value)); },
+                            [&](InputIt it, std::size_t hash) {
+                                const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+                                if(find_impl(KeySelect()(*it), hash, m_buckets.begin() + ibucket_for_hash) == end()) {
+                                    insert_impl(ibucket_for_hash, hash, *it);
+                                }
+                            });
+    }
+    
+    template<class InputIt, typename std::enable_if<!is_bulk_insertable<InputIt, value_type>::value>::type* = nullptr>
+    void insert_bulk(InputIt first, InputIt last) {
+        for(; first != last; ++first) {
+            insert(*first);
+        }
+    }
+    
+    /*
+     * Call function(it, hash) for each iterator 'it' of [first, last) in order, 'hash' being hash_element(*it).
+     * 
+     * The hashes are calculated and the buckets prefetched PREFETCH_DISTANCE elements ahead. Without it, 
+     * an operation on a random key of a map whose buckets don't fit in the cache waits for the miss on its 
+     * bucket before the next one can start. The function must not invalidate the iterators of the range.
+     */
+    template<class ForwardIt, class HashElement, class Function>
+    void for_each_prefetched(ForwardIt first, ForwardIt last, HashElement hash_element, Function function) const {
+        std::array<std::size_t, PREFETCH_DISTANCE> hashes_ahead;
+        
+        ForwardIt it_ahead = first;
+        for(std::size_t i = 0; i < hashes_ahead.size() && it_ahead != last; i++, ++it_ahead) {
+            hashes_ahead[i] = hash_element(*it_ahead);
+            prefetch_bucket(bucket_for_hash(hashes_ahead[i]));
+        }
+        
+        for(std::size_t i = 0; first != last; ++first, i = (i + 1) % hashes_ahead.size()) {
+            const std::size_t hash = hashes_ahead[i];
+            if(it_ahead != last) {
+                hashes_ahead[i] = hash_element(*it_ahead);
+                prefetch_bucket(bucket_for_hash(hashes_ahead[i]));
+                ++it_ahead;
+            }
+            
+            function(first, hash);
+        }
+    }
+    
+#ifdef TSL_HOPSCOTCH_COROUTINES
+    /*
+     * Look up the keys of [first, last) with up to nb_in_flight find_task coroutines at once and call 
+     * function(it) with the result of each lookup in the order of the keys.
+     * 
+     * The lookups in flight are resumed in turn. Each one suspends after prefetching the memory it needs next 
+     * (its bucket, then the overflow elements or the buckets of the rehash source if it has to search them), 
+     * the other lookups progress while the memory is loaded.
+     */
+    template<class ForwardIt, class Function>
+    void for_each_interleaved(ForwardIt first, ForwardIt last, std::size_t nb_in_flight, Function function) const {
+        struct lookup_slot {
+            lookup_task task;
+            const_iterator result;
+        };
+        
+        // Must outlive the tasks of the slots
+        lookup_frame_pool pool;
+        std::vector<lookup_slot> slots(std::max(nb_in_flight, std::size_t(1)));
+        
+        // The lookups in flight are in slots[(ifirst + i) % slots.size()] for i in [0, nb_lookups), oldest first
+        std::size_t ifirst = 0;
+        std::size_t nb_lookups = 0;
+        for(; nb_lookups < slots.size() && first != last; nb_lookups++, ++first) {
+            slots[nb_lookups].task = find_task<find_task_key<ForwardIt>>(pool, *first, slots[nb_lookups].result);
+        }
+        
+        while(nb_lookups > 0) {
+            for(std::size_t i = 0; i < nb_lookups; i++) {
+                lookup_task& task = slots[(ifirst + i) % slots.size()].task;
+                if(!task.done()) {
+                    task.resume();
+                }
+            }
+            
+            while(nb_lookups > 0 && slots[ifirst].task.done()) {
+                slots[ifirst].task.rethrow_exception();
+                function(slots[ifirst].result);
+                
+                // Free the frame before starting the next lookup so that the pool can reuse it
+                slots[ifirst].task = lookup_task();
+                if(first != last) {
+                    slots[ifirst].task = find_task<find_task_key<ForwardIt>>(pool, *first, slots[ifirst].result);
+                    ++first;
+                }
+                else {
+                    nb_lookups--;
+                }
+                
+                ifirst = (ifirst + 1) % slots.size();
+            }
+        }
+    }
+    
+    /*
+     * Type of the key parameter of find_task for the keys of ForwardIt. The parameters of a coroutine live 
+     * in its frame across the suspension points: if *it is not an lvalue reference (e.g. a transform iterator 
+     * returning the key by value, or a proxy), the temporary would be destroyed before the lookup resumes, 
+     * the key is then copied in the frame.
+     */
+    template<class ForwardIt>
+    using find_task_key = typename std::conditional<
+                            std::is_lvalue_reference<decltype(*std::declval<ForwardIt&>())>::value,
+                            const typename std::decay<decltype(*std::declval<ForwardIt&>())>::type&,
+                            typename std::decay<decltype(*std::declval<ForwardIt&>())>::type>::type;
+    
+    template<class KeyParameter>
+    lookup_task find_task(lookup_frame_pool& pool, KeyParameter key, const_iterator& result) const {
+        (void) pool; // Only used to allocate the frame of the coroutine
+        
+        const std::size_t hash = hash_key(key);
+        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+        prefetch_bucket(ibucket_for_hash);
+        co_await std::suspend_always();
+        
+        const const_iterator_buckets it_bucket = m_buckets.cbegin() + ibucket_for_hash;
+        auto it = find_in_buckets(key, hash, it_bucket);
+        if(it != m_buckets.cend()) {
+            result = const_iterator(it, m_buckets.cend(), m_overflow_elements.cbegin(), m_occupancy, 
+                                    m_rehash_source.get());
+            co_return;
         }
         
-        m_buckets[ibucket_for_hash].set_overflow(false);
-        return it_next;
+        if(!it_bucket->has_overflow() && m_rehash_source == nullptr) {
+            result = cend();
+            co_return;
+        }
+        
+        
+        if(it_bucket->has_overflow()) {
+            tsl_assert(!m_overflow_elements.empty());
+            tsl::detail_hopscotch_hash::prefetch(std::addressof(*m_overflow_elements.cbegin()));
+        }
+        
+        if(m_rehash_source != nullptr) {
+            m_rehash_source->prefetch_bucket(m_rehash_source->bucket_for_hash(hash));
+        }
+        co_await std::suspend_always();
+        
+        result = find_impl(key, hash, it_bucket);
     }
     
-    // iterator is in bucket
-    void erase_from_bucket(iterator_buckets pos, std::size_t ibucket_for_hash) noexcept {
-        const std::size_t ibucket_for_pos = std::distance(m_buckets.begin(), pos);
-        tsl_assert(ibucket_for_pos >= ibucket_for_hash);
+#endif
+    /*
+     * Prefetch the cache line of the bucket and the next one. With a large NeighborhoodSize, the searched value 
+     * is often a few buckets after its bucket for hash.
+     */
+    template<class U = BucketLayout, 
+             typename std::enable_if<std::is_same<U, tsl::interleaved_bucket_layout>::value>::type* = nullptr>
+    void prefetch_bucket(std::size_t ibucket) const noexcept {
+        const std::size_t nb_buckets_per_cache_line = std::max(std::size_t(1), CACHE_LINE_SIZE/sizeof(m_buckets[0]));
+        const std::size_t ibucket_next_cache_line = std::min(ibucket + nb_buckets_per_cache_line, m_buckets.size() - 1);
         
-        m_buckets[ibucket_for_pos].remove_value();
-        m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_for_pos - ibucket_for_hash);
-        m_nb_elements--;
+        tsl::detail_hopscotch_hash::prefetch(std::addressof(m_buckets[ibucket]));
+        tsl::detail_hopscotch_hash::prefetch(std::addressof(m_buckets[ibucket_next_cache_line]));
     }
     
-
+    template<class U = BucketLayout, 
+             typename std::enable_if<!std::is_same<U, tsl::interleaved_bucket_layout>::value>::type* = nullptr>
+    void prefetch_bucket(std::size_t ibucket) const noexcept {
+        m_buckets.prefetch(ibucket);
+    }
     
-    template<class K, class M>
-    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj) {
-        auto it = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
-        if(!it.second) {
-            it.first.value() = std::forward<M>(obj);
+    template<typename... Args>
+    std::pair<iterator, bool> insert_impl(std::size_t ibucket_for_hash, std::size_t hash, Args&&... value_type_args) {
+        if(shrink_on_extreme_load()) {
+            ibucket_for_hash = bucket_for_hash(hash);
         }
         
-        return it;
-    }
-    
-    template<typename P, class... Args>
-    std::pair<iterator, bool> try_emplace_impl(P&& key, Args&&... args_value) {
-        const std::size_t hash = hash_key(key);
-        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+        if(m_rehash_source != nullptr) {
+            migrate_rehash_source(nb_buckets_to_migrate_on_insert());
+        }
         
-        // Check if already presents
-        auto it_find = find_impl(key, hash, m_buckets.begin() + ibucket_for_hash);
-        if(it_find != end()) {
-            return std::make_pair(it_find, false);
+        if((m_nb_elements - m_overflow_elements.size()) >= m_load_threshold) {
+            increment_counter(hopscotch_counter::rehashes_on_load_threshold);
+            grow();
+            ibucket_for_hash = bucket_for_hash(hash);
         }
         
-        return insert_impl(ibucket_for_hash, hash, std::piecewise_construct, 
-                                                   std::forward_as_tuple(std::forward<P>(key)), 
-                                                   std::forward_as_tuple(std::forward<Args>(args_value)...));
-    }
+        auto it = insert_in_neighborhood(ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
+        if(it != m_buckets.end()) {
+            increment_counter(hopscotch_counter::inserts);
+            return std::make_pair(iterator(it, m_buckets.end(), m_overflow_elements.begin(), m_occupancy, 
+                                           m_rehash_source.get()), 
+                                  true);
+        }
+            
+        // Load factor is too low or a rehash will not change the neighborhood, put the value in overflow list
+        if(size() < m_min_load_factor_rehash_threshold || !will_neighborhood_change_on_rehash(ibucket_for_hash)) {
+            auto it_insert = insert_in_overflow(ibucket_for_hash, std::forward<Args>(value_type_args)...);
+            increment_counter(hopscotch_counter::inserts);
+            increment_counter(hopscotch_counter::overflow_inserts);
+            
+            return std::make_pair(iterator(m_buckets.end(), m_buckets.end(), it_insert, m_occupancy), true);
+        }
     
-    template<typename P>
-    std::pair<iterator, bool> insert_impl(P&& value) {
-        const std::size_t hash = hash_key(KeySelect()(value));
-        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+        increment_counter(hopscotch_counter::rehashes_on_full_neighborhood);
+        grow();
         
-        // Check if already presents
-        auto it_find = find_impl(KeySelect()(value), hash, m_buckets.begin() + ibucket_for_hash);
-        if(it_find != end()) {
-            return std::make_pair(it_find, false);
+        ibucket_for_hash = bucket_for_hash(hash);
+        return insert_impl(ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
+    }    
+    
+    /*
+     * Insert, on rehash, a value which was offset buckets after its ibucket_for_hash in the old buckets.
+     */
+    template<typename... Args>
+    void insert_on_rehash(std::size_t ibucket_for_hash, std::size_t offset, std::size_t hash, 
+                          Args&&... value_type_args)
+    {
+        const std::size_t ibucket_empty = find_empty_bucket_on_rehash(ibucket_for_hash, offset);
+        if(ibucket_empty < m_buckets.size()) {
+            insert_in_bucket(ibucket_empty, ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
+        }
+        else {
+            insert_impl(ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
         }
+    }
+    
+    /*
+     * Same as find_empty_bucket_in_neighborhood but, if ibucket_for_hash is not empty, the bucket at offset 
+     * from ibucket_for_hash is tried first, where offset is the distance between the value and its 
+     * ibucket_for_hash in the old buckets.
+     * 
+     * With the power of two growth policy, a value either stays in the same bucket or moves by a multiple 
+     * of the old bucket count and, as the values are inserted in the order of the old buckets, this bucket 
+     * is almost always empty. It avoids the search of an empty bucket and the displacements, 
+     * the neighborhoods keep their layout.
+     */
+    std::size_t find_empty_bucket_on_rehash(std::size_t ibucket_for_hash, std::size_t offset) {
+        tsl_assert(offset < NeighborhoodSize);
         
+        if(m_occupancy.test(ibucket_for_hash) && !m_occupancy.test(ibucket_for_hash + offset)) {
+            return ibucket_for_hash + offset;
+        }
         
-        return insert_impl(ibucket_for_hash, hash, std::forward<P>(value));
+        return find_empty_bucket_in_neighborhood(ibucket_for_hash);
     }
     
+    /*
+     * Insert the value in an empty bucket of the neighborhood of ibucket_for_hash, displacing other values 
+     * if needed. Return m_buckets.end() without constructing the value if there is no such bucket.
+     */
     template<typename... Args>
-    std::pair<iterator, bool> insert_impl(std::size_t ibucket_for_hash, std::size_t hash, Args&&... value_type_args) {
-        if((m_nb_elements - m_overflow_elements.size()) >= m_load_threshold) {
-            rehash(GrowthPolicy::next_bucket_count());
-            ibucket_for_hash = bucket_for_hash(hash);
+    iterator_buckets insert_in_neighborhood(std::size_t ibucket_for_hash, std::size_t hash, 
+                                            Args&&... value_type_args) 
+    {
+        const std::size_t ibucket_empty = find_empty_bucket_in_neighborhood(ibucket_for_hash);
+        if(ibucket_empty == m_buckets.size()) {
+            return m_buckets.end();
         }
         
+        return insert_in_bucket(ibucket_empty, ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
+    }
+    
+    /*
+     * Return the index of an empty bucket in the neighborhood of ibucket_for_hash, displacing other values 
+     * to get one if needed. If none, the returned index equals m_buckets.size().
+     */
+    std::size_t find_empty_bucket_in_neighborhood(std::size_t ibucket_for_hash) {
         std::size_t ibucket_empty = find_empty_bucket(ibucket_for_hash);
         if(ibucket_empty < m_buckets.size()) {
             do {
@@ -1554,30 +4111,193 @@ private:
                 
                 // Empty bucket is in range of NeighborhoodSize, use it
                 if(ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
-                    auto it = insert_in_bucket(ibucket_empty, ibucket_for_hash, 
-                                               hash, std::forward<Args>(value_type_args)...);
-                    return std::make_pair(iterator(it, m_buckets.end(), m_overflow_elements.begin()), true);
+                    return ibucket_empty;
                 }
             }
             // else, try to swap values to get a closer empty bucket
             while(swap_empty_bucket_closer(ibucket_empty));
         }
+        else {
+            increment_counter(hopscotch_counter::failed_empty_bucket_searches);
+        }
+        
+        return m_buckets.size();
+    }
+    
+    /*
+     * Shrink the table if there was an erase since the last insert and the load factor is now below 
+     * min_load_factor(). 
+     * 
+     * The table is shrunk to the bucket count needed for size() + 1 elements at a load factor midway between 
+     * min_load_factor() and max_load_factor(), not at max_load_factor() which would grow the table again 
+     * on one of the next inserts. As min_load_factor() is at most a quarter of max_load_factor(), the load 
+     * factor after the shrink stays above min_load_factor() even if the GrowthPolicy doubles the bucket count 
+     * asked for, and it takes a lot of inserts or erasures to trigger the next rehash.
+     * 
+     * Return true if the table has been rehashed.
+     */
+    bool shrink_on_extreme_load() {
+        if(!m_try_shrink_on_next_insert) {
+            return false;
+        }
+        
+        m_try_shrink_on_next_insert = false;
+        if(m_min_load_factor == 0.0f || load_factor() >= m_min_load_factor) {
+            return false;
+        }
+        
+        return shrink_impl(size() + 1, (m_min_load_factor + max_load_factor())/2.0f);
+    }
+    
+    /*
+     * Rehash to the smallest bucket count given by the GrowthPolicy for nb_elements elements at target_load_factor
+     * if it is smaller than the current bucket count. Return true if the table has been rehashed.
+     */
+    bool shrink_impl(size_type nb_elements, float target_load_factor) {
+        std::size_t min_bucket_count = size_type(std::ceil(float(nb_elements)/target_load_factor));
+        GrowthPolicy growth_policy(min_bucket_count);
+        
+        if(min_bucket_count >= bucket_count()) {
+            return false;
+        }
+        
+        complete_incremental_rehash();
+        rehash_impl(min_bucket_count);
+        
+        return true;
+    }
+    
+    /*
+     * Grow the table on insert, the rehash is done incrementally if incremental_rehash() is true.
+     */
+    void grow() {
+        if(m_incremental_rehash) {
+            start_incremental_rehash(GrowthPolicy::next_bucket_count());
+        }
+        else {
+            rehash(GrowthPolicy::next_bucket_count());
+        }
+    }
+    
+    /*
+     * Move the current buckets in m_rehash_source and replace them by count_ empty buckets. The values are then 
+     * migrated from m_rehash_source in the order of its buckets, on each insert and on rehash_step.
+     * The count_ empty buckets are allocated and constructed at once, in O(count_).
+     * 
+     * The overflow elements are moved directly, m_rehash_source only keeps values in its buckets.
+     */
+    void start_incremental_rehash(size_type count_) {
+        complete_incremental_rehash();
+        
+        count_ = std::max(count_, size_type(std::ceil(float(size())/max_load_factor())));
+        std::unique_ptr<hopscotch_hash> rehash_source(new hopscotch_hash(new_hopscotch_hash(count_)));
+        rehash_source->swap(*this);
+        
+        m_rehash_source = std::move(rehash_source);
+        m_rehash_source_ibucket = 0;
+        
+        if(!m_rehash_source->m_overflow_elements.empty()) {
+            m_overflow_elements.swap(m_rehash_source->m_overflow_elements);
+            m_nb_elements += m_overflow_elements.size();
+            m_rehash_source->m_nb_elements -= m_overflow_elements.size();
             
-        // Load factor is too low or a rehash will not change the neighborhood, put the value in overflow list
-        if(size() < m_min_load_factor_rehash_threshold || !will_neighborhood_change_on_rehash(ibucket_for_hash)) {
-            auto it_insert = insert_in_overflow(std::forward<Args>(value_type_args)...);
+            for(const value_type& value : m_overflow_elements) {
+                const std::size_t ibucket_for_hash = bucket_for_hash(hash_key(KeySelect()(value)));
+                m_buckets[ibucket_for_hash].set_overflow(true);
+            }
+        }
+    }
+    
+    /*
+     * Number of buckets of m_rehash_source to migrate on insert so that the migration is complete 
+     * before the new buckets reach the load threshold, assuming all the values will end-up in them.
+     */
+    size_type nb_buckets_to_migrate_on_insert() const {
+        tsl_assert(m_rehash_source != nullptr);
+        
+        const size_type nb_remaining_buckets = m_rehash_source->m_buckets.size() - m_rehash_source_ibucket;
+        const size_type nb_elements_in_buckets = m_nb_elements - m_overflow_elements.size() + 
+                                                 m_rehash_source->m_nb_elements;
+        const size_type nb_inserts_before_threshold = (m_load_threshold > nb_elements_in_buckets)?
+                                                          m_load_threshold - nb_elements_in_buckets:1;
+        
+        return std::max(size_type(INCREMENTAL_REHASH_MIN_BUCKETS_PER_INSERT), 
+                        (nb_remaining_buckets + nb_inserts_before_threshold - 1)/nb_inserts_before_threshold);
+    }
+    
+    /*
+     * Migrate the values of the next nb_buckets buckets of m_rehash_source. Destroy m_rehash_source 
+     * once all its buckets have been migrated.
+     * 
+     * The values are inserted without triggering any rehash, they go in the overflow list if no empty bucket
+     * can be found in their neighborhood. If an exception is thrown, the value which couldn't be migrated 
+     * stays in m_rehash_source.
+     */
+    void migrate_rehash_source(size_type nb_buckets) {
+        tsl_assert(m_rehash_source != nullptr);
+        hopscotch_hash& source = *m_rehash_source;
+        
+        const size_type ibucket_end = m_rehash_source_ibucket + 
+                                      std::min(nb_buckets, source.m_buckets.size() - m_rehash_source_ibucket);
+        while(m_rehash_source_ibucket < ibucket_end) {
+            const size_type ibucket = source.m_occupancy.find_next_occupied(m_rehash_source_ibucket);
+            if(ibucket >= ibucket_end) {
+                m_rehash_source_ibucket = ibucket_end;
+                break;
+            }
+            
+            auto it_bucket = source.m_buckets.begin() + ibucket;
+            const std::size_t hash = USE_STORED_HASH_ON_REHASH?
+                                        it_bucket->truncated_bucket_hash():
+                                        hash_key(KeySelect()(it_bucket->value()));
+            const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+            
+            if(insert_in_neighborhood(ibucket_for_hash, hash, 
+                                      std::move_if_noexcept(it_bucket->value())) == m_buckets.end()) 
+            {
+                insert_in_overflow(ibucket_for_hash, std::move_if_noexcept(it_bucket->value()));
+            }
             
-            m_buckets[ibucket_for_hash].set_overflow(true);
-            m_nb_elements++;
+            source.erase_from_bucket(it_bucket, source.bucket_for_hash(hash));
+            m_rehash_source_ibucket = ibucket + 1;
+        }
+        
+        if(m_rehash_source_ibucket == source.m_buckets.size()) {
+            tsl_assert(source.m_nb_elements == 0);
             
-            return std::make_pair(iterator(m_buckets.end(), m_buckets.end(), it_insert), true);
+            m_rehash_source.reset();
+            m_rehash_source_ibucket = 0;
+        }
+    }
+    
+    void complete_incremental_rehash() {
+        if(m_rehash_source != nullptr) {
+            migrate_rehash_source(m_rehash_source->m_buckets.size());
         }
+    }
     
-        rehash(GrowthPolicy::next_bucket_count());
+    /*
+     * Search the key in the buckets of m_rehash_source, return m_rehash_source->m_buckets.cend() if not found.
+     */
+    template<class K>
+    const_iterator_buckets find_in_rehash_source(const K& key, std::size_t hash) const {
+        tsl_assert(m_rehash_source != nullptr);
         
-        ibucket_for_hash = bucket_for_hash(hash);
-        return insert_impl(ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
-    }    
+        const hopscotch_hash& source = *m_rehash_source;
+        return source.find_in_buckets(key, hash, source.m_buckets.cbegin() + source.bucket_for_hash(hash));
+    }
+    
+    /*
+     * Return true if the iterator points to a bucket of m_rehash_source.
+     */
+    bool is_in_rehash_source(const const_iterator& pos) const noexcept {
+        return m_rehash_source != nullptr && pos.m_occupancy == m_rehash_source->m_occupancy.data();
+    }
+    
+    std::unique_ptr<hopscotch_hash> copy_rehash_source() const {
+        return std::unique_ptr<hopscotch_hash>((m_rehash_source != nullptr)?
+                                                   new hopscotch_hash(*m_rehash_source):nullptr);
+    }
     
     /*
      * Return true if a rehash will change the position of a key-value in the neighborhood of 
@@ -1607,16 +4327,15 @@ private:
     /*
      * Return the index of an empty bucket in m_buckets.
      * If none, the returned index equals m_buckets.size()
+     * 
+     * The search is done in the occupancy bitmap, 64 buckets at a time.
      */
     std::size_t find_empty_bucket(std::size_t ibucket_start) const {
         const std::size_t limit = std::min(ibucket_start + MAX_PROBES_FOR_EMPTY_BUCKET, m_buckets.size());
-        for(; ibucket_start < limit; ibucket_start++) {
-            if(m_buckets[ibucket_start].empty()) {
-                return ibucket_start;
-            }
-        }
+        const std::size_t ibucket_empty = m_occupancy.find_next_empty(ibucket_start, limit);
+        tsl_assert(ibucket_empty == m_buckets.size() || m_buckets[ibucket_empty].empty());
         
-        return m_buckets.size();
+        return ibucket_empty;
     }
     
     /*
@@ -1631,6 +4350,7 @@ private:
         tsl_assert(ibucket_empty >= ibucket_for_hash );
         tsl_assert(m_buckets[ibucket_empty].empty());
         m_buckets[ibucket_empty].set_value_of_empty_bucket(hash, std::forward<Args>(value_type_args)...);
+        m_occupancy.set(ibucket_empty);
         
         tsl_assert(!m_buckets[ibucket_for_hash].empty());
         m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_empty - ibucket_for_hash);
@@ -1641,43 +4361,12 @@ private:
     
     /*
      * Try to swap the bucket ibucket_empty_in_out with a bucket preceding it while keeping the neighborhood 
-     * conditions correct.
-     * 
-     * If a swap was possible, the position of ibucket_empty_in_out will be closer to 0 and true will re returned.
+     * conditions correct (see tsl::detail_hopscotch_hash::swap_empty_bucket_closer).
      */
     bool swap_empty_bucket_closer(std::size_t& ibucket_empty_in_out) {
-        tsl_assert(ibucket_empty_in_out >= NeighborhoodSize);
-        const std::size_t neighborhood_start = ibucket_empty_in_out - NeighborhoodSize + 1;
-        
-        for(std::size_t to_check = neighborhood_start; to_check < ibucket_empty_in_out; to_check++) {
-            neighborhood_bitmap neighborhood_infos = m_buckets[to_check].neighborhood_infos();
-            std::size_t to_swap = to_check;
-            
-            while(neighborhood_infos != 0 && to_swap < ibucket_empty_in_out) {
-                if((neighborhood_infos & 1) == 1) {
-                    tsl_assert(m_buckets[ibucket_empty_in_out].empty());
-                    tsl_assert(!m_buckets[to_swap].empty());
-                    
-                    m_buckets[to_swap].swap_value_into_empty_bucket(m_buckets[ibucket_empty_in_out]);
-                    
-                    tsl_assert(!m_buckets[to_check].check_neighbor_presence(ibucket_empty_in_out - to_check));
-                    tsl_assert(m_buckets[to_check].check_neighbor_presence(to_swap - to_check));
-                    
-                    m_buckets[to_check].toggle_neighbor_presence(ibucket_empty_in_out - to_check);
-                    m_buckets[to_check].toggle_neighbor_presence(to_swap - to_check);
-                    
-                    
-                    ibucket_empty_in_out = to_swap;
-                    
-                    return true;
-                }
-                
-                to_swap++;
-                neighborhood_infos = neighborhood_bitmap(neighborhood_infos >> 1);
-            }
-        }
-        
-        return false;
+        increment_counter(hopscotch_counter::displacements);
+        return tsl::detail_hopscotch_hash::swap_empty_bucket_closer<NeighborhoodSize>(m_buckets, m_occupancy, 
+                                                                                     ibucket_empty_in_out);
     }
     
     
@@ -1709,6 +4398,13 @@ private:
             }
         }
         
+        if(m_rehash_source != nullptr) {
+            auto it_find_source = find_in_rehash_source(key, hash);
+            if(it_find_source != m_rehash_source->m_buckets.cend()) {
+                return std::addressof(ValueSelect()(it_find_source->value()));
+            }
+        }
+        
         return nullptr;
     }
     
@@ -1720,6 +4416,11 @@ private:
         else if(it_bucket->has_overflow() && find_in_overflow(key) != m_overflow_elements.cend()) {
             return 1;
         }
+        else if(m_rehash_source != nullptr && 
+                find_in_rehash_source(key, hash) != m_rehash_source->m_buckets.cend()) 
+        {
+            return 1;
+        }
         else {
             return 0;
         }
@@ -1729,29 +4430,51 @@ private:
     iterator find_impl(const K& key, std::size_t hash, iterator_buckets it_bucket) {
         auto it = find_in_buckets(key, hash, it_bucket);
         if(it != m_buckets.end()) {
-            return iterator(it, m_buckets.end(), m_overflow_elements.begin());
+            return iterator(it, m_buckets.end(), m_overflow_elements.begin(), m_occupancy, m_rehash_source.get());
+        }
+        
+        if(it_bucket->has_overflow()) {
+            auto it_overflow = find_in_overflow(key);
+            if(it_overflow != m_overflow_elements.end() || m_rehash_source == nullptr) {
+                return iterator(m_buckets.end(), m_buckets.end(), it_overflow, m_occupancy);
+            }
         }
         
-        if(!it_bucket->has_overflow()) {
-            return end();
+        if(m_rehash_source != nullptr) {
+            hopscotch_hash& source = *m_rehash_source;
+            auto it_source = source.find_in_buckets(key, hash, source.m_buckets.begin() + source.bucket_for_hash(hash));
+            if(it_source != source.m_buckets.end()) {
+                return iterator(it_source, source.m_buckets.end(), m_overflow_elements.begin(), source.m_occupancy);
+            }
         }
         
-        return iterator(m_buckets.end(), m_buckets.end(), find_in_overflow(key));
+        return end();
     }
     
     template<class K>
     const_iterator find_impl(const K& key, std::size_t hash, const_iterator_buckets it_bucket) const {
         auto it = find_in_buckets(key, hash, it_bucket);
         if(it != m_buckets.cend()) {
-            return const_iterator(it, m_buckets.cend(), m_overflow_elements.cbegin());
+            return const_iterator(it, m_buckets.cend(), m_overflow_elements.cbegin(), m_occupancy, 
+                                  m_rehash_source.get());
         }
         
-        if(!it_bucket->has_overflow()) {
-            return cend();
+        if(it_bucket->has_overflow()) {
+            auto it_overflow = find_in_overflow(key);
+            if(it_overflow != m_overflow_elements.cend() || m_rehash_source == nullptr) {
+                return const_iterator(m_buckets.cend(), m_buckets.cend(), it_overflow, m_occupancy);
+            }
+        }
+        
+        if(m_rehash_source != nullptr) {
+            auto it_source = find_in_rehash_source(key, hash);
+            if(it_source != m_rehash_source->m_buckets.cend()) {
+                return const_iterator(it_source, m_rehash_source->m_buckets.cend(), m_overflow_elements.cbegin(), 
+                                      m_rehash_source->m_occupancy);
+            }
         }
-
         
-        return const_iterator(m_buckets.cend(), m_buckets.cend(), find_in_overflow(key));
+        return cend();
     }
     
     template<class K>
@@ -1764,26 +4487,23 @@ private:
     template<class K>
     const_iterator_buckets find_in_buckets(const K& key, std::size_t hash, const_iterator_buckets it_bucket) const {      
         (void) hash; // Avoid warning of unused variable when StoreHash is false;
-
-        // TODO Try to optimize the function. 
-        // I tried to use ffs and  __builtin_ffs functions but I could not reduce the time the function
-        // takes with -march=native
+        increment_counter(hopscotch_counter::lookups);
         
-        neighborhood_bitmap neighborhood_infos = it_bucket->neighborhood_infos();
-        while(neighborhood_infos != 0) {
-            if((neighborhood_infos & 1) == 1) {
+        // The kernel is selected at compile time on NeighborhoodSize (see find_neighbor).
+        const std::size_t ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+            it_bucket->neighborhood_infos_for_hash(hash), 
+            [&](std::size_t ineighbor_candidate) {
+                const const_iterator_buckets it_candidate = it_bucket + ineighbor_candidate;
+                
                 // Check StoreHash before calling bucket_hash_equal. Functionally it doesn't change anythin. 
                 // If StoreHash is false, bucket_hash_equal is a no-op. Avoiding the call is there to help 
                 // GCC optimizes `hash` parameter away, it seems to not be able to do without this hint.
-                if((!StoreHash || it_bucket->bucket_hash_equal(hash)) && 
-                    compare_keys(KeySelect()(it_bucket->value()), key)) 
-                {
-                    return it_bucket;
-                }
-            }
-            
-            ++it_bucket;
-            neighborhood_infos = neighborhood_bitmap(neighborhood_infos >> 1);
+                return (!StoreHash || it_candidate->bucket_hash_equal(hash)) && 
+                       compare_keys(KeySelect()(it_candidate->value()), key);
+            });
+        
+        if(ineighbor < NeighborhoodSize) {
+            return it_bucket + ineighbor;
         }
         
         return m_buckets.end();
@@ -1819,28 +4539,55 @@ private:
     
     
     
+    /*
+     * Insert the value in the overflow list where the value originally belongs to ibucket_for_hash.
+     */
+    template<class... Args>
+    iterator_overflow insert_in_overflow(std::size_t ibucket_for_hash, Args&&... value_type_args) {
+        auto it_insert = insert_in_overflow_container(std::forward<Args>(value_type_args)...);
+        
+        m_buckets[ibucket_for_hash].set_overflow(true);
+        m_nb_elements++;
+        
+        return it_insert;
+    }
+    
     template<class... Args, class U = OverflowContainer, typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
-    iterator_overflow insert_in_overflow(Args&&... value_type_args) {
+    iterator_overflow insert_in_overflow_container(Args&&... value_type_args) {
         return m_overflow_elements.emplace(m_overflow_elements.end(), std::forward<Args>(value_type_args)...);
     }
     
     template<class... Args, class U = OverflowContainer, typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
-    iterator_overflow insert_in_overflow(Args&&... value_type_args) {
+    iterator_overflow insert_in_overflow_container(Args&&... value_type_args) {
         return m_overflow_elements.emplace(std::forward<Args>(value_type_args)...).first;
     }
     
     
     
+    /*
+     * Create an empty hopscotch_hash with bucket_count buckets and the same parameters as this one.
+     */
     template<class U = OverflowContainer, typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
     hopscotch_hash new_hopscotch_hash(size_type bucket_count) {
-        return hopscotch_hash(bucket_count, static_cast<Hash&>(*this), static_cast<KeyEqual&>(*this), 
-                              get_allocator(), m_max_load_factor);
+        hopscotch_hash new_map(bucket_count, static_cast<Hash&>(*this), static_cast<KeyEqual&>(*this), 
+                               get_allocator(), m_max_load_factor);
+        new_map.copy_settings(*this);
+        
+        return new_map;
     }
     
     template<class U = OverflowContainer, typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
     hopscotch_hash new_hopscotch_hash(size_type bucket_count) {
-        return hopscotch_hash(bucket_count, static_cast<Hash&>(*this), static_cast<KeyEqual&>(*this), 
-                              get_allocator(), m_max_load_factor, m_overflow_elements.key_comp());
+        hopscotch_hash new_map(bucket_count, static_cast<Hash&>(*this), static_cast<KeyEqual&>(*this), 
+                               get_allocator(), m_max_load_factor, m_overflow_elements.key_comp());
+        new_map.copy_settings(*this);
+        
+        return new_map;
+    }
+    
+    void copy_settings(const hopscotch_hash& other) noexcept {
+        m_min_load_factor = other.m_min_load_factor;
+        m_incremental_rehash = other.m_incremental_rehash;
     }
     
 public:    
@@ -1849,13 +4596,31 @@ public:
     
 private:    
     static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12*NeighborhoodSize;
+    static const size_type INCREMENTAL_REHASH_MIN_BUCKETS_PER_INSERT = 4;
     static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
+    static constexpr float MAXIMUM_MIN_LOAD_FACTOR = 0.15f;
+    static constexpr float MAXIMUM_MIN_TO_MAX_LOAD_FACTOR_RATIO = 0.25f;
     
     static const bool USE_STORED_HASH_ON_REHASH = 
                 StoreHash && std::is_same<GrowthPolicy, tsl::power_of_two_growth_policy>::value;
     
+    /*
+     * Nothing can throw in the threads of move_buckets_in_parallel, the hash of a value must be either stored 
+     * or calculated by a noexcept hash function.
+     */
+    static const bool PARALLEL_REHASH_SUPPORTED = 
+                std::is_same<GrowthPolicy, tsl::power_of_two_growth_policy>::value && 
+                (USE_STORED_HASH_ON_REHASH || noexcept(std::declval<const Hash&>()(std::declval<const key_type&>())));
+    static const std::size_t MIN_BUCKETS_PER_REHASH_STRIPE = 8*MAX_PROBES_FOR_EMPTY_BUCKET;
+    static const std::size_t PREFETCH_DISTANCE = 8;
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    
+    static const bool STORE_FINGERPRINT = std::is_same<BucketLayout, tsl::fingerprint_bucket_layout>::value;
+    static const std::uint_least64_t SERIALIZATION_PROTOCOL_VERSION = 1;
+    
 private:    
     buckets_container_type m_buckets;
+    occupancy_bitmap m_occupancy;
     overflow_container_type m_overflow_elements;
     
     size_type m_nb_elements;
@@ -1863,6 +4628,30 @@ private:
     float m_max_load_factor;
     size_type m_load_threshold;
     size_type m_min_load_factor_rehash_threshold;
+    
+    float m_min_load_factor;
+    
+    /*
+     * Set on erase, min_load_factor() is checked on the next insert instead so that an erase 
+     * only invalidates the iterator on the erased element.
+     */
+    bool m_try_shrink_on_next_insert;
+    
+    bool m_incremental_rehash;
+    
+    /*
+     * During an incremental rehash, table with the old buckets. m_rehash_source_ibucket is the index 
+     * of the next bucket to migrate.
+     */
+    std::unique_ptr<hopscotch_hash> m_rehash_source;
+    size_type m_rehash_source_ibucket;
+    
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+    /*
+     * Not copied, moved nor swapped with the rest of the map (see tsl::hopscotch_counters).
+     */
+    hopscotch_counters_storage m_counters;
+#endif
 };
 
 } // end namespace detail_hopscotch_hash
@@ -60,7 +60,8 @@ template<class Key,
          class Allocator = std::allocator<Key>,
          unsigned int NeighborhoodSize = 62,
          bool StoreHash = false,
-         class GrowthPolicy = tsl::power_of_two_growth_policy>
+         class GrowthPolicy = tsl::power_of_two_growth_policy,
+         class BucketLayout = tsl::interleaved_bucket_layout>
 class hopscotch_sc_set {
 private:    
     template<typename U>
@@ -85,7 +86,7 @@ private:
                                                      Hash, KeyEqual, 
                                                      Allocator, NeighborhoodSize, 
                                                      StoreHash, GrowthPolicy,
-                                                     overflow_container_type>;
+                                                     overflow_container_type, BucketLayout>;
             
 public:
     using key_type = typename ht::key_type;
@@ -445,6 +446,102 @@ public:
     
     
 
+    /**
+     * Prefetch the bucket of the key so that a following lookup or insertion of the key finds it in the cache.
+     * Useful to pipeline operations on keys known in advance (see also find_batch and count_batch).
+     */
+    void prefetch(const Key& key) const { m_ht.prefetch(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    void prefetch(const Key& key, std::size_t precalculated_hash) const { m_ht.prefetch(key, precalculated_hash); }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists. 
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr> 
+    void prefetch(const K& key) const { m_ht.prefetch(key); }
+    
+    /**
+     * @copydoc prefetch(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr> 
+    void prefetch(const K& key, std::size_t precalculated_hash) const { m_ht.prefetch(key, precalculated_hash); }
+    
+    
+    
+    
+    /**
+     * Write find(key) in out for each key of [first, last) and return the output iterator after the last write.
+     * 
+     * The keys are hashed and their buckets prefetched a few keys ahead of the one being looked up, 
+     * faster than successive calls to find once the map doesn't fit in the cache anymore.
+     * 
+     * ForwardIt must be a forward iterator over Key, or over a type K hashable and comparable to Key 
+     * if KeyEqual::is_transparent and Compare::is_transparent exist.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) { return m_ht.find_batch(first, last, out); }
+    
+    /**
+     * @copydoc find_batch(ForwardIt first, ForwardIt last, OutputIt out)
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const { 
+        return m_ht.find_batch(first, last, out); 
+    }
+    
+    /**
+     * Same as find_batch but write count(key) for each key.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch(ForwardIt first, ForwardIt last, OutputIt out) const { 
+        return m_ht.count_batch(first, last, out); 
+    }
+    
+#ifdef TSL_HOPSCOTCH_COROUTINES
+    /**
+     * Same as find_batch but with up to nb_in_flight lookups in progress at the same time. Each lookup is 
+     * a C++20 coroutine which suspends after prefetching the memory it needs next (its bucket and, 
+     * if needed, the overflow elements) while the other lookups progress.
+     * 
+     * Only available if TSL_HOPSCOTCH_COROUTINES is defined, i.e. if the compiler supports C++20 coroutines.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight = 16) { 
+        return m_ht.find_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+    
+    /**
+     * @copydoc find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight)
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, 
+                                    std::size_t nb_in_flight = 16) const 
+    { 
+        return m_ht.find_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+    
+    /**
+     * Same as find_batch_interleaved but write count(key) for each key.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, 
+                                     std::size_t nb_in_flight = 16) const 
+    { 
+        return m_ht.count_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+#endif
+    
+    
+    
+    
     /*
      * Bucket interface 
      */
@@ -458,9 +555,19 @@ public:
     float load_factor() const { return m_ht.load_factor(); }
     float max_load_factor() const { return m_ht.max_load_factor(); }
     void max_load_factor(float ml) { m_ht.max_load_factor(ml); }
+    float min_load_factor() const { return m_ht.min_load_factor(); }
+    void min_load_factor(float ml) { m_ht.min_load_factor(ml); }
     
     void rehash(size_type count_) { m_ht.rehash(count_); }
     void reserve(size_type count_) { m_ht.reserve(count_); }
+    void parallel_rehash(size_type count_, std::size_t nb_threads) { m_ht.parallel_rehash(count_, nb_threads); }
+    void shrink_to_fit() { m_ht.shrink_to_fit(); }
+    
+    bool incremental_rehash() const noexcept { return m_ht.incremental_rehash(); }
+    void incremental_rehash(bool enable) { m_ht.incremental_rehash(enable); }
+    
+    bool rehash_in_progress() const noexcept { return m_ht.rehash_in_progress(); }
+    bool rehash_step(size_type count_) { return m_ht.rehash_step(count_); }
     
     
     /*
@@ -484,6 +591,64 @@ public:
     
     size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
     
+    /**
+     * Structural statistics of the set: displacement of the values from their bucket for hash, fill of 
+     * the neighborhoods, overflow and memory usage (see tsl::hopscotch_stats). Walks all the buckets.
+     */
+    tsl::hopscotch_stats stats() const { return m_ht.stats(); }
+    
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+    /**
+     * Counters of the internal operations of the set (see tsl::hopscotch_counters), only available 
+     * if TSL_HOPSCOTCH_ENABLE_COUNTERS is defined.
+     */
+    tsl::hopscotch_counters counters() const noexcept { return m_ht.counters(); }
+    
+    void reset_counters() noexcept { m_ht.reset_counters(); }
+#endif
+    
+    /**
+     * Serialize the set through the serializer parameter.
+     * 
+     * The serializer parameter must be a function object that supports the following call:
+     *  - `template<typename U> void operator()(const U& value);` where the types `std::uint64_t`, 
+     *    `std::uint32_t`, `std::uint8_t`, `float` and `Key` must be supported for U.
+     * 
+     * If the serializer also supports `void operator()(const char* data, std::size_t size)` and Key is
+     * trivially copyable, the values are written as raw bytes with it instead.
+     * 
+     * The bucket count, the neighborhood bitmaps, the stored hashes and fingerprints of the buckets and the values 
+     * are written in the order of the buckets, followed by the values of the overflow list. The binary 
+     * compatibility (endianness, IEEE 754 for floats, ...) of the written types is left to the serializer.
+     */
+    template<class Serializer>
+    void serialize(Serializer& serializer) const { m_ht.serialize(serializer); }
+    
+    /**
+     * Deserialize a set serialized with serialize through the deserializer parameter.
+     * 
+     * The deserializer parameter must be a function object that supports the following call:
+     *  - `template<typename U> U operator()();` where the types `std::uint64_t`, `std::uint32_t`, 
+     *    `std::uint8_t`, `float` and `Key` must be supported for U.
+     * It must support `void operator()(char* data, std::size_t size)` if, and only if, the serializer 
+     * supported the raw bytes overload.
+     * 
+     * If hash_compatible is true, the buckets are restored as they were without hashing any key or moving 
+     * any value. The Hash, KeyEqual and GrowthPolicy must then behave the same way as the ones used 
+     * on serialization, otherwise the behaviour is undefined, and NeighborhoodSize, StoreHash and BucketLayout 
+     * must be the same (std::runtime_error is thrown otherwise). If hash_compatible is false, the values
+     * are inserted one by one.
+     * 
+     * The behaviour is undefined if the types of the values are not the same as the ones used on serialization.
+     */
+    template<class Deserializer>
+    static hopscotch_sc_set deserialize(Deserializer& deserializer, bool hash_compatible = false) {
+        hopscotch_sc_set set(0);
+        set.m_ht.deserialize(deserializer, hash_compatible);
+        
+        return set;
+    }
+    
     friend bool operator==(const hopscotch_sc_set& lhs, const hopscotch_sc_set& rhs) {
         if(lhs.size() != rhs.size()) {
             return false;
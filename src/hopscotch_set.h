@@ -59,13 +59,23 @@ namespace tsl {
  * to a power of two and uses a mask to set the hash to a bucket instead of the slow modulo.
  * You may define your own growth policy, check tsl::power_of_two_growth_policy for the interface.
  * 
+ * BucketLayout defines how the buckets are stored. By default (tsl::interleaved_bucket_layout) the neighborhood 
+ * bitmap and the stored hash of a bucket are next to its value. With tsl::split_bucket_layout, they are stored 
+ * in a separate dense array which avoids alignment padding and lets a lookup read the neighborhood 
+ * of a bucket without loading the values it doesn't compare. It may be faster for large sets with 
+ * a lot of unsuccessful lookups, but slower on iteration.
+ * tsl::fingerprint_bucket_layout adds a one byte fingerprint of the hash for each bucket, compared with SIMD
+ * instructions over the whole neighborhood, so that KeyEqual is mostly called on the matching key.
+ * 
  * If the destructor of Key throws an exception, behaviour of the class is undefined.
  * 
  * Iterators invalidation:
- *  - clear, operator=, reserve, rehash: always invalidate the iterators.
+ *  - clear, operator=, reserve, rehash, parallel_rehash, rehash_step: always invalidate the iterators.
+ *  - shrink_to_fit: invalidate the iterators if there is a rehash.
  *  - insert, emplace, emplace_hint, operator[]: if there is an effective insert, invalidate the iterators 
  *    if a displacement is needed to resolve a collision (which mean that most of the time, 
- *    insert will invalidate the iterators). Or if there is a rehash.
+ *    insert will invalidate the iterators). Or if there is a rehash (including a shrink because of 
+ *    min_load_factor) or an incremental rehash in progress.
  *  - erase: iterator on the erased element is the only one which become invalid.
  */
 template<class Key, 
@@ -74,7 +84,8 @@ template<class Key,
          class Allocator = std::allocator<Key>,
          unsigned int NeighborhoodSize = 62,
          bool StoreHash = false,
-         class GrowthPolicy = tsl::power_of_two_growth_policy>
+         class GrowthPolicy = tsl::power_of_two_growth_policy,
+         class BucketLayout = tsl::interleaved_bucket_layout>
 class hopscotch_set {
 private:    
     template<typename U>
@@ -99,7 +110,7 @@ private:
                                                      Hash, KeyEqual, 
                                                      Allocator, NeighborhoodSize, 
                                                      StoreHash, GrowthPolicy,
-                                                     overflow_container_type>;
+                                                     overflow_container_type, BucketLayout>;
             
 public:
     using key_type = typename ht::key_type;
@@ -443,6 +454,102 @@ public:
     
     
 
+    /**
+     * Prefetch the bucket of the key so that a following lookup or insertion of the key finds it in the cache.
+     * Useful to pipeline operations on keys known in advance (see also find_batch and count_batch).
+     */
+    void prefetch(const Key& key) const { m_ht.prefetch(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    void prefetch(const Key& key, std::size_t precalculated_hash) const { m_ht.prefetch(key, precalculated_hash); }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists. 
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr> 
+    void prefetch(const K& key) const { m_ht.prefetch(key); }
+    
+    /**
+     * @copydoc prefetch(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr> 
+    void prefetch(const K& key, std::size_t precalculated_hash) const { m_ht.prefetch(key, precalculated_hash); }
+    
+    
+    
+    
+    /**
+     * Write find(key) in out for each key of [first, last) and return the output iterator after the last write.
+     * 
+     * The keys are hashed and their buckets prefetched a few keys ahead of the one being looked up, 
+     * faster than successive calls to find once the map doesn't fit in the cache anymore.
+     * 
+     * ForwardIt must be a forward iterator over Key, or over a type K hashable and comparable to Key 
+     * if KeyEqual::is_transparent exists.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) { return m_ht.find_batch(first, last, out); }
+    
+    /**
+     * @copydoc find_batch(ForwardIt first, ForwardIt last, OutputIt out)
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const { 
+        return m_ht.find_batch(first, last, out); 
+    }
+    
+    /**
+     * Same as find_batch but write count(key) for each key.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch(ForwardIt first, ForwardIt last, OutputIt out) const { 
+        return m_ht.count_batch(first, last, out); 
+    }
+    
+#ifdef TSL_HOPSCOTCH_COROUTINES
+    /**
+     * Same as find_batch but with up to nb_in_flight lookups in progress at the same time. Each lookup is 
+     * a C++20 coroutine which suspends after prefetching the memory it needs next (its bucket and, 
+     * if needed, the overflow elements) while the other lookups progress.
+     * 
+     * Only available if TSL_HOPSCOTCH_COROUTINES is defined, i.e. if the compiler supports C++20 coroutines.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight = 16) { 
+        return m_ht.find_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+    
+    /**
+     * @copydoc find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, std::size_t nb_in_flight)
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt find_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, 
+                                    std::size_t nb_in_flight = 16) const 
+    { 
+        return m_ht.find_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+    
+    /**
+     * Same as find_batch_interleaved but write count(key) for each key.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch_interleaved(ForwardIt first, ForwardIt last, OutputIt out, 
+                                     std::size_t nb_in_flight = 16) const 
+    { 
+        return m_ht.count_batch_interleaved(first, last, out, nb_in_flight); 
+    }
+#endif
+    
+    
+    
+    
     /*
      * Bucket interface 
      */
@@ -457,9 +564,66 @@ public:
     float max_load_factor() const { return m_ht.max_load_factor(); }
     void max_load_factor(float ml) { m_ht.max_load_factor(ml); }
     
+    /**
+     * The minimum load factor is between 0.0f (the default, the map never shrinks) and 0.15f, and at most 
+     * a quarter of max_load_factor() (lowering max_load_factor() also lowers it), values outside are clamped. 
+     * If an element was erased since the last insert and the load factor is below the minimum load factor, 
+     * the next effective insert first shrinks the map to the bucket count needed for size() + 1 elements 
+     * at a load factor midway between min_load_factor() and max_load_factor(). The shrink is done on insert 
+     * and not on erase to keep the iterators valid on erase: the memory is only released on the next insert, 
+     * a map which only has erasures keeps its bucket array (call shrink_to_fit() to release it).
+     */
+    float min_load_factor() const { return m_ht.min_load_factor(); }
+    void min_load_factor(float ml) { m_ht.min_load_factor(ml); }
+    
     void rehash(size_type count_) { m_ht.rehash(count_); }
     void reserve(size_type count_) { m_ht.reserve(count_); }
     
+    /**
+     * Same as rehash(count_) but the values are moved into the new buckets by up to nb_threads threads 
+     * (std::thread::hardware_concurrency() if 0). The parallel move is only done with 
+     * tsl::power_of_two_growth_policy when the new bucket count is not smaller than the current one, 
+     * if StoreHash is true or if the hash function is noexcept. The values which can't be moved 
+     * in parallel (mostly around the boundaries between the parts of the buckets given to each thread) 
+     * are moved afterwards by the calling thread. Otherwise it is equivalent to rehash(count_).
+     */
+    void parallel_rehash(size_type count_, std::size_t nb_threads) { m_ht.parallel_rehash(count_, nb_threads); }
+    
+    /**
+     * Rehash the map to the smallest bucket count needed for its size if it is smaller than the current 
+     * bucket count. The old bucket array is freed.
+     */
+    void shrink_to_fit() { m_ht.shrink_to_fit(); }
+    
+    /**
+     * If true, the rehash done when an insert needs to grow the map is incremental. The new buckets are 
+     * allocated and the values are then migrated from the old buckets a few at a time on each following 
+     * effective insert (and on rehash_step) instead of all at once. Until the migration is complete, lookups 
+     * and erasures also search the old buckets.
+     * 
+     * It only shortens the latency spike of the insert triggering the rehash, it doesn't remove it: the new bucket 
+     * array is still allocated and its empty buckets constructed during that insert, a stall proportional 
+     * to the new bucket count (about half of the one of a full rehash).
+     * 
+     * An explicit call to rehash or reserve completes the migration. Disabled by default, 
+     * disabling it completes the migration in progress if any.
+     */
+    bool incremental_rehash() const noexcept { return m_ht.incremental_rehash(); }
+    void incremental_rehash(bool enable) { m_ht.incremental_rehash(enable); }
+    
+    /**
+     * Return true if an incremental rehash is in progress.
+     */
+    bool rehash_in_progress() const noexcept { return m_ht.rehash_in_progress(); }
+    
+    /**
+     * Migrate the values of up to count_ buckets of the incremental rehash in progress, if any. Can be used 
+     * when the map is idle to complete the migration. Invalidate the iterators.
+     * 
+     * Return true if the incremental rehash is still in progress.
+     */
+    bool rehash_step(size_type count_) { return m_ht.rehash_step(count_); }
+    
     
     /*
      * Observers
@@ -481,6 +645,64 @@ public:
     
     size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
     
+    /**
+     * Structural statistics of the set: displacement of the values from their bucket for hash, fill of 
+     * the neighborhoods, overflow and memory usage (see tsl::hopscotch_stats). Walks all the buckets.
+     */
+    tsl::hopscotch_stats stats() const { return m_ht.stats(); }
+    
+#ifdef TSL_HOPSCOTCH_ENABLE_COUNTERS
+    /**
+     * Counters of the internal operations of the set (see tsl::hopscotch_counters), only available 
+     * if TSL_HOPSCOTCH_ENABLE_COUNTERS is defined.
+     */
+    tsl::hopscotch_counters counters() const noexcept { return m_ht.counters(); }
+    
+    void reset_counters() noexcept { m_ht.reset_counters(); }
+#endif
+    
+    /**
+     * Serialize the set through the serializer parameter.
+     * 
+     * The serializer parameter must be a function object that supports the following call:
+     *  - `template<typename U> void operator()(const U& value);` where the types `std::uint64_t`, 
+     *    `std::uint32_t`, `std::uint8_t`, `float` and `Key` must be supported for U.
+     * 
+     * If the serializer also supports `void operator()(const char* data, std::size_t size)` and Key is
+     * trivially copyable, the values are written as raw bytes with it instead.
+     * 
+     * The bucket count, the neighborhood bitmaps, the stored hashes and fingerprints of the buckets and the values 
+     * are written in the order of the buckets, followed by the values of the overflow list. The binary 
+     * compatibility (endianness, IEEE 754 for floats, ...) of the written types is left to the serializer.
+     */
+    template<class Serializer>
+    void serialize(Serializer& serializer) const { m_ht.serialize(serializer); }
+    
+    /**
+     * Deserialize a set serialized with serialize through the deserializer parameter.
+     * 
+     * The deserializer parameter must be a function object that supports the following call:
+     *  - `template<typename U> U operator()();` where the types `std::uint64_t`, `std::uint32_t`, 
+     *    `std::uint8_t`, `float` and `Key` must be supported for U.
+     * It must support `void operator()(char* data, std::size_t size)` if, and only if, the serializer 
+     * supported the raw bytes overload.
+     * 
+     * If hash_compatible is true, the buckets are restored as they were without hashing any key or moving 
+     * any value. The Hash, KeyEqual and GrowthPolicy must then behave the same way as the ones used 
+     * on serialization, otherwise the behaviour is undefined, and NeighborhoodSize, StoreHash and BucketLayout 
+     * must be the same (std::runtime_error is thrown otherwise). If hash_compatible is false, the values
+     * are inserted one by one.
+     * 
+     * The behaviour is undefined if the types of the values are not the same as the ones used on serialization.
+     */
+    template<class Deserializer>
+    static hopscotch_set deserialize(Deserializer& deserializer, bool hash_compatible = false) {
+        hopscotch_set set(0);
+        set.m_ht.deserialize(deserializer, hash_compatible);
+        
+        return set;
+    }
+    
     friend bool operator==(const hopscotch_set& lhs, const hopscotch_set& rhs) {
         if(lhs.size() != rhs.size()) {
             return false;
@@ -0,0 +1,914 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_MAPPED_HOPSCOTCH_HASH_H
+#define TSL_MAPPED_HOPSCOTCH_HASH_H
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hopscotch_hash.h"
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+namespace tsl {
+
+namespace detail_mapped_hopscotch_hash {
+
+/*
+ * Read-only mapping of a whole file in memory. The file descriptor is closed once the file is mapped,
+ * the mapping stays valid until the destruction of the mapped_file.
+ */
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& filename): m_data(nullptr), m_size(0) {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Can't open the file '" + filename + "'.");
+        }
+        
+        LARGE_INTEGER file_size;
+        if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+            CloseHandle(file);
+            throw std::runtime_error("Can't map the file '" + filename + "', it is empty or its size is unknown.");
+        }
+        
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if(mapping == nullptr) {
+            throw std::runtime_error("Can't map the file '" + filename + "'.");
+        }
+        
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if(data == nullptr) {
+            throw std::runtime_error("Can't map the file '" + filename + "'.");
+        }
+        
+        m_data = static_cast<const char*>(data);
+        m_size = std::size_t(file_size.QuadPart);
+#else
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd == -1) {
+            throw std::runtime_error("Can't open the file '" + filename + "'.");
+        }
+        
+        struct stat file_stat;
+        if(::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+            ::close(fd);
+            throw std::runtime_error("Can't map the file '" + filename + "', it is empty or its size is unknown.");
+        }
+        
+        void* data = ::mmap(nullptr, std::size_t(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(data == MAP_FAILED) {
+            throw std::runtime_error("Can't map the file '" + filename + "'.");
+        }
+        
+        m_data = static_cast<const char*>(data);
+        m_size = std::size_t(file_stat.st_size);
+#endif
+    }
+    
+    mapped_file(mapped_file&& other) noexcept: m_data(other.m_data), m_size(other.m_size) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    
+    mapped_file(const mapped_file& other) = delete;
+    mapped_file& operator=(const mapped_file& other) = delete;
+    
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if(&other != this) {
+            unmap();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        
+        return *this;
+    }
+    
+    ~mapped_file() {
+        unmap();
+    }
+    
+    const char* data() const noexcept {
+        return m_data;
+    }
+    
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+    
+private:
+    void unmap() noexcept {
+        if(m_data == nullptr) {
+            return;
+        }
+
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    
+private:
+    const char* m_data;
+    std::size_t m_size;
+};
+
+
+/*
+ * Header at the start of a file written by mapped_hopscotch_hash::write. All the positions in the file
+ * are offsets from the start of the file.
+ */
+struct file_header {
+    char magic[8];
+    std::uint64_t version;
+    std::uint64_t byte_order_mark;
+    std::uint64_t neighborhood_size;
+    std::uint64_t value_size;
+    std::uint64_t bucket_size;
+    std::uint64_t overflow_value_size;
+    std::uint64_t bucket_count;
+    std::uint64_t nb_elements;
+    std::uint64_t nb_overflow_elements;
+    std::uint64_t buckets_offset;
+    std::uint64_t overflow_offset;
+    std::uint64_t file_size;
+};
+
+/*
+ * Bucket as stored in the file. The bits of neighborhood_infos have the same meaning as in
+ * tsl::detail_hopscotch_hash::hopscotch_bucket_infos: bit 0 is set if the bucket has a value, bit 1 if a value
+ * belonging to the bucket is in the overflow section, and the neighbors start at bit 2.
+ */
+template<class ValueType, class NeighborhoodBitmap>
+struct mapped_bucket {
+    NeighborhoodBitmap neighborhood_infos;
+    ValueType value;
+};
+
+/*
+ * Value of the overflow section, which is sorted by hash.
+ */
+template<class ValueType>
+struct mapped_overflow_value {
+    std::uint64_t hash;
+    ValueType value;
+};
+
+
+/*
+ * Read-only hash table stored in a file with the layout of the bucket array of a hopscotch_hash,
+ * see tsl::mapped_hopscotch_map. The file is memory-mapped and the lookups search the buckets of the mapping
+ * directly, there is no load step.
+ * 
+ * File format: file_header, then from buckets_offset the bucket_count + NeighborhoodSize - 1 mapped_bucket
+ * of the table, then from overflow_offset the mapped_overflow_value of the values which didn't fit
+ * in the neighborhood of their bucket, sorted by hash. Each section starts on a multiple of SECTION_ALIGNMENT.
+ * 
+ * The values are written and read as raw bytes, ValueType must be trivially copyable (or a pair
+ * of trivially copyable types). The file can only be read on a platform with the same byte order
+ * and the same size and alignment of ValueType, and with a Hash and a GrowthPolicy giving the same results
+ * as when it was written.
+ */
+template<class ValueType,
+         class KeySelect,
+         class ValueSelect,
+         class Hash,
+         class KeyEqual,
+         unsigned int NeighborhoodSize,
+         class GrowthPolicy>
+class mapped_hopscotch_hash: private Hash, private KeyEqual, private GrowthPolicy {
+private:
+    template<typename U>
+    using has_mapped_type = typename std::integral_constant<bool, !std::is_same<U, void>::value>;
+    
+    using bucket_infos = tsl::detail_hopscotch_hash::hopscotch_bucket_infos<NeighborhoodSize, false>;
+    using neighborhood_bitmap = typename bucket_infos::neighborhood_bitmap;
+    using bucket = mapped_bucket<ValueType, neighborhood_bitmap>;
+    using overflow_value = mapped_overflow_value<ValueType>;
+    
+    static_assert(tsl::detail_hopscotch_hash::raw_bytes_serialization<ValueType>::supported,
+                  "The keys and values of a mapped hash table must be trivially copyable.");
+    static_assert(std::is_trivially_destructible<ValueType>::value,
+                  "The keys and values of a mapped hash table must be trivially destructible.");
+    
+public:
+    class mapped_hopscotch_iterator;
+    
+    using key_type = typename KeySelect::key_type;
+    using value_type = ValueType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using pointer = const value_type*;
+    using const_pointer = const value_type*;
+    using iterator = mapped_hopscotch_iterator;
+    using const_iterator = mapped_hopscotch_iterator;
+    
+    
+    /**
+     * The iterator goes through the buckets in the order of the file, then through the overflow section.
+     * There is no non-const iterator, the values can't be modified.
+     */
+    class mapped_hopscotch_iterator {
+        friend class mapped_hopscotch_hash;
+    private:
+        mapped_hopscotch_iterator(const bucket* bucket_it, const bucket* buckets_end,
+                                  const overflow_value* overflow_it) noexcept:
+            m_bucket(bucket_it), m_buckets_end(buckets_end), m_overflow_value(overflow_it)
+        {
+        }
+    
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const typename mapped_hopscotch_hash::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type&;
+        using pointer = value_type*;
+        
+        
+        mapped_hopscotch_iterator() noexcept: m_bucket(nullptr), m_buckets_end(nullptr), m_overflow_value(nullptr) {
+        }
+        
+        const typename mapped_hopscotch_hash::key_type& key() const {
+            return KeySelect()(**this);
+        }
+        
+        template<class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+        const typename U::value_type& value() const {
+            return U()(**this);
+        }
+        
+        reference operator*() const {
+            if(m_bucket != m_buckets_end) {
+                return m_bucket->value;
+            }
+            
+            return m_overflow_value->value;
+        }
+        
+        pointer operator->() const {
+            return std::addressof(**this);
+        }
+        
+        mapped_hopscotch_iterator& operator++() {
+            if(m_bucket == m_buckets_end) {
+                ++m_overflow_value;
+                return *this;
+            }
+            
+            do {
+                ++m_bucket;
+            } while(m_bucket != m_buckets_end && (m_bucket->neighborhood_infos & 1) == 0);
+            
+            return *this;
+        }
+        
+        mapped_hopscotch_iterator operator++(int) {
+            mapped_hopscotch_iterator tmp(*this);
+            ++*this;
+            
+            return tmp;
+        }
+        
+        friend bool operator==(const mapped_hopscotch_iterator& lhs, const mapped_hopscotch_iterator& rhs) {
+            return lhs.m_bucket == rhs.m_bucket && lhs.m_overflow_value == rhs.m_overflow_value;
+        }
+        
+        friend bool operator!=(const mapped_hopscotch_iterator& lhs, const mapped_hopscotch_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+    
+    private:
+        const bucket* m_bucket;
+        const bucket* m_buckets_end;
+        const overflow_value* m_overflow_value;
+    };
+    
+    
+public:
+    /*
+     * Map the file and check its header, std::runtime_error is thrown if the file can't be mapped
+     * or if it wasn't written by a mapped_hopscotch_hash with the same parameters.
+     */
+    mapped_hopscotch_hash(const std::string& filename, const Hash& hash, const KeyEqual& equal):
+                                    mapped_hopscotch_hash(mapped_file(filename), hash, equal)
+    {
+    }
+    
+    mapped_hopscotch_hash(mapped_hopscotch_hash&& other) = default;
+    mapped_hopscotch_hash& operator=(mapped_hopscotch_hash&& other) = default;
+    
+    mapped_hopscotch_hash(const mapped_hopscotch_hash& other) = delete;
+    mapped_hopscotch_hash& operator=(const mapped_hopscotch_hash& other) = delete;
+    
+    
+    /*
+     * Write the values of [first, last) in filename with the layout of a hopscotch_hash bucket array.
+     * If multiple values have equivalent keys, only the first one is written.
+     */
+    template<class InputIt>
+    static void write(const std::string& filename, InputIt first, InputIt last, float max_load_factor,
+                      const Hash& hash, const KeyEqual& equal)
+    {
+        bucket_array_builder builder(hash, equal,
+                                     std::vector<ValueType>(first, last),
+                                     clamp_max_load_factor(max_load_factor));
+        builder.write(filename);
+    }
+    
+    
+    /*
+     * Iterators
+     */
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+    
+    const_iterator cbegin() const noexcept {
+        const bucket* first_bucket = m_buckets;
+        while(first_bucket != m_buckets_end && (first_bucket->neighborhood_infos & 1) == 0) {
+            ++first_bucket;
+        }
+        
+        return const_iterator(first_bucket, m_buckets_end, m_overflow_values);
+    }
+    
+    const_iterator end() const noexcept {
+        return cend();
+    }
+    
+    const_iterator cend() const noexcept {
+        return const_iterator(m_buckets_end, m_buckets_end, m_overflow_values + m_nb_overflow_elements);
+    }
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const noexcept {
+        return m_nb_elements == 0;
+    }
+    
+    size_type size() const noexcept {
+        return m_nb_elements;
+    }
+    
+    
+    /*
+     * Lookup
+     */
+    template<class K, class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    const typename U::value_type& at(const K& key) const {
+        return at(key, hash_key(key));
+    }
+    
+    template<class K, class U = ValueSelect, typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    const typename U::value_type& at(const K& key, std::size_t hash) const {
+        const const_iterator it = find(key, hash);
+        if(it == cend()) {
+            throw std::out_of_range("Couldn't find key.");
+        }
+        
+        return it.value();
+    }
+    
+    template<class K>
+    size_type count(const K& key) const {
+        return count(key, hash_key(key));
+    }
+    
+    template<class K>
+    size_type count(const K& key, std::size_t hash) const {
+        return (find(key, hash) != cend())?1:0;
+    }
+    
+    template<class K>
+    const_iterator find(const K& key) const {
+        return find(key, hash_key(key));
+    }
+    
+    template<class K>
+    const_iterator find(const K& key, std::size_t hash) const {
+        const bucket* bucket_for_key = m_buckets + bucket_for_hash(hash);
+        
+        // Ignore the bits after the neighborhood, the file may have been modified
+        const std::uint_least64_t neighbors = std::uint_least64_t(bucket_for_key->neighborhood_infos >>
+                                                  tsl::detail_hopscotch_hash::NB_RESERVED_BITS_IN_NEIGHBORHOOD) &
+                                              NEIGHBORHOOD_MASK;
+        
+        // Same lookup kernel as hopscotch_hash::find_in_buckets
+        const std::size_t ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+            neighbors,
+            [&](std::size_t ineighbor_candidate) {
+                return compare_keys(KeySelect()(bucket_for_key[ineighbor_candidate].value), key);
+            });
+        
+        if(ineighbor < NeighborhoodSize) {
+            return const_iterator(bucket_for_key + ineighbor, m_buckets_end, m_overflow_values);
+        }
+        
+        if((bucket_for_key->neighborhood_infos & 2) != 0) {
+            return find_in_overflow(key, hash);
+        }
+        
+        return cend();
+    }
+    
+    template<class K>
+    bool contains(const K& key) const {
+        return contains(key, hash_key(key));
+    }
+    
+    template<class K>
+    bool contains(const K& key, std::size_t hash) const {
+        return count(key, hash) != 0;
+    }
+    
+    
+    /*
+     * Bucket interface
+     */
+    size_type bucket_count() const {
+        return m_bucket_count;
+    }
+    
+    
+    /*
+     *  Hash policy
+     */
+    float load_factor() const {
+        return float(m_nb_elements)/float(bucket_count());
+    }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const {
+        return static_cast<const Hash&>(*this);
+    }
+    
+    key_equal key_eq() const {
+        return static_cast<const KeyEqual&>(*this);
+    }
+    
+    
+    /*
+     * Other
+     */
+    size_type overflow_size() const noexcept {
+        return m_nb_overflow_elements;
+    }
+    
+private:
+    /*
+     * The file is only moved into m_file by the last constructor, once the header has been read.
+     */
+    mapped_hopscotch_hash(mapped_file&& file, const Hash& hash, const KeyEqual& equal):
+                                    mapped_hopscotch_hash(std::move(file), read_header(file), hash, equal)
+    {
+    }
+    
+    /*
+     * bucket_count_policy is the bucket count of the header, updated by the GrowthPolicy.
+     */
+    mapped_hopscotch_hash(mapped_file&& file, const file_header& header, const Hash& hash, const KeyEqual& equal):
+                                    mapped_hopscotch_hash(std::move(file), header, size_type(header.bucket_count),
+                                                          hash, equal)
+    {
+    }
+    
+    mapped_hopscotch_hash(mapped_file&& file, const file_header& header, size_type bucket_count_policy,
+                          const Hash& hash, const KeyEqual& equal):
+                                    Hash(hash), KeyEqual(equal), GrowthPolicy(bucket_count_policy),
+                                    m_file(std::move(file)),
+                                    m_buckets(reinterpret_cast<const bucket*>(m_file.data() + header.buckets_offset)),
+                                    m_buckets_end(m_buckets + (header.bucket_count + NeighborhoodSize - 1)),
+                                    m_overflow_values(reinterpret_cast<const overflow_value*>(
+                                                          m_file.data() + header.overflow_offset)),
+                                    m_bucket_count(size_type(header.bucket_count)),
+                                    m_nb_elements(size_type(header.nb_elements)),
+                                    m_nb_overflow_elements(size_type(header.nb_overflow_elements))
+    {
+        if(bucket_count_policy != header.bucket_count) {
+            throw std::runtime_error("Can't map the hash table, the growth policy doesn't give the bucket count "
+                                     "of the file.");
+        }
+    }
+    
+    /*
+     * Read and check the header of the file. Everything is checked except the bucket count,
+     * which is checked against the GrowthPolicy in the constructor.
+     */
+    static file_header read_header(const mapped_file& file) {
+        file_header header;
+        if(file.size() < sizeof(header)) {
+            throw std::runtime_error("Can't map the hash table, the file is too small.");
+        }
+        std::memcpy(std::addressof(header), file.data(), sizeof(header));
+        
+        if(std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("Can't map the hash table, the file is not a mapped hash table.");
+        }
+        
+        if(header.version != FILE_FORMAT_VERSION || header.byte_order_mark != BYTE_ORDER_MARK) {
+            throw std::runtime_error("Can't map the hash table, the version or the byte order of the file "
+                                     "is not supported.");
+        }
+        
+        if(header.neighborhood_size != NeighborhoodSize || header.value_size != sizeof(value_type) ||
+           header.bucket_size != sizeof(bucket) || header.overflow_value_size != sizeof(overflow_value))
+        {
+            throw std::runtime_error("Can't map the hash table, the template parameters of the file are different.");
+        }
+        
+        const std::uint64_t file_size = file.size();
+        const bool valid_buckets_section =
+            header.bucket_count > 0 && header.buckets_offset >= sizeof(header) &&
+            header.buckets_offset % SECTION_ALIGNMENT == 0 && header.buckets_offset <= file_size &&
+            (file_size - header.buckets_offset)/sizeof(bucket) >= NeighborhoodSize - 1 &&
+            header.bucket_count <= (file_size - header.buckets_offset)/sizeof(bucket) - (NeighborhoodSize - 1) &&
+            header.bucket_count <= std::numeric_limits<size_type>::max() - NeighborhoodSize;
+        
+        const bool valid_overflow_section =
+            valid_buckets_section &&
+            header.overflow_offset % SECTION_ALIGNMENT == 0 &&
+            header.overflow_offset >= header.buckets_offset +
+                                      (header.bucket_count + NeighborhoodSize - 1)*sizeof(bucket) &&
+            header.overflow_offset <= file_size &&
+            header.nb_overflow_elements == (file_size - header.overflow_offset)/sizeof(overflow_value) &&
+            header.nb_overflow_elements <= header.nb_elements;
+        
+        if(header.file_size != file_size || !valid_overflow_section) {
+            throw std::runtime_error("Can't map the hash table, the file is truncated or corrupted.");
+        }
+        
+        return header;
+    }
+    
+    template<class K>
+    std::size_t hash_key(const K& key) const {
+        return Hash::operator()(key);
+    }
+    
+    template<class K1, class K2>
+    bool compare_keys(const K1& key1, const K2& key2) const {
+        return KeyEqual::operator()(key1, key2);
+    }
+    
+    std::size_t bucket_for_hash(std::size_t hash) const {
+        return GrowthPolicy::bucket_for_hash(hash);
+    }
+    
+    template<class K>
+    const_iterator find_in_overflow(const K& key, std::size_t hash) const {
+        const overflow_value* overflow_end = m_overflow_values + m_nb_overflow_elements;
+        const overflow_value* it = std::lower_bound(m_overflow_values, overflow_end, std::uint64_t(hash),
+                                                    [](const overflow_value& value, std::uint64_t value_hash) {
+                                                        return value.hash < value_hash;
+                                                    });
+        
+        for(; it != overflow_end && it->hash == std::uint64_t(hash); ++it) {
+            if(compare_keys(KeySelect()(it->value), key)) {
+                return const_iterator(m_buckets_end, m_buckets_end, it);
+            }
+        }
+        
+        return cend();
+    }
+    
+    static float clamp_max_load_factor(float max_load_factor) {
+        return std::max(0.1f, std::min(max_load_factor, 0.95f));
+    }
+    
+    
+    /*
+     * Place the values in a bucket array with the same insertion algorithm as hopscotch_hash (displacements
+     * of the empty bucket with tsl::detail_hopscotch_hash::swap_empty_bucket_closer, overflow if
+     * the neighborhood is full and a bigger bucket array would not help), and write the file.
+     */
+    class bucket_array_builder: private Hash, private KeyEqual {
+    private:
+        using hopscotch_bucket = tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize, false>;
+        using occupancy_bitmap = tsl::detail_hopscotch_hash::hopscotch_occupancy_bitmap<std::allocator<ValueType>>;
+    
+    public:
+        bucket_array_builder(const Hash& hash, const KeyEqual& equal, std::vector<ValueType> values,
+                             float max_load_factor):
+                                    Hash(hash), KeyEqual(equal), m_values(std::move(values)),
+                                    m_occupancy(std::allocator<ValueType>())
+        {
+            m_hashes.reserve(m_values.size());
+            for(const ValueType& value: m_values) {
+                m_hashes.push_back(Hash::operator()(KeySelect()(value)));
+            }
+            
+            size_type bucket_count = std::max(size_type(1),
+                                              size_type(std::ceil(float(m_values.size())/max_load_factor)));
+            while(!place_values(bucket_count)) {
+                bucket_count = GrowthPolicy(bucket_count).next_bucket_count();
+            }
+            
+            std::stable_sort(m_overflow_values.begin(), m_overflow_values.end(),
+                             [](const overflow_value& lhs, const overflow_value& rhs) {
+                                 return lhs.hash < rhs.hash;
+                             });
+        }
+        
+        void write(const std::string& filename) const {
+            file_header header;
+            std::memset(std::addressof(header), 0, sizeof(header));
+            std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+            header.version = FILE_FORMAT_VERSION;
+            header.byte_order_mark = BYTE_ORDER_MARK;
+            header.neighborhood_size = NeighborhoodSize;
+            header.value_size = sizeof(value_type);
+            header.bucket_size = sizeof(bucket);
+            header.overflow_value_size = sizeof(overflow_value);
+            header.bucket_count = m_bucket_count;
+            header.nb_elements = m_nb_elements;
+            header.nb_overflow_elements = m_overflow_values.size();
+            header.buckets_offset = round_up_to_section_alignment(sizeof(header));
+            header.overflow_offset = round_up_to_section_alignment(header.buckets_offset +
+                                                                   m_buckets.size()*sizeof(bucket));
+            header.file_size = header.overflow_offset + m_overflow_values.size()*sizeof(overflow_value);
+            
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(std::addressof(header)), sizeof(header));
+            write_padding(file, header.buckets_offset - sizeof(header));
+            
+            write_section<bucket>(file, m_buckets.size(), [&](std::size_t ibucket, bucket* bucket_out) {
+                const hopscotch_bucket& hbucket = m_buckets[ibucket];
+                const neighborhood_bitmap infos = neighborhood_bitmap(
+                                        (std::uint_least64_t(hbucket.neighborhood_infos()) <<
+                                            tsl::detail_hopscotch_hash::NB_RESERVED_BITS_IN_NEIGHBORHOOD) |
+                                        (hbucket.has_overflow()?2:0) | (hbucket.empty()?0:1));
+                
+                if(hbucket.empty()) {
+                    ::new (static_cast<void*>(bucket_out)) bucket{infos, ValueType()};
+                }
+                else {
+                    ::new (static_cast<void*>(bucket_out)) bucket{infos, hbucket.value()};
+                }
+            });
+            write_padding(file, header.overflow_offset - (header.buckets_offset + m_buckets.size()*sizeof(bucket)));
+            
+            write_section<overflow_value>(file, m_overflow_values.size(),
+                                          [&](std::size_t ivalue, overflow_value* value_out) {
+                ::new (static_cast<void*>(value_out)) overflow_value(m_overflow_values[ivalue]);
+            });
+            
+            file.flush();
+            if(!file) {
+                throw std::runtime_error("Couldn't write the hash table in '" + filename + "'.");
+            }
+        }
+    
+    private:
+        /*
+         * Try to place all the values in a bucket array of bucket_count buckets (updated by the GrowthPolicy).
+         * Return false if the bucket array must grow.
+         */
+        bool place_values(size_type& bucket_count) {
+            const GrowthPolicy growth_policy(bucket_count);
+            
+            m_bucket_count = bucket_count;
+            m_buckets.clear();
+            m_buckets.resize(bucket_count + NeighborhoodSize - 1);
+            m_occupancy.resize(m_buckets.size());
+            m_overflow_values.clear();
+            m_nb_elements = 0;
+            
+            for(std::size_t ivalue = 0; ivalue < m_values.size(); ivalue++) {
+                if(!place_value(growth_policy, ivalue)) {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
+        
+        bool place_value(const GrowthPolicy& growth_policy, std::size_t ivalue) {
+            const ValueType& value = m_values[ivalue];
+            const std::size_t hash = m_hashes[ivalue];
+            const std::size_t ibucket_for_hash = growth_policy.bucket_for_hash(hash);
+            
+            if(contains_key(ibucket_for_hash, hash, KeySelect()(value))) {
+                return true;
+            }
+            
+            const std::size_t limit = std::min(ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET, m_buckets.size());
+            std::size_t ibucket_empty = m_occupancy.find_next_empty(ibucket_for_hash, limit);
+            if(ibucket_empty < m_buckets.size()) {
+                do {
+                    if(ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
+                        m_buckets[ibucket_empty].set_value_of_empty_bucket(hash, value);
+                        m_occupancy.set(ibucket_empty);
+                        m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_empty - ibucket_for_hash);
+                        m_nb_elements++;
+                        
+                        return true;
+                    }
+                } while(tsl::detail_hopscotch_hash::swap_empty_bucket_closer<NeighborhoodSize>(m_buckets, m_occupancy,
+                                                                                                ibucket_empty));
+            }
+            
+            // Same condition as hopscotch_hash::insert_impl, put the value in the overflow section
+            // if the load factor is low or if a bigger bucket array will not change the neighborhood
+            if(float(m_values.size()) < float(m_bucket_count)*MIN_LOAD_FACTOR_FOR_REHASH ||
+               !will_neighborhood_change_on_rehash(growth_policy, ibucket_for_hash))
+            {
+                m_overflow_values.push_back(overflow_value{std::uint64_t(hash), value});
+                m_buckets[ibucket_for_hash].set_overflow(true);
+                m_nb_elements++;
+                
+                return true;
+            }
+            
+            return false;
+        }
+        
+        bool will_neighborhood_change_on_rehash(const GrowthPolicy& growth_policy,
+                                                std::size_t ibucket_neighborhood_check) const
+        {
+            std::size_t expand_bucket_count = growth_policy.next_bucket_count();
+            const GrowthPolicy expand_growth_policy(expand_bucket_count);
+            
+            for(std::size_t ibucket = ibucket_neighborhood_check;
+                ibucket < m_buckets.size() && (ibucket - ibucket_neighborhood_check) < NeighborhoodSize;
+                ++ibucket)
+            {
+                const std::size_t hash = Hash::operator()(KeySelect()(m_buckets[ibucket].value()));
+                if(growth_policy.bucket_for_hash(hash) != expand_growth_policy.bucket_for_hash(hash)) {
+                    return true;
+                }
+            }
+            
+            return false;
+        }
+        
+        bool contains_key(std::size_t ibucket_for_hash, std::size_t hash, const key_type& key) const {
+            const hopscotch_bucket& bucket_for_key = m_buckets[ibucket_for_hash];
+            const std::size_t ineighbor = tsl::detail_hopscotch_hash::find_neighbor<NeighborhoodSize>(
+                bucket_for_key.neighborhood_infos(),
+                [&](std::size_t ineighbor_candidate) {
+                    return KeyEqual::operator()(KeySelect()(m_buckets[ibucket_for_hash + ineighbor_candidate].value()),
+                                                key);
+                });
+            if(ineighbor < NeighborhoodSize) {
+                return true;
+            }
+            
+            return bucket_for_key.has_overflow() &&
+                   std::any_of(m_overflow_values.begin(), m_overflow_values.end(),
+                               [&](const overflow_value& value) {
+                                   return value.hash == std::uint64_t(hash) &&
+                                          KeyEqual::operator()(KeySelect()(value.value), key);
+                               });
+        }
+        
+        /*
+         * Write nb_elements elements of type U, constructed by construct(index, U*) in a zeroed buffer
+         * so that the padding bytes of the file are zeros.
+         */
+        template<class U, class Function>
+        static void write_section(std::ofstream& file, std::size_t nb_elements, Function construct) {
+            static const std::size_t NB_ELEMENTS_PER_WRITE = 4096;
+            
+            std::unique_ptr<char[]> buffer(new char[sizeof(U)*NB_ELEMENTS_PER_WRITE]);
+            for(std::size_t ielement = 0; ielement < nb_elements; ielement += NB_ELEMENTS_PER_WRITE) {
+                const std::size_t nb_elements_write = std::min(nb_elements - ielement, NB_ELEMENTS_PER_WRITE);
+                std::memset(buffer.get(), 0, sizeof(U)*nb_elements_write);
+                
+                for(std::size_t i = 0; i < nb_elements_write; i++) {
+                    construct(ielement + i, reinterpret_cast<U*>(buffer.get() + i*sizeof(U)));
+                }
+                
+                file.write(buffer.get(), std::streamsize(sizeof(U)*nb_elements_write));
+            }
+        }
+        
+        static void write_padding(std::ofstream& file, std::uint64_t nb_bytes) {
+            const char zeros[SECTION_ALIGNMENT] = {};
+            tsl_assert(nb_bytes < SECTION_ALIGNMENT);
+            
+            file.write(zeros, std::streamsize(nb_bytes));
+        }
+        
+        static std::uint64_t round_up_to_section_alignment(std::uint64_t offset) {
+            return (offset + SECTION_ALIGNMENT - 1)/SECTION_ALIGNMENT*SECTION_ALIGNMENT;
+        }
+    
+    private:
+        std::vector<ValueType> m_values;
+        std::vector<std::size_t> m_hashes;
+        
+        std::vector<hopscotch_bucket> m_buckets;
+        occupancy_bitmap m_occupancy;
+        std::vector<overflow_value> m_overflow_values;
+        size_type m_bucket_count;
+        size_type m_nb_elements;
+    };
+    
+public:
+    static constexpr float DEFAULT_MAX_LOAD_FACTOR = (NeighborhoodSize <= 30)?0.8f:0.9f;
+    
+private:
+    static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12*NeighborhoodSize;
+    static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
+    
+    static const std::uint_least64_t NEIGHBORHOOD_MASK = (std::uint_least64_t(1) << NeighborhoodSize) - 1;
+    
+    /*
+     * The buckets and the overflow values are aligned on a cache line in the file, the mapping
+     * of the file is aligned on a page.
+     */
+    static const std::size_t SECTION_ALIGNMENT = 64;
+    static_assert(SECTION_ALIGNMENT % alignof(bucket) == 0 && SECTION_ALIGNMENT % alignof(overflow_value) == 0,
+                  "The alignment of the values is too big.");
+    
+    static constexpr const char FILE_MAGIC[8] = {'T', 'S', 'L', 'H', 'O', 'P', 'M', 'F'};
+    static const std::uint64_t FILE_FORMAT_VERSION = 1;
+    static const std::uint64_t BYTE_ORDER_MARK = 0x0102030405060708;
+    
+private:
+    mapped_file m_file;
+    const bucket* m_buckets;
+    const bucket* m_buckets_end;
+    const overflow_value* m_overflow_values;
+    
+    size_type m_bucket_count;
+    size_type m_nb_elements;
+    size_type m_nb_overflow_elements;
+};
+
+template<class ValueType, class KeySelect, class ValueSelect, class Hash, class KeyEqual,
+         unsigned int NeighborhoodSize, class GrowthPolicy>
+constexpr const char mapped_hopscotch_hash<ValueType, KeySelect, ValueSelect, Hash, KeyEqual,
+                                           NeighborhoodSize, GrowthPolicy>::FILE_MAGIC[8];
+    
+} // end namespace detail_mapped_hopscotch_hash
+
+} // end namespace tsl
+
+#endif
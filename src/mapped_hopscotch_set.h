@@ -0,0 +1,280 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_MAPPED_HOPSCOTCH_SET_H
+#define TSL_MAPPED_HOPSCOTCH_SET_H
+
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "hopscotch_hash.h"
+#include "mapped_hopscotch_hash.h"
+
+
+namespace tsl {
+
+/**
+ * Read-only hash set stored in a file which is memory-mapped, for large static lookup tables.
+ * 
+ * The file is written once with write() and its layout is the bucket array of a tsl::hopscotch_set,
+ * the keys are placed with the same hopscotch algorithm. Opening the set only maps the file and checks
+ * its header, the lookups search the neighborhood of the bucket of the key directly in the mapping.
+ * There is no load step and the pages of the file are shared through the page cache between all the processes
+ * which map it. The keys which don't fit in the neighborhood of their bucket are stored in a section
+ * after the buckets sorted by hash, in which they are found with a binary search.
+ * 
+ * The Key must be trivially copyable and trivially destructible, the keys are stored as raw bytes.
+ * The file can only be opened on a platform with the same byte order and the same size and alignment
+ * of Key, and with a Hash and a GrowthPolicy giving the same results as when it was written
+ * (note that std::hash is not guaranteed to give the same results between two implementations of the standard
+ * library). The constructor throws std::runtime_error if the header of the file doesn't match the parameters
+ * of the set.
+ * 
+ * For NeighborhoodSize and GrowthPolicy, see tsl::hopscotch_set. The hash is not stored in the buckets
+ * (StoreHash of tsl::hopscotch_set).
+ * 
+ * The file must not be modified while it is mapped. Moving the set doesn't invalidate the iterators.
+ */
+template<class Key,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>,
+         unsigned int NeighborhoodSize = 62,
+         class GrowthPolicy = tsl::power_of_two_growth_policy>
+class mapped_hopscotch_set {
+private:
+    template<typename U>
+    using has_is_transparent = tsl::detail_hopscotch_hash::has_is_transparent<U>;
+    
+    class KeySelect {
+    public:
+        using key_type = Key;
+        
+        const key_type& operator()(const Key& key) const {
+            return key;
+        }
+    };
+    
+    using ht = detail_mapped_hopscotch_hash::mapped_hopscotch_hash<Key, KeySelect, void,
+                                                                   Hash, KeyEqual, NeighborhoodSize, GrowthPolicy>;
+    
+public:
+    using key_type = typename ht::key_type;
+    using value_type = typename ht::value_type;
+    using size_type = typename ht::size_type;
+    using difference_type = typename ht::difference_type;
+    using hasher = typename ht::hasher;
+    using key_equal = typename ht::key_equal;
+    using reference = typename ht::reference;
+    using const_reference = typename ht::const_reference;
+    using pointer = typename ht::pointer;
+    using const_pointer = typename ht::const_pointer;
+    using iterator = typename ht::iterator;
+    using const_iterator = typename ht::const_iterator;
+    
+    
+    
+    /*
+     * Constructors
+     */
+    /**
+     * Map the file 'filename' written by write(). Throws std::runtime_error if the file can't be mapped or if
+     * it was written with different template parameters.
+     */
+    explicit mapped_hopscotch_set(const std::string& filename,
+                                  const Hash& hash = Hash(),
+                                  const KeyEqual& equal = KeyEqual()) : m_ht(filename, hash, equal)
+    {
+    }
+    
+    
+    /**
+     * Write the keys of [first, last) in the file 'filename', which can then be mapped by the constructor.
+     * If multiple keys are equivalent, only the first one is written.
+     * 
+     * max_load_factor is the maximum load factor of the bucket array, as in tsl::hopscotch_set.
+     * Throws std::runtime_error if the file can't be written.
+     */
+    template<class InputIt>
+    static void write(const std::string& filename, InputIt first, InputIt last,
+                      float max_load_factor = ht::DEFAULT_MAX_LOAD_FACTOR,
+                      const Hash& hash = Hash(),
+                      const KeyEqual& equal = KeyEqual())
+    {
+        ht::write(filename, first, last, max_load_factor, hash, equal);
+    }
+    
+    static void write(const std::string& filename, std::initializer_list<value_type> init,
+                      float max_load_factor = ht::DEFAULT_MAX_LOAD_FACTOR,
+                      const Hash& hash = Hash(),
+                      const KeyEqual& equal = KeyEqual())
+    {
+        ht::write(filename, init.begin(), init.end(), max_load_factor, hash, equal);
+    }
+    
+    
+    /*
+     * Iterators
+     */
+    const_iterator begin() const noexcept { return m_ht.begin(); }
+    const_iterator cbegin() const noexcept { return m_ht.cbegin(); }
+    
+    const_iterator end() const noexcept { return m_ht.end(); }
+    const_iterator cend() const noexcept { return m_ht.cend(); }
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const noexcept { return m_ht.empty(); }
+    size_type size() const noexcept { return m_ht.size(); }
+    
+    
+    /*
+     * Lookup
+     */
+    size_type count(const Key& key) const { return m_ht.count(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    size_type count(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.count(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    size_type count(const K& key) const { return m_ht.count(key); }
+    
+    /**
+     * @copydoc count(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    size_type count(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.count(key, precalculated_hash);
+    }
+    
+    
+    const_iterator find(const Key& key) const { return m_ht.find(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    const_iterator find(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.find(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const_iterator find(const K& key) const { return m_ht.find(key); }
+    
+    /**
+     * @copydoc find(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    const_iterator find(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.find(key, precalculated_hash);
+    }
+    
+    
+    bool contains(const Key& key) const { return m_ht.contains(key); }
+    
+    /**
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    bool contains(const Key& key, std::size_t precalculated_hash) const {
+        return m_ht.contains(key, precalculated_hash);
+    }
+    
+    /**
+     * This overload only participates in the overload resolution if the typedef KeyEqual::is_transparent exists.
+     * If so, K must be hashable and comparable to Key.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    bool contains(const K& key) const { return m_ht.contains(key); }
+    
+    /**
+     * @copydoc contains(const K& key) const
+     * 
+     * Use the hash value 'precalculated_hash' instead of hashing the key. The hash value should be the same
+     * as hash_function()(key). Usefull to speed-up the lookup if you already have the hash.
+     */
+    template<class K, class KE = KeyEqual, typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+    bool contains(const K& key, std::size_t precalculated_hash) const {
+        return m_ht.contains(key, precalculated_hash);
+    }
+    
+    
+    /*
+     * Bucket interface
+     */
+    size_type bucket_count() const { return m_ht.bucket_count(); }
+    
+    
+    /*
+     *  Hash policy
+     */
+    float load_factor() const { return m_ht.load_factor(); }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const { return m_ht.hash_function(); }
+    key_equal key_eq() const { return m_ht.key_eq(); }
+    
+    
+    /*
+     * Other
+     */
+    
+    /**
+     * Number of keys in the overflow section of the file.
+     */
+    size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
+    
+private:
+    ht m_ht;
+};
+
+} // end namespace tsl
+
+#endif
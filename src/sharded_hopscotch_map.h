@@ -0,0 +1,493 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_SHARDED_HOPSCOTCH_MAP_H
+#define TSL_SHARDED_HOPSCOTCH_MAP_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "hopscotch_map.h"
+
+
+namespace tsl {
+
+namespace detail_sharded_hopscotch {
+
+constexpr std::size_t log2(std::size_t value) {
+    return (value <= 1)?0:1 + log2(value/2);
+}
+
+}
+
+/**
+ * Hash map which can be accessed concurrently by multiple threads, made of Shards tsl::hopscotch_map,
+ * each one with its own lock.
+ * 
+ * The shard of a key is selected with the high bits of its hash (multiplied by a constant first as
+ * the high bits of some hash functions, like std::hash for integers, are often 0). The full hash is then
+ * passed to the lookups of the tsl::hopscotch_map of the shard to not hash the key a second time.
+ * 
+ * Each shard grows on its own while holding only its lock, the operations on the other shards are not
+ * stopped. The batched operations (insert_batch, erase_batch, count_batch) group the keys by shard
+ * to lock each shard only once per batch.
+ * 
+ * Simpler than tsl::concurrent_hopscotch_map, but all the operations on a shard are serialized.
+ * As with tsl::concurrent_hopscotch_map, the values are only accessible while the lock of their shard
+ * is held: find and at copy the mapped value, visit and for_each_shard call a function with the lock held.
+ * 
+ * Shards must be a power of two. For the other template parameters, see tsl::hopscotch_map.
+ */
+template<class Key,
+         class T,
+         std::size_t Shards = 16,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>,
+         class Allocator = std::allocator<std::pair<Key, T>>,
+         unsigned int NeighborhoodSize = 62,
+         bool StoreHash = false,
+         class GrowthPolicy = tsl::power_of_two_growth_policy>
+class sharded_hopscotch_map {
+public:
+    using map_type = tsl::hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize, StoreHash, GrowthPolicy>;
+    using key_type = typename map_type::key_type;
+    using mapped_type = typename map_type::mapped_type;
+    using value_type = typename map_type::value_type;
+    using size_type = typename map_type::size_type;
+    using hasher = typename map_type::hasher;
+    using key_equal = typename map_type::key_equal;
+    using allocator_type = typename map_type::allocator_type;
+    
+private:
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two.");
+    
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    static const std::size_t PREFETCH_DISTANCE = 8;
+    static const std::size_t SHARD_SHIFT = (Shards == 1)?0:64 - detail_sharded_hopscotch::log2(Shards);
+    
+    /*
+     * The padding keeps the mutex of a shard on a different cache line than the map of the previous shard.
+     */
+    struct shard {
+        mutable std::mutex mutex;
+        map_type map;
+        char padding[CACHE_LINE_SIZE];
+    };
+    
+    /*
+     * An element of a batch with the hash of its key and its position in the batch.
+     */
+    template<class ForwardIt>
+    struct batch_element {
+        ForwardIt it;
+        std::size_t hash;
+        std::size_t index;
+    };
+    
+public:
+    static const size_type DEFAULT_INIT_BUCKETS_SIZE = 16*Shards;
+    
+    
+    explicit sharded_hopscotch_map(size_type bucket_count = DEFAULT_INIT_BUCKETS_SIZE,
+                                   const Hash& hash = Hash(),
+                                   const KeyEqual& equal = KeyEqual(),
+                                   const Allocator& alloc = Allocator()): m_hash(hash), m_shards(new shard[Shards])
+    {
+        for(std::size_t ishard = 0; ishard < Shards; ishard++) {
+            m_shards[ishard].map = map_type((bucket_count + Shards - 1)/Shards, hash, equal, alloc);
+        }
+    }
+    
+    sharded_hopscotch_map(const sharded_hopscotch_map& other) = delete;
+    sharded_hopscotch_map& operator=(const sharded_hopscotch_map& other) = delete;
+    
+    
+    /*
+     * Capacity
+     */
+    bool empty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * Sum of the sizes of the shards, each one read while its lock is held.
+     */
+    size_type size() const {
+        size_type nb_elements = 0;
+        for_each_shard([&](const map_type& map) { nb_elements += map.size(); });
+        
+        return nb_elements;
+    }
+    
+    
+    /*
+     * Modifiers
+     */
+    void clear() {
+        for_each_shard([](map_type& map) { map.clear(); });
+    }
+    
+    /**
+     * Return true if the value was inserted, false if there was already a value with the same key.
+     */
+    bool insert(const value_type& value) {
+        shard& value_shard = shard_for_hash(hash_key(value.first));
+        std::lock_guard<std::mutex> lock(value_shard.mutex);
+        
+        return value_shard.map.insert(value).second;
+    }
+    
+    bool insert(value_type&& value) {
+        shard& value_shard = shard_for_hash(hash_key(value.first));
+        std::lock_guard<std::mutex> lock(value_shard.mutex);
+        
+        return value_shard.map.insert(std::move(value)).second;
+    }
+    
+    template<class... Args>
+    bool emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+    
+    template<class... Args>
+    bool try_emplace(const key_type& key, Args&&... args) {
+        shard& key_shard = shard_for_hash(hash_key(key));
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        return key_shard.map.try_emplace(key, std::forward<Args>(args)...).second;
+    }
+    
+    /**
+     * Return true if the value was inserted, false if it was assigned.
+     */
+    template<class M>
+    bool insert_or_assign(const key_type& key, M&& obj) {
+        shard& key_shard = shard_for_hash(hash_key(key));
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        return key_shard.map.insert_or_assign(key, std::forward<M>(obj)).second;
+    }
+    
+    size_type erase(const key_type& key) {
+        const std::size_t hash = hash_key(key);
+        shard& key_shard = shard_for_hash(hash);
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        return key_shard.map.erase(key, hash);
+    }
+    
+    /**
+     * Insert the values in [first, last), grouped by shard. Return the number of inserted values.
+     */
+    template<class ForwardIt>
+    size_type insert_batch(ForwardIt first, ForwardIt last) {
+        size_type nb_inserted = 0;
+        for_each_grouped_by_shard(first, last, [](const value_type& value) -> const key_type& { return value.first; },
+                                  [&](map_type& map, const batch_element<ForwardIt>& element) {
+                                      if(map.insert(*element.it).second) {
+                                          nb_inserted++;
+                                      }
+                                  });
+        
+        return nb_inserted;
+    }
+    
+    /**
+     * Erase the keys in [first, last), grouped by shard. Return the number of erased values.
+     */
+    template<class ForwardIt>
+    size_type erase_batch(ForwardIt first, ForwardIt last) {
+        size_type nb_erased = 0;
+        for_each_grouped_by_shard(first, last, [](const key_type& key) -> const key_type& { return key; },
+                                  [&](map_type& map, const batch_element<ForwardIt>& element) {
+                                      nb_erased += map.erase(*element.it, element.hash);
+                                  });
+        
+        return nb_erased;
+    }
+    
+    
+    /*
+     * Lookup
+     */
+    
+    /**
+     * Copy the value mapped to key in value_out and return true. Return false, and leave value_out unchanged,
+     * if the key is not in the map.
+     */
+    bool find(const key_type& key, T& value_out) const {
+        return visit(key, [&](const T& value) { value_out = value; });
+    }
+    
+    /**
+     * Return a copy of the value mapped to key. Throw std::out_of_range if the key is not in the map.
+     */
+    T at(const key_type& key) const {
+        const std::size_t hash = hash_key(key);
+        const shard& key_shard = shard_for_hash(hash);
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        return key_shard.map.at(key, hash);
+    }
+    
+    /**
+     * Call function(T&) on the value mapped to key while the lock of its shard is held and return true.
+     * Return false, without calling function, if the key is not in the map.
+     * 
+     * The function must not call any method of the map.
+     */
+    template<class Function>
+    bool visit(const key_type& key, Function function) {
+        const std::size_t hash = hash_key(key);
+        shard& key_shard = shard_for_hash(hash);
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        auto it = key_shard.map.find(key, hash);
+        if(it == key_shard.map.end()) {
+            return false;
+        }
+        
+        function(it.value());
+        return true;
+    }
+    
+    /**
+     * Same as visit(const key_type&, Function) but call function(const T&).
+     */
+    template<class Function>
+    bool visit(const key_type& key, Function function) const {
+        const std::size_t hash = hash_key(key);
+        const shard& key_shard = shard_for_hash(hash);
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        auto it = key_shard.map.find(key, hash);
+        if(it == key_shard.map.cend()) {
+            return false;
+        }
+        
+        function(it->second);
+        return true;
+    }
+    
+    size_type count(const key_type& key) const {
+        const std::size_t hash = hash_key(key);
+        const shard& key_shard = shard_for_hash(hash);
+        std::lock_guard<std::mutex> lock(key_shard.mutex);
+        
+        return key_shard.map.count(key, hash);
+    }
+    
+    bool contains(const key_type& key) const {
+        return count(key) != 0;
+    }
+    
+    /**
+     * Write count(key) for each key in [first, last) to out, in the order of the keys, and return
+     * the iterator past the last written count. The keys are looked up grouped by shard.
+     */
+    template<class ForwardIt, class OutputIt>
+    OutputIt count_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        std::vector<size_type> counts(std::size_t(std::distance(first, last)));
+        for_each_grouped_by_shard(first, last, [](const key_type& key) -> const key_type& { return key; },
+                                  [&](const map_type& map, const batch_element<ForwardIt>& element) {
+                                      counts[element.index] = map.count(*element.it, element.hash);
+                                  });
+        
+        return std::copy(counts.begin(), counts.end(), out);
+    }
+    
+    
+    /*
+     * Shards
+     */
+    
+    /**
+     * Call function(map_type&) on the map of each shard, one after the other, while holding the lock
+     * of the shard.
+     * 
+     * The function must not call any method of the sharded map.
+     */
+    template<class Function>
+    void for_each_shard(Function function) {
+        for(std::size_t ishard = 0; ishard < Shards; ishard++) {
+            std::lock_guard<std::mutex> lock(m_shards[ishard].mutex);
+            function(m_shards[ishard].map);
+        }
+    }
+    
+    /**
+     * Same as for_each_shard(Function) but call function(const map_type&).
+     */
+    template<class Function>
+    void for_each_shard(Function function) const {
+        for(std::size_t ishard = 0; ishard < Shards; ishard++) {
+            std::lock_guard<std::mutex> lock(m_shards[ishard].mutex);
+            function(static_cast<const map_type&>(m_shards[ishard].map));
+        }
+    }
+    
+    static constexpr std::size_t shard_count() noexcept {
+        return Shards;
+    }
+    
+    /**
+     * Return the shard, in [0, shard_count()), of the key.
+     */
+    std::size_t shard_index(const key_type& key) const {
+        return shard_for_hash_index(hash_key(key));
+    }
+    
+    
+    /*
+     * Hash policy
+     */
+    
+    /**
+     * Sum of the bucket counts of the shards.
+     */
+    size_type bucket_count() const {
+        size_type nb_buckets = 0;
+        for_each_shard([&](const map_type& map) { nb_buckets += map.bucket_count(); });
+        
+        return nb_buckets;
+    }
+    
+    float load_factor() const {
+        return float(size())/float(bucket_count());
+    }
+    
+    void max_load_factor(float ml) {
+        for_each_shard([&](map_type& map) { map.max_load_factor(ml); });
+    }
+    
+    /**
+     * Reserve count/shard_count() values in each shard (rounded up), the keys are expected to be
+     * evenly distributed between the shards.
+     */
+    void reserve(size_type count_) {
+        for_each_shard([&](map_type& map) { map.reserve((count_ + Shards - 1)/Shards); });
+    }
+    
+    
+    /*
+     * Observers
+     */
+    hasher hash_function() const {
+        return m_hash;
+    }
+    
+    key_equal key_eq() const {
+        return m_shards[0].map.key_eq();
+    }
+    
+private:
+    std::size_t hash_key(const key_type& key) const {
+        return m_hash(key);
+    }
+    
+    /*
+     * Fibonacci hashing, multiply the hash by 2^64/phi and keep the high bits.
+     */
+    static std::size_t shard_for_hash_index(std::size_t hash) noexcept {
+        if(Shards == 1) {
+            return 0;
+        }
+        
+        const std::uint_least64_t mixed_hash = std::uint_least64_t(hash) * UINT64_C(0x9E3779B97F4A7C15);
+        return std::size_t(mixed_hash >> SHARD_SHIFT) & (Shards - 1);
+    }
+    
+    shard& shard_for_hash(std::size_t hash) const {
+        return m_shards[shard_for_hash_index(hash)];
+    }
+    
+    /*
+     * Call function(map, element) for each element of [first, last), where map is the map of the shard of
+     * the key key_select(*element.it), grouped by shard. The lock of each shard is taken once.
+     * 
+     * The buckets of the keys PREFETCH_DISTANCE elements ahead in the shard are prefetched.
+     */
+    template<class ForwardIt, class KeySelect, class Function>
+    void for_each_grouped_by_shard(ForwardIt first, ForwardIt last, KeySelect key_select, Function function) const {
+        std::vector<std::size_t> nb_elements_in_shard(Shards + 1, 0);
+        std::vector<batch_element<ForwardIt>> elements;
+        
+        std::size_t index = 0;
+        for(auto it = first; it != last; ++it) {
+            const std::size_t hash = hash_key(key_select(*it));
+            elements.push_back(batch_element<ForwardIt>{it, hash, index++});
+            nb_elements_in_shard[shard_for_hash_index(hash) + 1]++;
+        }
+        
+        // Counting sort of the elements by shard
+        std::partial_sum(nb_elements_in_shard.begin(), nb_elements_in_shard.end(), nb_elements_in_shard.begin());
+        std::vector<std::size_t> shard_positions(nb_elements_in_shard.begin(), nb_elements_in_shard.end() - 1);
+        
+        std::vector<batch_element<ForwardIt>> sorted_elements(elements.size(), batch_element<ForwardIt>{first, 0, 0});
+        for(const auto& element: elements) {
+            sorted_elements[shard_positions[shard_for_hash_index(element.hash)]++] = element;
+        }
+        
+        
+        for(std::size_t ishard = 0; ishard < Shards; ishard++) {
+            const std::size_t shard_begin = nb_elements_in_shard[ishard];
+            const std::size_t shard_end = nb_elements_in_shard[ishard + 1];
+            if(shard_begin == shard_end) {
+                continue;
+            }
+            
+            std::lock_guard<std::mutex> lock(m_shards[ishard].mutex);
+            map_type& map = m_shards[ishard].map;
+            
+            const std::size_t prefetch_end = std::min(shard_begin + std::size_t(PREFETCH_DISTANCE), shard_end);
+            for(std::size_t i = shard_begin; i < prefetch_end; i++) {
+                map.prefetch(key_select(*sorted_elements[i].it), sorted_elements[i].hash);
+            }
+            
+            for(std::size_t i = shard_begin; i < shard_end; i++) {
+                if(i + PREFETCH_DISTANCE < shard_end) {
+                    const auto& element_ahead = sorted_elements[i + PREFETCH_DISTANCE];
+                    map.prefetch(key_select(*element_ahead.it), element_ahead.hash);
+                }
+                
+                function(map, sorted_elements[i]);
+            }
+        }
+    }
+    
+private:
+    Hash m_hash;
+    std::unique_ptr<shard[]> m_shards;
+};
+
+} // end namespace tsl
+
+#endif
@@ -0,0 +1,353 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2017 Tessil
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_SNAPSHOT_HOPSCOTCH_MAP_H
+#define TSL_SNAPSHOT_HOPSCOTCH_MAP_H
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "hopscotch_map.h"
+
+
+namespace tsl {
+
+/**
+ * Hash map for read-mostly data shared between threads. The readers access an immutable snapshot,
+ * a tsl::hopscotch_map, without any lock or retry. The writers build a new snapshot and publish it
+ * with an atomic pointer swap.
+ * 
+ * Each reader thread gets a reader with make_reader(). reader::read() returns a view on the current snapshot,
+ * which stays valid, and unchanged, until the destruction of the view even if new snapshots are published
+ * in the meantime. Entering and leaving a view only writes to a slot of the reader, on its own cache line,
+ * and reads the pointer to the current snapshot, which is only written when a snapshot is published.
+ * 
+ * The old snapshots are reclaimed with epochs. Each publication increments the epoch of the map and retires
+ * the previous snapshot with the new epoch. A reader writes the epoch it read in its slot when it enters
+ * a view, and clears the slot when it leaves. A retired snapshot is freed once no slot holds an epoch
+ * older than its retirement epoch, as a reader which entered a view after the publication can only
+ * see the new snapshot.
+ * 
+ * update copies the current snapshot, applies all the modifications of a function to the copy and publishes
+ * it, assign publishes a map built by the caller. The writers are serialized by a mutex. A publication
+ * costs a copy of the map, the map is intended for data which is rebuilt or modified in batches,
+ * like configuration or routing tables.
+ * 
+ * The readers must be destroyed before the map, and a reader must only be used by one thread at a time.
+ * 
+ * For the template parameters, see tsl::hopscotch_map.
+ */
+template<class Key,
+         class T,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>,
+         class Allocator = std::allocator<std::pair<Key, T>>,
+         unsigned int NeighborhoodSize = 62,
+         bool StoreHash = false,
+         class GrowthPolicy = tsl::power_of_two_growth_policy>
+class snapshot_hopscotch_map {
+public:
+    using map_type = tsl::hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize, StoreHash, GrowthPolicy>;
+    using key_type = typename map_type::key_type;
+    using mapped_type = typename map_type::mapped_type;
+    using value_type = typename map_type::value_type;
+    using size_type = typename map_type::size_type;
+    using epoch_type = std::uint_least64_t;
+    
+private:
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    
+    /*
+     * Epoch of a slot when its reader is not in a view. The epochs of the map start at 1.
+     */
+    static const epoch_type QUIESCENT_EPOCH = 0;
+    
+    /*
+     * Slot of a reader, padded on both sides so that the writes of a reader to its slot don't invalidate
+     * the cache lines of the other readers.
+     */
+    struct reader_slot {
+        reader_slot() noexcept: epoch(epoch_type(QUIESCENT_EPOCH)), in_use(false) {
+        }
+        
+        char padding_front[CACHE_LINE_SIZE];
+        std::atomic<epoch_type> epoch;
+        
+        /*
+         * Protected by m_writer_mutex.
+         */
+        bool in_use;
+        char padding_back[CACHE_LINE_SIZE];
+    };
+    
+    struct retired_snapshot {
+        std::unique_ptr<const map_type> snapshot;
+        epoch_type epoch;
+    };
+    
+public:
+    class reader;
+    
+    /**
+     * Immutable view on the snapshot which was current when the view was created.
+     * Only movable, the snapshot stays valid until the destruction of the view.
+     */
+    class view {
+    public:
+        view(view&& other) noexcept: m_slot(other.m_slot), m_snapshot(other.m_snapshot) {
+            other.m_slot = nullptr;
+            other.m_snapshot = nullptr;
+        }
+        
+        view(const view& other) = delete;
+        view& operator=(const view& other) = delete;
+        view& operator=(view&& other) = delete;
+        
+        ~view() {
+            if(m_slot != nullptr) {
+                m_slot->epoch.store(QUIESCENT_EPOCH, std::memory_order_release);
+            }
+        }
+        
+        const map_type& operator*() const noexcept {
+            return *m_snapshot;
+        }
+        
+        const map_type* operator->() const noexcept {
+            return m_snapshot;
+        }
+        
+        const map_type& get() const noexcept {
+            return *m_snapshot;
+        }
+    
+    private:
+        view(reader_slot* slot, const map_type* snapshot) noexcept: m_slot(slot), m_snapshot(snapshot) {
+        }
+    
+    private:
+        reader_slot* m_slot;
+        const map_type* m_snapshot;
+        
+        friend class snapshot_hopscotch_map::reader;
+    };
+    
+    /**
+     * Reader of a snapshot_hopscotch_map, to use from one thread at a time. Holds a slot of the map
+     * until its destruction, which must happen before the destruction of the map.
+     */
+    class reader {
+    public:
+        reader(reader&& other) noexcept: m_map(other.m_map), m_slot(other.m_slot) {
+            other.m_map = nullptr;
+            other.m_slot = nullptr;
+        }
+        
+        reader(const reader& other) = delete;
+        reader& operator=(const reader& other) = delete;
+        reader& operator=(reader&& other) = delete;
+        
+        ~reader() {
+            if(m_map != nullptr) {
+                m_map->release_slot(m_slot);
+            }
+        }
+        
+        /**
+         * Return a view on the current snapshot. Only one view of a reader may exist at a time.
+         */
+        view read() const noexcept {
+            tsl_assert(m_slot->epoch.load(std::memory_order_relaxed) == QUIESCENT_EPOCH);
+            
+            // The store to the slot must be ordered before the load of the snapshot, and the load of the epoch
+            // after the previous publications, see retired_snapshot_freeable
+            m_slot->epoch.store(m_map->m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            return view(m_slot, m_map->m_snapshot.load(std::memory_order_seq_cst));
+        }
+    
+    private:
+        reader(snapshot_hopscotch_map* map, reader_slot* slot) noexcept: m_map(map), m_slot(slot) {
+        }
+    
+    private:
+        snapshot_hopscotch_map* m_map;
+        reader_slot* m_slot;
+        
+        friend class snapshot_hopscotch_map;
+    };
+    
+    
+    explicit snapshot_hopscotch_map(map_type map = map_type()):
+                                        m_snapshot(new map_type(std::move(map))), m_epoch(1)
+    {
+    }
+    
+    snapshot_hopscotch_map(const snapshot_hopscotch_map& other) = delete;
+    snapshot_hopscotch_map& operator=(const snapshot_hopscotch_map& other) = delete;
+    
+    ~snapshot_hopscotch_map() {
+        delete m_snapshot.load(std::memory_order_relaxed);
+    }
+    
+    
+    /**
+     * Return a new reader, reusing the slot of a destroyed reader if there is one.
+     */
+    reader make_reader() {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        
+        for(reader_slot& slot: m_reader_slots) {
+            if(!slot.in_use) {
+                slot.in_use = true;
+                return reader(this, &slot);
+            }
+        }
+        
+        m_reader_slots.emplace_back();
+        m_reader_slots.back().in_use = true;
+        
+        return reader(this, &m_reader_slots.back());
+    }
+    
+    /**
+     * Copy the current snapshot, call function(map_type&) on the copy and publish it.
+     * If function throws, the current snapshot is kept.
+     */
+    template<class Function>
+    void update(Function function) {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        
+        std::unique_ptr<map_type> new_snapshot(new map_type(*m_snapshot.load(std::memory_order_relaxed)));
+        function(*new_snapshot);
+        
+        publish(std::move(new_snapshot));
+    }
+    
+    /**
+     * Publish map as the new snapshot.
+     */
+    void assign(map_type map) {
+        std::unique_ptr<map_type> new_snapshot(new map_type(std::move(map)));
+        
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        publish(std::move(new_snapshot));
+    }
+    
+    /**
+     * Free the retired snapshots which aren't read anymore and return the number of retired snapshots
+     * still waiting for a reader to leave its view. Called on each publication.
+     */
+    size_type reclaim() {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        return reclaim_impl();
+    }
+    
+    /**
+     * Number of publications since the construction of the map, plus one.
+     */
+    epoch_type epoch() const noexcept {
+        return m_epoch.load(std::memory_order_acquire);
+    }
+    
+private:
+    void publish(std::unique_ptr<map_type> new_snapshot) {
+        // Reserve the space first so that retiring the old snapshot can't throw once it's unpublished
+        if(m_retired_snapshots.size() == m_retired_snapshots.capacity()) {
+            m_retired_snapshots.reserve(2*m_retired_snapshots.size() + 1);
+        }
+        
+        const map_type* old_snapshot = m_snapshot.exchange(new_snapshot.release(), std::memory_order_seq_cst);
+        const epoch_type retire_epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        
+        m_retired_snapshots.push_back(retired_snapshot{std::unique_ptr<const map_type>(old_snapshot), retire_epoch});
+        reclaim_impl();
+    }
+    
+    size_type reclaim_impl() {
+        epoch_type min_reader_epoch = 0;
+        bool has_active_reader = false;
+        for(const reader_slot& slot: m_reader_slots) {
+            const epoch_type epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if(epoch != QUIESCENT_EPOCH && (!has_active_reader || epoch < min_reader_epoch)) {
+                min_reader_epoch = epoch;
+                has_active_reader = true;
+            }
+        }
+        
+        auto it_kept = m_retired_snapshots.begin();
+        for(auto it = m_retired_snapshots.begin(); it != m_retired_snapshots.end(); ++it) {
+            if(!retired_snapshot_freeable(*it, has_active_reader, min_reader_epoch)) {
+                *it_kept = std::move(*it);
+                ++it_kept;
+            }
+        }
+        m_retired_snapshots.erase(it_kept, m_retired_snapshots.end());
+        
+        return m_retired_snapshots.size();
+    }
+    
+    /*
+     * A reader which loaded an epoch >= the retirement epoch of a snapshot loaded the epoch after
+     * the publication which retired it, and the snapshot pointer after that. All the loads and stores
+     * are sequentially consistent, it can't see the retired snapshot.
+     * 
+     * A reader which loaded an older epoch and whose slot was still empty when read by reclaim_impl
+     * stores its slot after reclaim_impl read it, and so loads the snapshot pointer after the publication.
+     */
+    static bool retired_snapshot_freeable(const retired_snapshot& retired, bool has_active_reader,
+                                          epoch_type min_reader_epoch) noexcept
+    {
+        return !has_active_reader || min_reader_epoch >= retired.epoch;
+    }
+    
+    void release_slot(reader_slot* slot) {
+        tsl_assert(slot->epoch.load(std::memory_order_relaxed) == QUIESCENT_EPOCH);
+        
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        slot->in_use = false;
+    }
+    
+private:
+    /*
+     * Only read by the readers between two publications, on their own cache line.
+     */
+    char m_padding_front[CACHE_LINE_SIZE];
+    std::atomic<const map_type*> m_snapshot;
+    std::atomic<epoch_type> m_epoch;
+    char m_padding_back[CACHE_LINE_SIZE];
+    
+    std::mutex m_writer_mutex;
+    std::list<reader_slot> m_reader_slots;
+    std::vector<retired_snapshot> m_retired_snapshots;
+};
+
+} // end namespace tsl
+
+#endif
@@ -0,0 +1,437 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "concurrent_hopscotch_map.h"
+
+
+/*
+ * Allocator keeping track of the number of bytes currently allocated through it, for all the types T.
+ */
+inline std::atomic<std::size_t>& live_bytes() {
+    static std::atomic<std::size_t> bytes(0);
+    return bytes;
+}
+
+template<class T>
+class live_bytes_allocator {
+public:
+    using value_type = T;
+    
+    live_bytes_allocator() = default;
+    
+    template<class U>
+    live_bytes_allocator(const live_bytes_allocator<U>& /*other*/) noexcept {
+    }
+    
+    T* allocate(std::size_t n) {
+        live_bytes() += n*sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    
+    void deallocate(T* p, std::size_t n) {
+        live_bytes() -= n*sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template<class T, class U>
+bool operator==(const live_bytes_allocator<T>&, const live_bytes_allocator<U>&) {
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const live_bytes_allocator<T>&, const live_bytes_allocator<U>&) {
+    return false;
+}
+
+/*
+ * Allocator throwing std::bad_alloc once nb_allocations_before_throw() allocations succeeded, 
+ * if nb_allocations_before_throw() is not negative.
+ */
+inline int& nb_allocations_before_throw() {
+    static int nb_allocations = -1;
+    return nb_allocations;
+}
+
+template<class T>
+class throwing_allocator {
+public:
+    using value_type = T;
+    
+    throwing_allocator() = default;
+    
+    template<class U>
+    throwing_allocator(const throwing_allocator<U>& /*other*/) noexcept {
+    }
+    
+    T* allocate(std::size_t n) {
+        if(nb_allocations_before_throw() == 0) {
+            throw std::bad_alloc();
+        }
+        else if(nb_allocations_before_throw() > 0) {
+            nb_allocations_before_throw()--;
+        }
+        
+        return std::allocator<T>().allocate(n);
+    }
+    
+    void deallocate(T* p, std::size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template<class T, class U>
+bool operator==(const throwing_allocator<T>&, const throwing_allocator<U>&) {
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const throwing_allocator<T>&, const throwing_allocator<U>&) {
+    return false;
+}
+
+
+BOOST_AUTO_TEST_SUITE(test_concurrent_hopscotch_map)
+
+using test_types = boost::mpl::list<
+                        tsl::concurrent_hopscotch_map<int64_t, int64_t>,
+                        tsl::concurrent_hopscotch_map<std::string, std::string>,
+                        // Hash with a lot of collisions, some values go in the overflow list
+                        tsl::concurrent_hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::concurrent_hopscotch_map<std::string, std::string, std::hash<std::string>,
+                            std::equal_to<std::string>, std::allocator<std::pair<std::string, std::string>>, 30, true>
+                        >;
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_erase, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 5000;
+    
+    HMap map(0, 4);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK(map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)}));
+    }
+    BOOST_CHECK(!map.insert({utils::get_key<key_t>(10), utils::get_value<value_t>(11)}));
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        value_t value = utils::get_value<value_t>(nb_values);
+        BOOST_CHECK(map.find(utils::get_key<key_t>(i), value));
+        BOOST_CHECK(value == utils::get_value<value_t>(i));
+        BOOST_CHECK(map.at(utils::get_key<key_t>(i)) == utils::get_value<value_t>(i));
+    }
+    
+    for(size_t i = 0; i < nb_values; i += 2) {
+        BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    }
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(0)), 0);
+    BOOST_CHECK_EQUAL(map.size(), nb_values/2);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), (i % 2 == 0)?0:1);
+    }
+    
+    value_t value = utils::get_value<value_t>(nb_values);
+    BOOST_CHECK(!map.find(utils::get_key<key_t>(0), value));
+    BOOST_CHECK(value == utils::get_value<value_t>(nb_values));
+    BOOST_CHECK_THROW(map.at(utils::get_key<key_t>(0)), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_rehash_clear, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 1000;
+    
+    HMap map;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.emplace(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+    }
+    
+    map.rehash(0);
+    BOOST_CHECK_GE(map.bucket_count()*map.max_load_factor(), float(nb_values));
+    
+    map.reserve(10*nb_values);
+    BOOST_CHECK_GE(map.bucket_count()*map.max_load_factor(), float(10*nb_values));
+    
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK(map.contains(utils::get_key<key_t>(i)));
+    }
+    
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(!map.contains(utils::get_key<key_t>(1)));
+    
+    BOOST_CHECK(map.insert({utils::get_key<key_t>(1), utils::get_value<value_t>(1)}));
+    BOOST_CHECK_EQUAL(map.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_try_emplace_insert_or_assign_visit) {
+    tsl::concurrent_hopscotch_map<int64_t, std::string> map;
+    
+    BOOST_CHECK(map.try_emplace(1, 3, 'a'));
+    BOOST_CHECK(!map.try_emplace(1, 3, 'b'));
+    BOOST_CHECK_EQUAL(map.at(1), "aaa");
+    
+    BOOST_CHECK(map.insert_or_assign(2, "b"));
+    BOOST_CHECK(!map.insert_or_assign(1, "c"));
+    BOOST_CHECK_EQUAL(map.at(1), "c");
+    BOOST_CHECK_EQUAL(map.at(2), "b");
+    
+    BOOST_CHECK(map.visit(2, [](std::string& value) { value += "d"; }));
+    BOOST_CHECK(!map.visit(3, [](std::string& value) { value += "d"; }));
+    BOOST_CHECK_EQUAL(map.at(2), "bd");
+    
+    const auto& const_map = map;
+    std::size_t length = 0;
+    BOOST_CHECK(const_map.visit(2, [&](const std::string& value) { length = value.size(); }));
+    BOOST_CHECK_EQUAL(length, 2);
+}
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_concurrent_operations, HMap, test_types) {
+    // Each thread inserts, looks up and erases its own keys while the others do the same with theirs.
+    // Few locks and buckets so that the threads share the locks and the map grows a lot.
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_threads = 4;
+    const size_t nb_values_per_thread = 3000;
+    
+    HMap map(0, 3);
+    std::vector<std::size_t> nb_errors(nb_threads, 0);
+    
+    std::vector<std::thread> threads;
+    for(size_t ithread = 0; ithread < nb_threads; ithread++) {
+        threads.emplace_back([&, ithread]() {
+            for(size_t i = ithread; i < nb_threads*nb_values_per_thread; i += nb_threads) {
+                if(!map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)})) {
+                    nb_errors[ithread]++;
+                }
+            }
+            
+            for(size_t i = ithread; i < nb_threads*nb_values_per_thread; i += nb_threads) {
+                value_t value = utils::get_value<value_t>(i + 1);
+                if(!map.find(utils::get_key<key_t>(i), value) || !(value == utils::get_value<value_t>(i))) {
+                    nb_errors[ithread]++;
+                }
+                
+                if(i % 3 == 0 && map.erase(utils::get_key<key_t>(i)) != 1) {
+                    nb_errors[ithread]++;
+                }
+            }
+        });
+    }
+    
+    for(auto& thread: threads) {
+        thread.join();
+    }
+    
+    for(size_t ithread = 0; ithread < nb_threads; ithread++) {
+        BOOST_CHECK_EQUAL(nb_errors[ithread], 0);
+    }
+    
+    const size_t nb_values = nb_threads*nb_values_per_thread;
+    BOOST_CHECK_EQUAL(map.size(), nb_values - (nb_values + 2)/3);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), (i % 3 == 0)?0:1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_optimistic_reads) {
+    // The readers look up keys which are never modified while a writer inserts and erases other keys in the same
+    // neighborhoods, displacing the values and growing the map. The keys of the reader are in the overflow list 
+    // with mod_hash, the lookups in the overflow list take the locks.
+    using map_t = tsl::concurrent_hopscotch_map<int64_t, int64_t>;
+    using mod_map_t = tsl::concurrent_hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                                                    std::allocator<std::pair<int64_t, int64_t>>, 6>;
+    const int64_t nb_stable_values = 1000;
+    const int64_t nb_changing_values = 20000;
+    const size_t nb_readers = 3;
+    
+    map_t map(0, 1);
+    mod_map_t mod_map(0, 1);
+    for(int64_t i = 0; i < nb_stable_values; i++) {
+        map.insert({2*i, 2*i});
+        mod_map.insert({2*i, 2*i});
+    }
+    
+    std::vector<std::size_t> nb_errors(nb_readers, 0);
+    std::atomic<bool> stop(false);
+    
+    std::vector<std::thread> readers;
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        readers.emplace_back([&, ireader]() {
+            while(!stop) {
+                for(int64_t i = 0; i < nb_stable_values; i++) {
+                    int64_t value = -1;
+                    if(!map.find(2*i, value) || value != 2*i || map.at(2*i) != 2*i || 
+                       !mod_map.find(2*i, value) || value != 2*i) 
+                    {
+                        nb_errors[ireader]++;
+                    }
+                }
+            }
+        });
+    }
+    
+    for(int64_t i = 0; i < nb_changing_values; i++) {
+        map.insert({2*i + 1, 2*i + 1});
+        mod_map.insert({2*i + 1, 2*i + 1});
+        if(i % 2 == 0) {
+            map.erase(2*(i/2) + 1);
+            mod_map.erase(2*(i/2) + 1);
+        }
+    }
+    map.rehash(0);
+    mod_map.rehash(0);
+    
+    stop = true;
+    for(auto& reader: readers) {
+        reader.join();
+    }
+    
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        BOOST_CHECK_EQUAL(nb_errors[ireader], 0);
+    }
+    BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_stable_values + nb_changing_values/2));
+    BOOST_CHECK_EQUAL(mod_map.size(), std::size_t(nb_stable_values + nb_changing_values/2));
+}
+
+BOOST_AUTO_TEST_CASE(test_optimistic_reads_rehash_cycles) {
+    // The map is grown and shrunk back while readers look up its keys, the bucket arrays replaced 
+    // by the rehashes must be freed and not accumulate until the destruction of the map.
+    using allocator_t = live_bytes_allocator<std::pair<int64_t, int64_t>>;
+    using map_t = tsl::concurrent_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                                                allocator_t>;
+    const int64_t nb_values = 1000;
+    const size_t nb_readers = 3;
+    const size_t nb_cycles = 50;
+    
+    map_t map(0, 4);
+    for(int64_t i = 0; i < nb_values; i++) {
+        map.insert({i, i});
+    }
+    
+    std::vector<std::size_t> nb_errors(nb_readers, 0);
+    std::atomic<bool> stop(false);
+    
+    std::vector<std::thread> readers;
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        readers.emplace_back([&, ireader]() {
+            while(!stop) {
+                for(int64_t i = 0; i < nb_values; i++) {
+                    int64_t value = -1;
+                    if(!map.find(i, value) || value != i || map.count(nb_values + i) != 0) {
+                        nb_errors[ireader]++;
+                    }
+                }
+            }
+        });
+    }
+    
+    std::size_t live_bytes_after_first_cycle = 0;
+    for(size_t icycle = 0; icycle < nb_cycles; icycle++) {
+        map.reserve(64*nb_values);
+        map.rehash(0);
+        
+        if(icycle == 0) {
+            live_bytes_after_first_cycle = live_bytes();
+        }
+    }
+    
+    stop = true;
+    for(auto& reader: readers) {
+        reader.join();
+    }
+    
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        BOOST_CHECK_EQUAL(nb_errors[ireader], 0);
+    }
+    BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values));
+    BOOST_CHECK_LE(live_bytes(), live_bytes_after_first_cycle);
+}
+
+BOOST_AUTO_TEST_CASE(test_rehash_exception_safety) {
+    // The keys are each in their own bucket, after rehash(0) they are all in the bucket 0 and most of them 
+    // go in the overflow list. Whichever allocation of the rehash fails, the map must be left unchanged.
+    using map_t = tsl::concurrent_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                                                throwing_allocator<std::pair<int64_t, int64_t>>, 6>;
+    const int64_t nb_values = 16;
+    
+    map_t map(1024, 4);
+    for(int64_t i = 0; i < nb_values; i++) {
+        map.insert({64*i, i});
+    }
+    
+    bool rehashed = false;
+    for(int nb_allocations = 0; !rehashed; nb_allocations++) {
+        nb_allocations_before_throw() = nb_allocations;
+        try {
+            map.rehash(0);
+            rehashed = true;
+        }
+        catch(const std::bad_alloc&) {
+            BOOST_CHECK_EQUAL(map.bucket_count(), 1024);
+        }
+        nb_allocations_before_throw() = -1;
+        
+        BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values));
+        for(int64_t i = 0; i < nb_values; i++) {
+            BOOST_CHECK_EQUAL(map.at(64*i), i);
+        }
+    }
+    
+    BOOST_CHECK_EQUAL(map.bucket_count(), 32);
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_insert_same_keys) {
+    // All the threads try to insert the same keys, only one insert of each key must succeed
+    const size_t nb_threads = 4;
+    const int64_t nb_values = 5000;
+    
+    tsl::concurrent_hopscotch_map<int64_t, int64_t> map(0, 2);
+    std::vector<int64_t> nb_inserted(nb_threads, 0);
+    
+    std::vector<std::thread> threads;
+    for(size_t ithread = 0; ithread < nb_threads; ithread++) {
+        threads.emplace_back([&, ithread]() {
+            for(int64_t i = 0; i < nb_values; i++) {
+                if(map.insert({i, i})) {
+                    nb_inserted[ithread]++;
+                }
+                
+                map.visit(i, [](int64_t& value) { value++; });
+            }
+        });
+    }
+    
+    for(auto& thread: threads) {
+        thread.join();
+    }
+    
+    int64_t total_inserted = 0;
+    for(int64_t inserted: nb_inserted) {
+        total_inserted += inserted;
+    }
+    
+    BOOST_CHECK_EQUAL(total_inserted, nb_values);
+    BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values));
+    for(int64_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.at(i), i + int64_t(nb_threads));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,186 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+#include "hopscotch_sc_map.h"
+#include "hopscotch_set.h"
+
+
+/*
+ * Tests of the lookups interleaved with C++20 coroutines, compiled separately in C++20.
+ */
+BOOST_AUTO_TEST_SUITE(test_coroutine_lookups)
+
+#ifdef TSL_HOPSCOTCH_COROUTINES
+
+using test_types = boost::mpl::list<
+                        tsl::hopscotch_map<std::string, std::string>,
+                        // Hash with a lot of collisions, the lookups have to search the overflow list
+                        tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::hopscotch_map<move_only_test, move_only_test, mod_hash<9>, std::equal_to<move_only_test>,
+                            std::allocator<std::pair<move_only_test, move_only_test>>, 6, false,
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>,
+                            std::allocator<std::pair<std::string, std::string>>, 30, true,
+                            tsl::prime_growth_policy, tsl::fingerprint_bucket_layout>,
+                        tsl::hopscotch_sc_map<int64_t, int64_t, mod_hash<9>>
+                        >;
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_find_batch_interleaved, HMap, test_types) {
+    // insert x values, look up 2*x keys (one out of two missing) with different numbers of lookups in flight
+    // and compare with find and count, first without then with an incremental rehash in progress
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    
+    HMap map;
+    map.incremental_rehash(true);
+    
+    size_t nb_values = 0;
+    for(int pass = 0; pass < 2; pass++) {
+        while(nb_values < 1000 || (pass == 1 && !map.rehash_in_progress() && nb_values < 5000)) {
+            map.emplace(utils::get_key<key_t>(2*nb_values), utils::get_value<value_t>(2*nb_values));
+            nb_values++;
+        }
+        
+        std::vector<key_t> keys;
+        for(size_t i = 0; i < 2*nb_values; i++) {
+            keys.push_back(utils::get_key<key_t>(i));
+        }
+        
+        const HMap& const_map = map;
+        for(std::size_t nb_in_flight: {0, 1, 3, 16, 10000}) {
+            std::vector<typename HMap::iterator> its;
+            std::vector<typename HMap::const_iterator> const_its;
+            std::vector<typename HMap::size_type> counts(keys.size());
+            
+            map.find_batch_interleaved(keys.begin(), keys.end(), std::back_inserter(its), nb_in_flight);
+            const_map.find_batch_interleaved(keys.begin(), keys.end(), std::back_inserter(const_its), nb_in_flight);
+            BOOST_CHECK(map.count_batch_interleaved(keys.begin(), keys.end(), counts.begin(), nb_in_flight) ==
+                        counts.end());
+            
+            BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+            BOOST_REQUIRE_EQUAL(const_its.size(), keys.size());
+            for(size_t i = 0; i < keys.size(); i++) {
+                BOOST_CHECK(its[i] == map.find(keys[i]));
+                BOOST_CHECK(const_its[i] == const_map.find(keys[i]));
+                BOOST_CHECK_EQUAL(counts[i], (i % 2 == 0)?1:0);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_find_batch_interleaved_set) {
+    tsl::hopscotch_set<int64_t, mod_hash<9>> set;
+    for(int64_t i = 0; i < 1000; i++) {
+        set.insert(2*i);
+    }
+    
+    std::vector<int64_t> keys = {0, 1, 2, 1998, 1999, 3000};
+    std::vector<tsl::hopscotch_set<int64_t, mod_hash<9>>::const_iterator> its;
+    set.find_batch_interleaved(keys.begin(), keys.end(), std::back_inserter(its));
+    
+    BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        BOOST_CHECK(its[i] == set.find(keys[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_find_batch_interleaved_empty_range) {
+    tsl::hopscotch_map<int64_t, int64_t> map = {{1, 10}};
+    std::vector<int64_t> keys;
+    std::vector<tsl::hopscotch_map<int64_t, int64_t>::iterator> its;
+    
+    map.find_batch_interleaved(keys.begin(), keys.end(), std::back_inserter(its));
+    BOOST_CHECK(its.empty());
+}
+
+
+/*
+ * Forward iterator over utils::get_key<std::string>(counter) returning the keys by value.
+ */
+class key_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string*;
+    using reference = std::string;
+    
+    explicit key_iterator(size_t counter): m_counter(counter) {
+    }
+    
+    std::string operator*() const { return utils::get_key<std::string>(m_counter); }
+    key_iterator& operator++() { m_counter++; return *this; }
+    key_iterator operator++(int) { key_iterator tmp(*this); ++*this; return tmp; }
+    bool operator==(const key_iterator& other) const { return m_counter == other.m_counter; }
+    bool operator!=(const key_iterator& other) const { return m_counter != other.m_counter; }
+    
+private:
+    size_t m_counter;
+};
+
+BOOST_AUTO_TEST_CASE(test_find_batch_interleaved_keys_by_value) {
+    // The iterator returns the keys by value, the coroutines must not keep a reference to the temporary
+    // across their suspension points
+    tsl::hopscotch_map<std::string, int64_t> map;
+    for(size_t i = 0; i < 1000; i += 2) {
+        map.insert({utils::get_key<std::string>(i), int64_t(i)});
+    }
+    
+    std::vector<tsl::hopscotch_map<std::string, int64_t>::iterator> its;
+    map.find_batch_interleaved(key_iterator(0), key_iterator(1000), std::back_inserter(its), 16);
+    
+    BOOST_REQUIRE_EQUAL(its.size(), 1000);
+    for(size_t i = 0; i < its.size(); i++) {
+        BOOST_CHECK(its[i] == map.find(utils::get_key<std::string>(i)));
+    }
+}
+
+
+struct throw_on_key_hash {
+    std::size_t operator()(int64_t key) const {
+        if(key == 42) {
+            throw std::runtime_error("Can't hash 42.");
+        }
+        
+        return std::hash<int64_t>()(key);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(test_find_batch_interleaved_exception) {
+    // The exception of a lookup must be propagated and the results of the previous keys written
+    tsl::hopscotch_map<int64_t, int64_t, throw_on_key_hash> map = {{1, 10}, {2, 20}};
+    std::vector<int64_t> keys = {1, 2, 3, 42, 1};
+    std::vector<tsl::hopscotch_map<int64_t, int64_t, throw_on_key_hash>::iterator> its;
+    
+    BOOST_CHECK_THROW(map.find_batch_interleaved(keys.begin(), keys.end(), std::back_inserter(its), 2),
+                      std::runtime_error);
+    BOOST_REQUIRE_EQUAL(its.size(), 3);
+    for(size_t i = 0; i < its.size(); i++) {
+        BOOST_CHECK(its[i] == map.find(keys[i]));
+    }
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE(test_coroutines_not_supported) {
+    BOOST_TEST_MESSAGE("TSL_HOPSCOTCH_COROUTINES not defined, the interleaved lookups are not tested.");
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
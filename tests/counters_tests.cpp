@@ -0,0 +1,100 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+#include "hopscotch_sc_map.h"
+#include "hopscotch_set.h"
+
+
+/*
+ * Tests of the counters, compiled separately with TSL_HOPSCOTCH_ENABLE_COUNTERS defined.
+ */
+BOOST_AUTO_TEST_SUITE(test_counters)
+
+using test_types = boost::mpl::list<
+                        tsl::hopscotch_map<int64_t, int64_t>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>,
+                            std::allocator<std::pair<std::string, std::string>>, 30, true,
+                            tsl::prime_growth_policy, tsl::fingerprint_bucket_layout>,
+                        // Hash with a lot of collisions, the inserts have to displace values and use the overflow list
+                        tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::hopscotch_sc_map<int64_t, int64_t, mod_hash<9>>
+                        >;
+
+/**
+ * Test counters
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_counters_insert_find, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap::mapped_type;
+    const size_t nb_values = 1000;
+    
+    // No reserve, the map has to grow
+    HMap map;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+    }
+    
+    tsl::hopscotch_counters counters = map.counters();
+    BOOST_CHECK_EQUAL(counters.nb_inserts, nb_values);
+    BOOST_CHECK_EQUAL(counters.nb_overflow_inserts, map.overflow_size());
+    BOOST_CHECK_GT(counters.nb_rehashes_on_load_threshold + counters.nb_rehashes_on_full_neighborhood, 0);
+    BOOST_CHECK_GE(counters.nb_lookups, nb_values);
+    
+    map.reset_counters();
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK(map.find(utils::get_key<key_t>(i)) != map.end());
+    }
+    
+    counters = map.counters();
+    BOOST_CHECK_EQUAL(counters.nb_lookups, nb_values);
+    BOOST_CHECK_EQUAL(counters.nb_inserts, 0);
+    BOOST_CHECK_EQUAL(counters.nb_displacements, 0);
+    // The keys found in the overflow list of a hopscotch_sc_map are compared by the std::set
+    BOOST_CHECK_GE(counters.nb_key_comparisons, nb_values - map.overflow_size());
+}
+
+BOOST_AUTO_TEST_CASE(test_counters_collisions) {
+    // All the values hash to 9 buckets, the neighborhoods are full and the values have to go
+    // in the overflow list
+    using HMap = tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                                    std::allocator<std::pair<int64_t, int64_t>>, 6>;
+    
+    HMap map = utils::get_filled_hash_map<HMap>(1000);
+    BOOST_CHECK_GT(map.overflow_size(), 0);
+    
+    const tsl::hopscotch_counters counters = map.counters();
+    BOOST_CHECK_EQUAL(counters.nb_overflow_inserts, map.overflow_size());
+    BOOST_CHECK_GT(counters.nb_displacements, 0);
+    BOOST_CHECK_GT(counters.nb_key_comparisons, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_counters_copy_swap) {
+    // The counters stay with the map on swap, a copy starts with zero counters
+    using HMap = tsl::hopscotch_set<int64_t>;
+    
+    HMap set = {1, 2, 3, 4, 5};
+    HMap set_copy = set;
+    BOOST_CHECK_EQUAL(set.counters().nb_inserts, 5);
+    BOOST_CHECK_EQUAL(set_copy.counters().nb_inserts, 0);
+    
+    HMap set2 = {6, 7};
+    set.swap(set2);
+    BOOST_CHECK_EQUAL(set.counters().nb_inserts, 5);
+    BOOST_CHECK_EQUAL(set2.counters().nb_inserts, 2);
+    
+    set.reset_counters();
+    BOOST_CHECK_EQUAL(set.counters().nb_inserts, 0);
+    BOOST_CHECK_EQUAL(set.counters().nb_lookups, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
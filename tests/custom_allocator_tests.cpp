@@ -106,4 +106,24 @@ BOOST_AUTO_TEST_CASE(test_custom_allocator_1) {
         //TODO check that number of global allocations is 0
 }
 
+BOOST_AUTO_TEST_CASE(test_custom_allocator_split_bucket_layout) {
+        nb_custom_allocs = 0;
+        
+        tsl::hopscotch_map<int, int, mod_hash<9>, std::equal_to<int>, 
+                           custom_allocator<std::pair<int, int>>, 6, false, 
+                           tsl::power_of_two_growth_policy, tsl::split_bucket_layout> map;
+        
+        const int nb_elements = 10000;
+        for(int i = 0; i < nb_elements; i++) {
+            map.insert({i, i*2});
+        }
+        
+        BOOST_CHECK_NE(map.overflow_size(), 0);
+        BOOST_CHECK_NE(nb_custom_allocs, 0);
+        
+        for(int i = 0; i < nb_elements; i++) {
+            BOOST_CHECK_EQUAL(map.at(i), i*2);
+        }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
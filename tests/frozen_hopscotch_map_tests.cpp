@@ -0,0 +1,241 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "frozen_hopscotch_map.h"
+#include "frozen_hopscotch_set.h"
+#include "hopscotch_map.h"
+#include "hopscotch_set.h"
+
+
+BOOST_AUTO_TEST_SUITE(test_frozen_hopscotch_map)
+
+using test_types = boost::mpl::list<
+                        tsl::hopscotch_map<int64_t, int64_t>,
+                        tsl::hopscotch_map<std::string, std::string>,
+                        tsl::hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 8>,
+                        // Hash with a lot of collisions, most values go in the overflow values
+                        tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>,
+                            std::allocator<std::pair<std::string, std::string>>, 30, true, tsl::prime_growth_policy>,
+                        tsl::hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 62, false, tsl::mod_growth_policy<>>
+                        >;
+
+/*
+ * Each key has its own bucket with tsl::power_of_two_growth_policy.
+ */
+class identity_hash {
+public:
+    std::size_t operator()(int64_t key) const {
+        return std::size_t(key);
+    }
+};
+
+/*
+ * Finalizer of splitmix64, all the bits of the key change the low bits of the hash.
+ */
+class mix_hash {
+public:
+    std::size_t operator()(int64_t key) const {
+        std::uint64_t hash = std::uint64_t(key);
+        hash = (hash ^ (hash >> 30))*0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27))*0x94d049bb133111ebULL;
+        
+        return std::size_t(hash ^ (hash >> 31));
+    }
+};
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_freeze_map, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 5000;
+    
+    const HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    const auto frozen_map = tsl::freeze(map);
+    
+    BOOST_CHECK_EQUAL(frozen_map.size(), nb_values);
+    BOOST_CHECK(!frozen_map.empty());
+    BOOST_CHECK_LE(frozen_map.bucket_count(), map.bucket_count());
+    BOOST_CHECK_LE(frozen_map.overflow_size(), map.overflow_size());
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        const key_t key = utils::get_key<key_t>(i);
+        
+        auto it = frozen_map.find(key);
+        BOOST_REQUIRE(it != frozen_map.end());
+        BOOST_CHECK(it->first == key);
+        BOOST_CHECK(it.key() == key);
+        BOOST_CHECK(it.value() == utils::get_value<value_t>(i));
+        
+        BOOST_CHECK(frozen_map.at(key) == utils::get_value<value_t>(i));
+        BOOST_CHECK(frozen_map.at(key, frozen_map.hash_function()(key)) == utils::get_value<value_t>(i));
+        BOOST_CHECK_EQUAL(frozen_map.count(key), 1);
+        BOOST_CHECK(frozen_map.contains(key));
+    }
+    
+    for(size_t i = nb_values; i < 2*nb_values; i++) {
+        const key_t key = utils::get_key<key_t>(i);
+        
+        BOOST_CHECK(frozen_map.find(key) == frozen_map.end());
+        BOOST_CHECK_EQUAL(frozen_map.count(key), 0);
+        BOOST_CHECK(!frozen_map.contains(key));
+        BOOST_CHECK_THROW(frozen_map.at(key), std::out_of_range);
+    }
+    
+    // Each value is visited once by the iterators
+    HMap iterated_values;
+    for(const auto& key_value: frozen_map) {
+        BOOST_CHECK(iterated_values.insert(key_value).second);
+    }
+    BOOST_CHECK(iterated_values == map);
+}
+
+BOOST_AUTO_TEST_CASE(test_overflow_values) {
+    // All the values have one of 9 hashes, most of them can't be placed in the neighborhood of their bucket
+    using map_t = tsl::frozen_hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>,
+                                            std::allocator<std::pair<int64_t, int64_t>>, 6>;
+    
+    std::vector<std::pair<int64_t, int64_t>> values;
+    for(int64_t i = 0; i < 1000; i++) {
+        values.emplace_back(i, -i);
+    }
+    
+    const map_t map(values.begin(), values.end());
+    BOOST_CHECK_EQUAL(map.size(), 1000);
+    // Only the buckets 0 to 13 are in the neighborhood of the buckets 0 to 8
+    BOOST_CHECK_EQUAL(map.overflow_size(), 1000 - 14);
+    
+    // Growing the bucket count up to the minimum load factor doesn't reduce the number of overflow values,
+    // the smallest bucket count is kept
+    BOOST_CHECK_EQUAL(map.bucket_count(), 1024);
+    
+    for(int64_t i = 0; i < 1000; i++) {
+        BOOST_CHECK_EQUAL(map.at(i), -i);
+    }
+    BOOST_CHECK(!map.contains(1000));
+}
+
+BOOST_AUTO_TEST_CASE(test_no_overflow_with_mixed_hash) {
+    // With random keys and a hash mixing their bits, the bucket count grows until all the values fit in
+    // their neighborhood, even if some steps of the growth don't reduce the number of values which don't fit
+    using map_t = tsl::frozen_hopscotch_map<int64_t, int64_t, mix_hash, std::equal_to<int64_t>,
+                                            std::allocator<std::pair<int64_t, int64_t>>, 8>;
+    using mod_map_t = tsl::frozen_hopscotch_map<int64_t, int64_t, mix_hash, std::equal_to<int64_t>,
+                                                std::allocator<std::pair<int64_t, int64_t>>, 8, tsl::mod_growth_policy<>>;
+    
+    std::mt19937_64 generator(1);
+    for(const std::size_t nb_values: {std::size_t(1000), std::size_t(100000)}) {
+        std::vector<std::pair<int64_t, int64_t>> values;
+        for(std::size_t i = 0; i < nb_values; i++) {
+            values.emplace_back(int64_t(generator()), int64_t(i));
+        }
+        
+        const map_t map(values.begin(), values.end());
+        const mod_map_t mod_map(values.begin(), values.end());
+        BOOST_CHECK_EQUAL(map.size(), nb_values);
+        BOOST_CHECK_EQUAL(mod_map.size(), nb_values);
+        BOOST_CHECK_EQUAL(map.overflow_size(), 0);
+        BOOST_CHECK_EQUAL(mod_map.overflow_size(), 0);
+        
+        for(const auto& key_value: values) {
+            BOOST_CHECK_EQUAL(map.at(key_value.first), key_value.second);
+            BOOST_CHECK_EQUAL(mod_map.at(key_value.first), key_value.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_placement) {
+    // With a key per bucket, all the keys are in their bucket for hash
+    std::vector<std::pair<int64_t, int64_t>> values;
+    for(int64_t i = 0; i < 1024; i++) {
+        values.emplace_back(i, i);
+    }
+    
+    const tsl::frozen_hopscotch_map<int64_t, int64_t, identity_hash> map(values.begin(), values.end());
+    BOOST_CHECK_EQUAL(map.bucket_count(), 1024);
+    BOOST_CHECK_EQUAL(map.load_factor(), 1.0f);
+    BOOST_CHECK_EQUAL(map.total_neighbor_offset(), 0);
+    
+    // 4 keys in each of the buckets 0, 4, 8, ... All the neighborhoods are full, offsets 0 to 3
+    values.clear();
+    for(int64_t i = 0; i < 1024; i++) {
+        values.emplace_back((i/4)*4 + 4096*(i % 4), i);
+    }
+    
+    const tsl::frozen_hopscotch_map<int64_t, int64_t, identity_hash> map_collisions(values.begin(), values.end());
+    BOOST_CHECK_EQUAL(map_collisions.bucket_count(), 1024);
+    BOOST_CHECK_EQUAL(map_collisions.overflow_size(), 0);
+    BOOST_CHECK_EQUAL(map_collisions.total_neighbor_offset(), 256*(0 + 1 + 2 + 3));
+    for(const auto& key_value: values) {
+        BOOST_CHECK_EQUAL(map_collisions.at(key_value.first), key_value.second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_duplicates_initializer_list) {
+    const tsl::frozen_hopscotch_map<std::string, int64_t> map({{"a", 1}, {"b", 2}, {"a", 3}, {"c", 4}});
+    
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.at("a"), 1);
+    BOOST_CHECK_EQUAL(map.at("b"), 2);
+    BOOST_CHECK_EQUAL(map.at("c"), 4);
+    
+    const tsl::frozen_hopscotch_map<std::string, int64_t> map_equal({{"c", 4}, {"b", 2}, {"a", 1}});
+    const tsl::frozen_hopscotch_map<std::string, int64_t> map_different({{"c", 4}, {"b", 2}, {"a", 3}});
+    BOOST_CHECK(map == map_equal);
+    BOOST_CHECK(map != map_different);
+}
+
+BOOST_AUTO_TEST_CASE(test_copy_move) {
+    const auto map = tsl::freeze(utils::get_filled_hash_map<tsl::hopscotch_map<std::string, std::string>>(100));
+    
+    auto map_copy = map;
+    BOOST_CHECK(map_copy == map);
+    
+    const auto map_move = std::move(map_copy);
+    BOOST_CHECK(map_move == map);
+    BOOST_CHECK_EQUAL(map_move.at(utils::get_key<std::string>(10)), utils::get_value<std::string>(10));
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_map) {
+    const tsl::frozen_hopscotch_map<int64_t, int64_t> map(tsl::freeze(tsl::hopscotch_map<int64_t, int64_t>()));
+    
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK(!map.contains(1));
+    BOOST_CHECK_THROW(map.at(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(test_frozen_set) {
+    tsl::hopscotch_set<std::string> set;
+    for(size_t i = 0; i < 1000; i++) {
+        set.insert(utils::get_key<std::string>(i));
+    }
+    
+    const auto frozen_set = tsl::freeze(set);
+    BOOST_CHECK_EQUAL(frozen_set.size(), 1000);
+    for(size_t i = 0; i < 2000; i++) {
+        BOOST_CHECK_EQUAL(frozen_set.count(utils::get_key<std::string>(i)), (i < 1000)?1:0);
+    }
+    
+    tsl::hopscotch_set<std::string> iterated_keys(frozen_set.begin(), frozen_set.end());
+    BOOST_CHECK(iterated_keys == set);
+    
+    BOOST_CHECK(tsl::frozen_hopscotch_set<int64_t>({1, 2, 3, 2}) == tsl::frozen_hopscotch_set<int64_t>({3, 2, 1}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
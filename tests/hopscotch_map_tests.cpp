@@ -50,7 +50,37 @@ using test_types = boost::mpl::list<
                         tsl::hopscotch_map<std::string, std::string, mod_hash<9>, std::equal_to<std::string>, 
                             std::allocator<std::pair<std::string, std::string>>, 62, false, tsl::mod_growth_policy<>>,
                         tsl::hopscotch_map<std::string, std::string, mod_hash<9>, std::equal_to<std::string>, 
-                            std::allocator<std::pair<std::string, std::string>>, 62, false, tsl::mod_growth_policy<std::ratio<4, 3>>>
+                            std::allocator<std::pair<std::string, std::string>>, 62, false, tsl::mod_growth_policy<std::ratio<4, 3>>>,
+                        // with tsl::split_bucket_layout
+                        tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>, 
+                            std::allocator<std::pair<int64_t, int64_t>>, 6, false, tsl::power_of_two_growth_policy, 
+                            tsl::split_bucket_layout>,
+                        tsl::hopscotch_map<move_only_test, move_only_test, mod_hash<9>, std::equal_to<move_only_test>, 
+                            std::allocator<std::pair<move_only_test, move_only_test>>, 6, false, 
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        tsl::hopscotch_map<self_reference_member_test, self_reference_member_test, 
+                            mod_hash<9>, std::equal_to<self_reference_member_test>, 
+                            std::allocator<std::pair<self_reference_member_test, self_reference_member_test>>, 6, true,
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 30, true, 
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        tsl::hopscotch_sc_map<std::string, std::string, mod_hash<9>, std::equal_to<std::string>, 
+                            std::less<std::string>, std::allocator<std::pair<const std::string, std::string>>, 62, false,
+                            tsl::prime_growth_policy, tsl::split_bucket_layout>,
+                        // with tsl::fingerprint_bucket_layout
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 62, false, 
+                            tsl::power_of_two_growth_policy, tsl::fingerprint_bucket_layout>,
+                        tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>, 
+                            std::allocator<std::pair<int64_t, int64_t>>, 6, false, tsl::power_of_two_growth_policy, 
+                            tsl::fingerprint_bucket_layout>,
+                        tsl::hopscotch_map<move_only_test, move_only_test, std::hash<move_only_test>, 
+                            std::equal_to<move_only_test>, std::allocator<std::pair<move_only_test, move_only_test>>, 
+                            30, true, tsl::power_of_two_growth_policy, tsl::fingerprint_bucket_layout>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 17, false, 
+                            tsl::mod_growth_policy<>, tsl::fingerprint_bucket_layout>
                         >;
                                     
                               
@@ -162,6 +192,27 @@ BOOST_AUTO_TEST_CASE(test_range_insert) {
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_range_insert_duplicates, HMap, test_types) {
+    // Insert a range where each key appears 3 times, the first value of each key must be the one kept
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    
+    const size_t nb_keys = 5000;
+    std::vector<typename HMap::value_type> values;
+    for(size_t i = 0; i < 3*nb_keys; i++) {
+        values.emplace_back(utils::get_key<key_t>(i % nb_keys), utils::get_value<value_t>(i));
+    }
+    
+    HMap map;
+    map.emplace(utils::get_key<key_t>(0), utils::get_value<value_t>(3*nb_keys));
+    map.insert(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+    
+    BOOST_CHECK_EQUAL(map.size(), nb_keys);
+    BOOST_CHECK_EQUAL(map.at(utils::get_key<key_t>(0)), utils::get_value<value_t>(3*nb_keys));
+    for(size_t i = 1; i < nb_keys; i++) {
+        BOOST_CHECK_EQUAL(map.at(utils::get_key<key_t>(i)), utils::get_value<value_t>(i));
+    }
+}
+
 
 BOOST_AUTO_TEST_CASE(test_insert_with_hint) {
     tsl::hopscotch_map<int, int> map{{1, 0}, {2, 1}, {3, 2}};
@@ -365,6 +416,37 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_erase_insert, HMap, test_types) {
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_iterator_sparse_map, HMap, test_types) {
+    // insert x values, delete all but one value out of 101, iterate through the remaining values
+    using key_t = typename HMap::key_type;
+    
+    const size_t nb_values = 5000;
+    HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    
+    size_t nb_remaining_values = 0;
+    for(size_t i = 0; i < nb_values; i++) {
+        if(i%101 != 0) {
+            BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+        }
+        else {
+            nb_remaining_values++;
+        }
+    }
+    BOOST_CHECK_EQUAL(map.size(), nb_remaining_values);
+    
+    
+    size_t nb_iterated_values = 0;
+    for(auto it = map.cbegin(); it != map.cend(); ++it) {
+        BOOST_CHECK(map.find(it->first) == it);
+        nb_iterated_values++;
+    }
+    BOOST_CHECK_EQUAL(nb_iterated_values, nb_remaining_values);
+    
+    for(size_t i = 0; i < nb_values; i += 101) {
+        BOOST_CHECK(map.find(utils::get_key<key_t>(i)) != map.end());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_range_erase_same_iterators) {
     const size_t nb_values = 100;
     auto map = utils::get_filled_hash_map<tsl::hopscotch_map<int64_t, int64_t>>(nb_values);
@@ -612,6 +694,52 @@ BOOST_AUTO_TEST_CASE(test_copy) {
     BOOST_CHECK(map_copy == map_copy3);
 }
 
+BOOST_AUTO_TEST_CASE(test_copy_fingerprint_bucket_layout) {
+    using HMap = tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                                    std::allocator<std::pair<std::string, std::string>>, 62, false,
+                                    tsl::power_of_two_growth_policy, tsl::fingerprint_bucket_layout>;
+    
+    
+    const std::size_t nb_values = 1000;
+    HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    
+    HMap map_copy = map;
+    map.clear();
+    
+    BOOST_CHECK(map_copy == utils::get_filled_hash_map<HMap>(nb_values));
+    for(std::size_t i = nb_values; i < nb_values*2; i++) {
+        BOOST_CHECK(map_copy.find(utils::get_key<std::string>(i)) == map_copy.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_copy_move_split_bucket_layout) {
+    using HMap = tsl::hopscotch_map<std::string, std::string, mod_hash<9>, std::equal_to<std::string>, 
+                                    std::allocator<std::pair<std::string, std::string>>, 6, true,
+                                    tsl::power_of_two_growth_policy, tsl::split_bucket_layout>;
+    
+    
+    const std::size_t nb_values = 100;
+    HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    
+    HMap map_copy = map;
+    HMap map_copy2;
+    map_copy2 = map;
+    
+    BOOST_CHECK(map == map_copy);
+    BOOST_CHECK(map == map_copy2);
+    
+    HMap map_move(std::move(map_copy));
+    BOOST_CHECK(map_move == map);
+    BOOST_CHECK(map_copy == (HMap()));
+    
+    map_copy = std::move(map_move);
+    BOOST_CHECK(map_copy == map);
+    
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map_copy == map_copy2);
+}
+
 
 /**
  * at
@@ -641,6 +769,72 @@ BOOST_AUTO_TEST_CASE(test_equal_range) {
 }
 
 
+/**
+ * find_batch, count_batch, at_batch and prefetch
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_find_batch, HMap, test_types) {
+    // insert x values, look up 2*x keys (one out of two missing) in batch and compare with find and count
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    
+    const size_t nb_values = 1000;
+    HMap map;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.emplace(utils::get_key<key_t>(2*i), utils::get_value<value_t>(2*i));
+    }
+    
+    std::vector<key_t> keys;
+    for(size_t i = 0; i < 2*nb_values; i++) {
+        keys.push_back(utils::get_key<key_t>(i));
+    }
+    
+    
+    const HMap& const_map = map;
+    std::vector<typename HMap::iterator> its;
+    std::vector<typename HMap::const_iterator> const_its;
+    std::vector<typename HMap::size_type> counts(keys.size());
+    
+    map.find_batch(keys.begin(), keys.end(), std::back_inserter(its));
+    const_map.find_batch(keys.begin(), keys.end(), std::back_inserter(const_its));
+    BOOST_CHECK(map.count_batch(keys.begin(), keys.end(), counts.begin()) == counts.end());
+    
+    BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+    BOOST_REQUIRE_EQUAL(const_its.size(), keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        BOOST_CHECK(its[i] == map.find(keys[i]));
+        BOOST_CHECK(const_its[i] == const_map.find(keys[i]));
+        BOOST_CHECK_EQUAL(counts[i], (i % 2 == 0)?1:0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_at_batch) {
+    tsl::hopscotch_map<int64_t, int64_t> map = {{1, 10}, {2, 20}, {3, 30}};
+    std::vector<int64_t> keys = {3, 1, 2, 1};
+    
+    std::vector<int64_t> values;
+    map.at_batch(keys.begin(), keys.end(), std::back_inserter(values));
+    BOOST_CHECK(values == (std::vector<int64_t>{30, 10, 20, 10}));
+    
+    keys.push_back(4);
+    keys.push_back(2);
+    
+    values.clear();
+    BOOST_CHECK_THROW(map.at_batch(keys.begin(), keys.end(), std::back_inserter(values)), std::out_of_range);
+    BOOST_CHECK(values == (std::vector<int64_t>{30, 10, 20, 10}));
+}
+
+BOOST_AUTO_TEST_CASE(test_prefetch) {
+    // prefetch is only a hint, check that it can be called on an empty and a non-empty map
+    tsl::hopscotch_map<std::string, int64_t> map;
+    map.prefetch("key");
+    
+    map.insert({"key", 1});
+    map.prefetch("key");
+    map.prefetch("key", map.hash_function()("key"));
+    
+    BOOST_CHECK_EQUAL(map.at("key"), 1);
+}
+
+
 /**
  * operator[]
  */
@@ -655,6 +849,17 @@ BOOST_AUTO_TEST_CASE(test_access_operator) {
     BOOST_CHECK_EQUAL(map.size(), 3);
 }
 
+BOOST_AUTO_TEST_CASE(test_access_operator_sc_map) {
+    tsl::hopscotch_sc_map<int64_t, int64_t> map = {{0, 10}, {-2, 20}};
+    
+    map[0] = 30;
+    BOOST_CHECK_EQUAL(map[0], 30);
+    BOOST_CHECK_EQUAL(map[-2], 20);
+    BOOST_CHECK_EQUAL(map[2], int64_t());
+    
+    BOOST_CHECK_EQUAL(map.size(), 3);
+}
+
 
 
 /**
@@ -673,6 +878,363 @@ BOOST_AUTO_TEST_CASE(test_swap) {
 
 
 
+/**
+ * incremental rehash
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_incremental_rehash, HMap, test_types) {
+    // insert values until an incremental rehash is in progress, check lookups, iteration and erase
+    // during the migration, then complete it with rehash_step. 
+    // With mod_hash, the map may not grow and put everything in the overflow list instead.
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    
+    HMap map;
+    map.incremental_rehash(true);
+    
+    size_t nb_values = 0;
+    while(nb_values < 1000 || (!map.rehash_in_progress() && nb_values < 5000)) {
+        map.insert({utils::get_key<key_t>(nb_values), utils::get_value<value_t>(nb_values)});
+        nb_values++;
+    }
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), nb_values);
+    
+    for(auto it = map.cbegin(); it != map.cend(); ++it) {
+        BOOST_CHECK(map.find(it->first) == it);
+    }
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        auto it = map.find(utils::get_key<key_t>(i));
+        
+        BOOST_CHECK_EQUAL(it->first, utils::get_key<key_t>(i));
+        BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), 1);
+    }
+    
+    
+    // Erase a third of the values by key and a fifth of the remaining ones by iterator
+    for(size_t i = 0; i < nb_values; i += 3) {
+        BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    }
+    
+    size_t nb_iterated_values = 0;
+    for(auto it = map.begin(); it != map.end(); nb_iterated_values++) {
+        it = (nb_iterated_values % 5 == 0)?map.erase(it):std::next(it);
+    }
+    BOOST_CHECK_EQUAL(nb_iterated_values, nb_values - (nb_values + 2)/3);
+    
+    const size_t nb_remaining_values = map.size();
+    BOOST_CHECK_EQUAL(nb_remaining_values, nb_iterated_values - (nb_iterated_values + 4)/5);
+    
+    
+    while(map.rehash_step(16)) {
+    }
+    BOOST_CHECK(!map.rehash_in_progress());
+    BOOST_CHECK_EQUAL(map.size(), nb_remaining_values);
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), nb_remaining_values);
+    
+    size_t nb_found_values = 0;
+    for(size_t i = 0; i < nb_values; i++) {
+        auto it = map.find(utils::get_key<key_t>(i));
+        if(i % 3 == 0) {
+            BOOST_CHECK(it == map.end());
+        }
+        else if(it != map.end()) {
+            BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+            nb_found_values++;
+        }
+    }
+    BOOST_CHECK_EQUAL(nb_found_values, nb_remaining_values);
+}
+
+BOOST_AUTO_TEST_CASE(test_incremental_rehash_copy_move_swap) {
+    using HMap = tsl::hopscotch_map<int64_t, int64_t>;
+    
+    HMap map;
+    map.incremental_rehash(true);
+    
+    int64_t nb_values = 0;
+    while(nb_values < 1000 || !map.rehash_in_progress()) {
+        map.insert({nb_values, nb_values*2});
+        nb_values++;
+    }
+    
+    HMap map_copy = map;
+    BOOST_CHECK(map_copy.rehash_in_progress());
+    BOOST_CHECK(map_copy == map);
+    
+    HMap map_assign;
+    map_assign = map;
+    BOOST_CHECK(map_assign == map);
+    
+    map_copy.insert({-1, -2});
+    BOOST_CHECK_EQUAL(map_copy.size(), map.size() + 1);
+    
+    HMap map_move(std::move(map_copy));
+    BOOST_CHECK_EQUAL(map_move.size(), map.size() + 1);
+    BOOST_CHECK_EQUAL(map_move.at(-1), -2);
+    
+    HMap map_swap = {{1, 10}};
+    auto it = map_move.find(nb_values - 1);
+    
+    using std::swap;
+    swap(map_swap, map_move);
+    BOOST_CHECK(it == map_swap.find(nb_values - 1));
+    BOOST_CHECK_EQUAL(map_move.size(), 1);
+    
+    
+    map_swap.incremental_rehash(false);
+    BOOST_CHECK(!map_swap.rehash_in_progress());
+    for(int64_t i = -1; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map_swap.at(i), i*2);
+    }
+    
+    BOOST_CHECK(map.rehash_in_progress());
+    map.rehash(0);
+    BOOST_CHECK(!map.rehash_in_progress());
+    BOOST_CHECK(map == map_assign);
+}
+
+/**
+ * parallel_rehash
+ */
+struct div8_noexcept_hash {
+    // Eight consecutive keys share the same hash, with a small neighborhood some values go in the overflow list
+    std::size_t operator()(int64_t value) const noexcept {
+        return std::size_t((uint64_t(value/8)*UINT64_C(0x9E3779B97F4A7C15)) >> 24);
+    }
+};
+
+using test_parallel_rehash_types = boost::mpl::list<
+                        tsl::hopscotch_map<int64_t, int64_t>,
+                        tsl::hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 
+                            std::allocator<std::pair<int64_t, int64_t>>, 62, false, tsl::power_of_two_growth_policy, 
+                            tsl::fingerprint_bucket_layout>,
+                        tsl::hopscotch_map<int64_t, int64_t, div8_noexcept_hash, std::equal_to<int64_t>, 
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::hopscotch_sc_map<int64_t, int64_t, div8_noexcept_hash, std::equal_to<int64_t>, 
+                            std::less<int64_t>, std::allocator<std::pair<const int64_t, int64_t>>, 6>,
+                        // Store hash
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 30, true, 
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        // Not supported, same as rehash
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 62, false, tsl::prime_growth_policy>
+                        >;
+                        
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_parallel_rehash, HMap, test_parallel_rehash_types) {
+    // enough values for the buckets to be split between 4 threads
+    using key_t = typename HMap::key_type; using value_t = typename HMap::mapped_type;
+    
+    const size_t nb_values = 20000;
+    
+    HMap map;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+    }
+    
+    const size_t bucket_count = map.bucket_count();
+    
+    map.parallel_rehash(bucket_count*4, 4);
+    BOOST_CHECK(map.bucket_count() >= bucket_count*4);
+    
+    // same bucket count and a number of threads which is not a power of two, then the default number of threads
+    map.parallel_rehash(map.bucket_count(), 3);
+    map.parallel_rehash(map.bucket_count()*2, 0);
+    
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), nb_values);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        auto it = map.find(utils::get_key<key_t>(i));
+        
+        BOOST_REQUIRE(it != map.end());
+        BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+    }
+}
+
+/**
+ * min_load_factor and shrink_to_fit
+ */
+using test_shrink_types = boost::mpl::list<
+                        tsl::hopscotch_map<int64_t, int64_t>,
+                        tsl::hopscotch_map<std::string, std::string>,
+                        tsl::hopscotch_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 
+                            std::allocator<std::pair<std::string, std::string>>, 30, true, 
+                            tsl::power_of_two_growth_policy, tsl::split_bucket_layout>,
+                        tsl::hopscotch_map<move_only_test, move_only_test, std::hash<move_only_test>, 
+                            std::equal_to<move_only_test>, std::allocator<std::pair<move_only_test, move_only_test>>, 
+                            62, false, tsl::prime_growth_policy>,
+                        tsl::hopscotch_sc_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 
+                            std::less<int64_t>, std::allocator<std::pair<const int64_t, int64_t>>, 62, false, 
+                            tsl::mod_growth_policy<>>
+                        >;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_min_load_factor, HMap, test_shrink_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap::mapped_type;
+    
+    HMap map;
+    BOOST_CHECK_EQUAL(map.min_load_factor(), 0.0f);
+    
+    map.min_load_factor(0.5f);
+    BOOST_CHECK_EQUAL(map.min_load_factor(), 0.15f);
+    map.min_load_factor(-1.0f);
+    BOOST_CHECK_EQUAL(map.min_load_factor(), 0.0f);
+    map.min_load_factor(0.1f);
+    
+    const size_t nb_values = 1000;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+    }
+    
+    
+    // The shrink is done on the next insert, the iterators stay valid on erase
+    const size_t bucket_count = map.bucket_count();
+    for(auto it = map.begin(); it != map.end();) {
+        it = (map.size() > 10)?map.erase(it):std::next(it);
+    }
+    BOOST_CHECK_EQUAL(map.size(), 10);
+    BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count);
+    
+    map.insert({utils::get_key<key_t>(nb_values), utils::get_value<value_t>(nb_values)});
+    BOOST_CHECK(map.bucket_count() < bucket_count);
+    BOOST_CHECK(map.load_factor() >= map.min_load_factor());
+    BOOST_CHECK_EQUAL(map.size(), 11);
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), 11);
+    
+    for(const auto& key_value: map) {
+        BOOST_CHECK(map.find(key_value.first) != map.end());
+    }
+    
+    
+    // No shrink on insert without erase before
+    const size_t bucket_count_after_shrink = map.bucket_count();
+    map.insert({utils::get_key<key_t>(nb_values + 1), utils::get_value<value_t>(nb_values + 1)});
+    BOOST_CHECK(map.bucket_count() >= bucket_count_after_shrink);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_min_load_factor_no_grow_after_shrink, HMap, test_shrink_types) {
+    // The shrink must leave enough room for the next inserts, the map is rehashed only once
+    using key_t = typename HMap::key_type; using value_t = typename HMap::mapped_type;
+    
+    HMap map;
+    map.min_load_factor(0.1f);
+    
+    const size_t nb_values = 10000;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+    }
+    
+    for(size_t i = 500; i < nb_values; i++) {
+        map.erase(utils::get_key<key_t>(i));
+    }
+    BOOST_CHECK_EQUAL(map.size(), 500);
+    
+    size_t nb_bucket_count_changes = 0;
+    size_t bucket_count = map.bucket_count();
+    for(size_t i = 500; i < 800; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+        
+        if(map.bucket_count() != bucket_count) {
+            nb_bucket_count_changes++;
+            bucket_count = map.bucket_count();
+        }
+    }
+    
+    BOOST_CHECK_EQUAL(nb_bucket_count_changes, 1);
+    BOOST_CHECK(map.load_factor() >= map.min_load_factor());
+    BOOST_CHECK(map.load_factor() < map.max_load_factor());
+    BOOST_CHECK_EQUAL(map.size(), 800);
+    
+    for(size_t i = 0; i < 800; i++) {
+        BOOST_CHECK_EQUAL(map.at(utils::get_key<key_t>(i)), utils::get_value<value_t>(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_min_load_factor_clamped_by_max_load_factor) {
+    // The minimum load factor stays at most a quarter of the maximum load factor,
+    // whatever the order of the calls
+    tsl::hopscotch_map<int64_t, int64_t> map;
+    map.max_load_factor(0.2f);
+    map.min_load_factor(0.15f);
+    BOOST_CHECK_EQUAL(map.min_load_factor(), 0.05f);
+    
+    tsl::hopscotch_map<int64_t, int64_t> map2;
+    map2.min_load_factor(0.15f);
+    BOOST_CHECK_EQUAL(map2.min_load_factor(), 0.15f);
+    map2.max_load_factor(0.2f);
+    BOOST_CHECK_EQUAL(map2.min_load_factor(), 0.05f);
+    
+    
+    // No shrink and grow on each insert after an erase
+    for(int64_t i = 0; i < 1000; i++) {
+        map2.insert({i, i});
+    }
+    
+    size_t nb_bucket_count_changes = 0;
+    size_t bucket_count = map2.bucket_count();
+    for(int64_t i = 0; i < 1000; i++) {
+        map2.erase(i);
+        map2.insert({i + 1000, i});
+        
+        if(map2.bucket_count() != bucket_count) {
+            nb_bucket_count_changes++;
+            bucket_count = map2.bucket_count();
+        }
+    }
+    BOOST_CHECK_EQUAL(nb_bucket_count_changes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_min_load_factor_disabled) {
+    tsl::hopscotch_map<int64_t, int64_t> map;
+    for(int64_t i = 0; i < 1000; i++) {
+        map.insert({i, i});
+    }
+    
+    const size_t bucket_count = map.bucket_count();
+    for(int64_t i = 0; i < 990; i++) {
+        map.erase(i);
+    }
+    
+    map.insert({1000, 1000});
+    BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_shrink_to_fit, HMap, test_shrink_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap::mapped_type;
+    
+    HMap map;
+    map.shrink_to_fit();
+    BOOST_CHECK(map.empty());
+    
+    const size_t nb_values = 1000;
+    for(size_t i = 0; i < nb_values; i++) {
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+    }
+    
+    const size_t bucket_count = map.bucket_count();
+    for(size_t i = 0; i < nb_values; i++) {
+        if(i % 50 != 0) {
+            map.erase(utils::get_key<key_t>(i));
+        }
+    }
+    
+    map.shrink_to_fit();
+    BOOST_CHECK(map.bucket_count() < bucket_count);
+    BOOST_CHECK_EQUAL(map.size(), nb_values/50);
+    
+    for(size_t i = 0; i < nb_values; i += 50) {
+        BOOST_CHECK_EQUAL(map.at(utils::get_key<key_t>(i)), utils::get_value<value_t>(i));
+    }
+    
+    // Already at the smallest bucket count
+    const size_t bucket_count_after_shrink = map.bucket_count();
+    map.shrink_to_fit();
+    BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count_after_shrink);
+}
+
+
+
 
 
 
@@ -721,11 +1283,11 @@ BOOST_AUTO_TEST_CASE(test_heterogeneous_lookups) {
     std::unique_ptr<int> ptr1(new int(1));
     std::unique_ptr<int> ptr2(new int(2));
     std::unique_ptr<int> ptr3(new int(3));
-    int other;
+    std::unique_ptr<int> ptr_unknown(new int(4));
     
     const uintptr_t addr1 = reinterpret_cast<uintptr_t>(ptr1.get());
     const int* const addr2 = ptr2.get();
-    const int* const addr_unknown = &other;
+    const int* const addr_unknown = ptr_unknown.get();
      
     tsl::hopscotch_map<std::unique_ptr<int>, int, hash_ptr, equal_to_ptr> map;
     map.insert({std::move(ptr1), 4});
@@ -795,6 +1357,178 @@ BOOST_AUTO_TEST_CASE(test_empty_map) {
     BOOST_CHECK_EQUAL(map["new value"], int{});
 }
 
+/**
+ * serialize and deserialize
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_serialize_deserialize, HMap, test_types) {
+    // insert x values, erase some of them, serialize the map and deserialize it with and without hash_compatible
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 1000;
+    
+    HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    for(size_t i = 0; i < nb_values; i += 3) {
+        map.erase(utils::get_key<key_t>(i));
+    }
+    
+    serializer serial;
+    map.serialize(serial);
+    
+    for(bool hash_compatible: {true, false}) {
+        deserializer dserial(serial.buffer());
+        HMap map_deserialized = HMap::deserialize(dserial, hash_compatible);
+        
+        BOOST_CHECK(map_deserialized == map);
+        BOOST_CHECK_EQUAL(map_deserialized.max_load_factor(), map.max_load_factor());
+        if(hash_compatible) {
+            BOOST_CHECK_EQUAL(map_deserialized.bucket_count(), map.bucket_count());
+            BOOST_CHECK_EQUAL(map_deserialized.overflow_size(), map.overflow_size());
+        }
+        
+        // The deserialized map must stay usable
+        for(size_t i = 0; i < nb_values; i++) {
+            BOOST_CHECK_EQUAL(map_deserialized.erase(utils::get_key<key_t>(i)), (i % 3 == 0)?0:1);
+            BOOST_CHECK(map_deserialized.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)}).second);
+        }
+        
+        BOOST_CHECK(map_deserialized == utils::get_filled_hash_map<HMap>(nb_values));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_deserialize_raw_bytes) {
+    // Key and T are trivially copyable, the values are written with the raw bytes overload if the serializer has it
+    using HMap = tsl::hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>, 
+                                    std::allocator<std::pair<int64_t, int64_t>>, 6>;
+    const HMap map = utils::get_filled_hash_map<HMap>(1000);
+    
+    raw_bytes_serializer raw_serial;
+    map.serialize(raw_serial);
+    BOOST_CHECK_EQUAL(raw_serial.nb_raw_writes(), 2*map.size());
+    
+    raw_bytes_deserializer raw_dserial(raw_serial.buffer());
+    BOOST_CHECK(HMap::deserialize(raw_dserial, true) == map);
+    
+    // The values were written as raw bytes, a deserializer without the raw bytes overload can't read them
+    deserializer dserial(raw_serial.buffer());
+    BOOST_CHECK_THROW(HMap::deserialize(dserial), std::runtime_error);
+    
+    serializer serial;
+    map.serialize(serial);
+    raw_bytes_deserializer raw_dserial_from_serial(serial.buffer());
+    BOOST_CHECK_THROW(HMap::deserialize(raw_dserial_from_serial), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_deserialize_incremental_rehash) {
+    // Serialize a map while an incremental rehash is in progress, the values still in the old buckets 
+    // are inserted on deserialization
+    using HMap = tsl::hopscotch_map<std::string, std::string>;
+    
+    HMap map;
+    map.incremental_rehash(true);
+    size_t nb_values = 0;
+    while(nb_values < 100 || !map.rehash_in_progress()) {
+        map.insert({utils::get_key<std::string>(nb_values), utils::get_value<std::string>(nb_values)});
+        nb_values++;
+    }
+    
+    serializer serial;
+    map.serialize(serial);
+    
+    for(bool hash_compatible: {true, false}) {
+        deserializer dserial(serial.buffer());
+        const HMap map_deserialized = HMap::deserialize(dserial, hash_compatible);
+        
+        BOOST_CHECK(!map_deserialized.rehash_in_progress());
+        BOOST_CHECK_EQUAL(map_deserialized.size(), nb_values);
+        BOOST_CHECK(map_deserialized == map);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_deserialize_different_parameters) {
+    // A map with a different NeighborhoodSize is not hash compatible, but its values can still be inserted
+    using HMap = tsl::hopscotch_map<int64_t, int64_t>;
+    using HMap30 = tsl::hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 
+                                      std::allocator<std::pair<int64_t, int64_t>>, 30, true>;
+    const HMap map = utils::get_filled_hash_map<HMap>(1000);
+    
+    serializer serial;
+    map.serialize(serial);
+    
+    deserializer dserial_compatible(serial.buffer());
+    BOOST_CHECK_THROW(HMap30::deserialize(dserial_compatible, true), std::runtime_error);
+    
+    deserializer dserial(serial.buffer());
+    const HMap30 map_deserialized = HMap30::deserialize(dserial);
+    BOOST_CHECK_EQUAL(map_deserialized.size(), map.size());
+    for(const auto& value: map) {
+        BOOST_CHECK_EQUAL(map_deserialized.at(value.first), value.second);
+    }
+    
+    deserializer dserial_truncated(serial.buffer().substr(0, serial.buffer().size()/2));
+    BOOST_CHECK_THROW(HMap::deserialize(dserial_truncated), std::runtime_error);
+}
+
+/**
+ * Test stats
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_stats, HMap, test_types) {
+    // Each value in the buckets is counted once in the displacement histogram and in the neighborhood 
+    // of one bucket
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 1000;
+    
+    HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+    for(size_t i = 0; i < nb_values; i += 2) {
+        map.erase(utils::get_key<key_t>(i));
+    }
+    
+    const tsl::hopscotch_stats stats = map.stats();
+    BOOST_CHECK_EQUAL(stats.nb_overflow_elements, map.overflow_size());
+    BOOST_CHECK_EQUAL(stats.overflow_memory_size > 0, map.overflow_size() > 0);
+    BOOST_CHECK_EQUAL(stats.nb_buckets_with_overflow > 0, map.overflow_size() > 0);
+    BOOST_CHECK_GE(stats.buckets_memory_size, map.bucket_count()*sizeof(value_t));
+    
+    size_t nb_displaced_values = 0;
+    for(size_t nb: stats.displacement_histogram) {
+        nb_displaced_values += nb;
+    }
+    BOOST_CHECK_EQUAL(nb_displaced_values + stats.nb_overflow_elements, map.size());
+    
+    size_t nb_buckets = 0;
+    size_t nb_neighbors = 0;
+    for(size_t i = 0; i < stats.neighborhood_fill_histogram.size(); i++) {
+        nb_buckets += stats.neighborhood_fill_histogram[i];
+        nb_neighbors += i*stats.neighborhood_fill_histogram[i];
+    }
+    BOOST_CHECK_EQUAL(nb_buckets, map.bucket_count());
+    BOOST_CHECK_EQUAL(nb_neighbors, nb_displaced_values);
+    BOOST_CHECK_EQUAL(stats.neighborhood_fill_histogram.size(), stats.displacement_histogram.size() + 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_incremental_rehash) {
+    // The values still in the old buckets are counted
+    using HMap = tsl::hopscotch_map<int64_t, int64_t>;
+    
+    HMap map;
+    map.incremental_rehash(true);
+    size_t nb_values = 0;
+    while(nb_values < 100 || !map.rehash_in_progress()) {
+        map.insert({utils::get_key<int64_t>(nb_values), utils::get_value<int64_t>(nb_values)});
+        nb_values++;
+    }
+    
+    const tsl::hopscotch_stats stats = map.stats();
+    size_t nb_displaced_values = 0;
+    for(size_t nb: stats.displacement_histogram) {
+        nb_displaced_values += nb;
+    }
+    BOOST_CHECK_EQUAL(nb_displaced_values + stats.nb_overflow_elements, nb_values);
+    BOOST_CHECK_GT(stats.buckets_memory_size, map.bucket_count()*sizeof(std::pair<int64_t, int64_t>));
+    
+    const tsl::hopscotch_stats stats_empty = HMap().stats();
+    BOOST_CHECK_EQUAL(stats_empty.displacement_histogram.size(), 62);
+    BOOST_CHECK_EQUAL(stats_empty.nb_overflow_elements, 0);
+}
+
 /**
  * Test precalculated hash
  */
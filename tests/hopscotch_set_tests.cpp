@@ -3,7 +3,11 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/mpl/list.hpp>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "utils.h"
 #include "hopscotch_set.h"
@@ -17,7 +21,13 @@ using test_types = boost::mpl::list<tsl::hopscotch_set<int64_t, mod_hash<9>>,
                                     tsl::hopscotch_set<move_only_test, mod_hash<9>>,
                                     tsl::hopscotch_sc_set<int64_t, mod_hash<9>>,
                                     tsl::hopscotch_sc_set<self_reference_member_test, mod_hash<9>>,
-                                    tsl::hopscotch_sc_set<move_only_test, mod_hash<9>>>;
+                                    tsl::hopscotch_sc_set<move_only_test, mod_hash<9>>,
+                                    tsl::hopscotch_set<move_only_test, mod_hash<9>, std::equal_to<move_only_test>, 
+                                        std::allocator<move_only_test>, 62, false, tsl::power_of_two_growth_policy, 
+                                        tsl::split_bucket_layout>,
+                                    tsl::hopscotch_sc_set<int64_t, mod_hash<9>, std::equal_to<int64_t>, 
+                                        std::less<int64_t>, std::allocator<int64_t>, 62, false, 
+                                        tsl::power_of_two_growth_policy, tsl::split_bucket_layout>>;
                                     
                               
                                     
@@ -54,4 +64,61 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert, HSet, test_types) {
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_find_batch, HSet, test_types) {
+    // insert x values, look up 2*x keys (one out of two missing) in batch and compare with find and count
+    using key_t = typename HSet::key_type;
+    
+    const size_t nb_values = 1000;
+    HSet set;
+    for(size_t i = 0; i < nb_values; i++) {
+        set.insert(utils::get_key<key_t>(2*i));
+    }
+    
+    std::vector<key_t> keys;
+    for(size_t i = 0; i < 2*nb_values; i++) {
+        keys.push_back(utils::get_key<key_t>(i));
+        set.prefetch(keys.back());
+    }
+    
+    std::vector<typename HSet::const_iterator> its;
+    std::vector<typename HSet::size_type> counts;
+    set.find_batch(keys.begin(), keys.end(), std::back_inserter(its));
+    set.count_batch(keys.begin(), keys.end(), std::back_inserter(counts));
+    
+    BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+    BOOST_REQUIRE_EQUAL(counts.size(), keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        BOOST_CHECK(its[i] == set.find(keys[i]));
+        BOOST_CHECK_EQUAL(counts[i], (i % 2 == 0)?1:0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_serialize_deserialize, HSet, test_types) {
+    // insert x values, serialize the set and deserialize it with and without hash_compatible, 
+    // with the raw bytes overloads for the trivially copyable keys
+    using key_t = typename HSet::key_type;
+    
+    const size_t nb_values = 1000;
+    HSet set;
+    for(size_t i = 0; i < nb_values; i++) {
+        set.insert(utils::get_key<key_t>(i));
+    }
+    
+    serializer serial;
+    set.serialize(serial);
+    raw_bytes_serializer raw_serial;
+    set.serialize(raw_serial);
+    
+    for(bool hash_compatible: {true, false}) {
+        deserializer dserial(serial.buffer());
+        raw_bytes_deserializer raw_dserial(raw_serial.buffer());
+        
+        const HSet set_deserialized = HSet::deserialize(dserial, hash_compatible);
+        const HSet set_raw_deserialized = HSet::deserialize(raw_dserial, hash_compatible);
+        
+        BOOST_CHECK(set_deserialized == set);
+        BOOST_CHECK(set_raw_deserialized == set);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,233 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "hopscotch_map.h"
+#include "mapped_hopscotch_map.h"
+#include "mapped_hopscotch_set.h"
+
+
+/*
+ * Remove the file on destruction.
+ */
+class temporary_file {
+public:
+    explicit temporary_file(std::string filename): m_filename(std::move(filename)) {
+    }
+    
+    ~temporary_file() {
+        std::remove(m_filename.c_str());
+    }
+    
+    const std::string& name() const {
+        return m_filename;
+    }
+    
+private:
+    std::string m_filename;
+};
+
+
+BOOST_AUTO_TEST_SUITE(test_mapped_hopscotch_map)
+
+using test_types = boost::mpl::list<
+                        tsl::mapped_hopscotch_map<int64_t, int64_t>,
+                        tsl::mapped_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 8>,
+                        // Hash with a lot of collisions, most values go in the overflow section
+                        tsl::mapped_hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>, 6>,
+                        tsl::mapped_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 62,
+                                                  tsl::prime_growth_policy>,
+                        tsl::mapped_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 30,
+                                                  tsl::mod_growth_policy<>>
+                        >;
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_write_map, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 10000;
+    const temporary_file file("test_mapped_hopscotch_map.bin");
+    
+    std::vector<std::pair<key_t, value_t>> values;
+    for(size_t i = 0; i < nb_values; i++) {
+        values.emplace_back(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+    }
+    // Duplicate, only the first one is written
+    values.emplace_back(utils::get_key<key_t>(10), utils::get_value<value_t>(11));
+    
+    HMap::write(file.name(), values.begin(), values.end());
+    
+    const HMap map(file.name());
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    BOOST_CHECK(!map.empty());
+    BOOST_CHECK_LE(map.load_factor(), 1.0f);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        const key_t key = utils::get_key<key_t>(i);
+        
+        auto it = map.find(key);
+        BOOST_REQUIRE(it != map.end());
+        BOOST_CHECK_EQUAL(it->first, key);
+        BOOST_CHECK_EQUAL(it.key(), key);
+        BOOST_CHECK_EQUAL(it.value(), utils::get_value<value_t>(i));
+        
+        BOOST_CHECK_EQUAL(map.at(key), utils::get_value<value_t>(i));
+        BOOST_CHECK_EQUAL(map.at(key, map.hash_function()(key)), utils::get_value<value_t>(i));
+        BOOST_CHECK_EQUAL(map.count(key), 1);
+        BOOST_CHECK(map.contains(key));
+    }
+    
+    for(size_t i = nb_values; i < 2*nb_values; i++) {
+        const key_t key = utils::get_key<key_t>(i);
+        
+        BOOST_CHECK(map.find(key) == map.end());
+        BOOST_CHECK_EQUAL(map.count(key), 0);
+        BOOST_CHECK(!map.contains(key));
+        BOOST_CHECK_THROW(map.at(key), std::out_of_range);
+    }
+    
+    // Each value is visited once by the iterators
+    tsl::hopscotch_map<key_t, value_t> iterated_values;
+    for(const auto& key_value: map) {
+        BOOST_CHECK(iterated_values.insert(key_value).second);
+    }
+    BOOST_CHECK_EQUAL(iterated_values.size(), nb_values);
+    const tsl::hopscotch_map<key_t, value_t> expected_values(values.begin(), values.end());
+    BOOST_CHECK(iterated_values == expected_values);
+}
+
+BOOST_AUTO_TEST_CASE(test_overflow_section) {
+    // All the values have one of 9 hashes, most of them can't be placed in the neighborhood of their bucket
+    using map_t = tsl::mapped_hopscotch_map<int64_t, int64_t, mod_hash<9>, std::equal_to<int64_t>, 6>;
+    const temporary_file file("test_mapped_hopscotch_map_overflow.bin");
+    
+    std::vector<std::pair<int64_t, int64_t>> values;
+    for(int64_t i = 0; i < 1000; i++) {
+        values.emplace_back(i, -i);
+    }
+    map_t::write(file.name(), values.begin(), values.end());
+    
+    const map_t map(file.name());
+    BOOST_CHECK_GT(map.overflow_size(), 0);
+    BOOST_CHECK_EQUAL(map.size(), 1000);
+    
+    // The bucket array didn't grow as it doesn't change the neighborhoods
+    BOOST_CHECK_LE(map.bucket_count(), 2048);
+    
+    for(int64_t i = 0; i < 1000; i++) {
+        BOOST_CHECK_EQUAL(map.at(i), -i);
+    }
+    BOOST_CHECK(!map.contains(1000));
+    
+    std::size_t nb_iterated_values = 0;
+    for(auto it = map.cbegin(); it != map.cend(); ++it) {
+        BOOST_CHECK_EQUAL(it.value(), -it.key());
+        nb_iterated_values++;
+    }
+    BOOST_CHECK_EQUAL(nb_iterated_values, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_initializer_list_and_move) {
+    using map_t = tsl::mapped_hopscotch_map<int64_t, double>;
+    const temporary_file file("test_mapped_hopscotch_map_init.bin");
+    
+    map_t::write(file.name(), {{1, 1.5}, {2, 2.5}, {3, 3.5}}, 0.5f);
+    
+    map_t map(file.name());
+    auto it = map.find(2);
+    
+    map_t moved_map(std::move(map));
+    BOOST_CHECK_EQUAL(moved_map.size(), 3);
+    BOOST_CHECK_EQUAL(it->second, 2.5);
+    BOOST_CHECK(it == moved_map.find(2));
+    BOOST_CHECK_EQUAL(moved_map.at(3), 3.5);
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_map) {
+    using map_t = tsl::mapped_hopscotch_map<int64_t, int64_t>;
+    const temporary_file file("test_mapped_hopscotch_map_empty.bin");
+    
+    const std::vector<std::pair<int64_t, int64_t>> values;
+    map_t::write(file.name(), values.begin(), values.end());
+    
+    const map_t map(file.name());
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK(!map.contains(1));
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_file) {
+    using map_t = tsl::mapped_hopscotch_map<int64_t, int64_t>;
+    const temporary_file file("test_mapped_hopscotch_map_invalid.bin");
+    
+    BOOST_CHECK_THROW(map_t("test_mapped_hopscotch_map_missing.bin"), std::runtime_error);
+    
+    std::vector<std::pair<int64_t, int64_t>> values;
+    for(int64_t i = 0; i < 100; i++) {
+        values.emplace_back(i, i);
+    }
+    map_t::write(file.name(), values.begin(), values.end());
+    
+    // Different template parameters
+    BOOST_CHECK_THROW((tsl::mapped_hopscotch_map<int32_t, int32_t>(file.name())), std::runtime_error);
+    BOOST_CHECK_THROW((tsl::mapped_hopscotch_map<int64_t, int64_t, std::hash<int64_t>,
+                                                 std::equal_to<int64_t>, 30>(file.name())), std::runtime_error);
+    BOOST_CHECK_THROW((tsl::mapped_hopscotch_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>, 62,
+                                                 tsl::prime_growth_policy>(file.name())), std::runtime_error);
+    
+    // Truncated file
+    std::string content;
+    {
+        std::ifstream input(file.name(), std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream output(file.name(), std::ios::binary | std::ios::trunc);
+        output.write(content.data(), std::streamsize(content.size() - 8));
+    }
+    BOOST_CHECK_THROW(map_t(file.name()), std::runtime_error);
+    
+    // Not a mapped hash table
+    {
+        std::ofstream output(file.name(), std::ios::binary | std::ios::trunc);
+        output << "not a mapped hash table, not a mapped hash table, not a mapped hash table, "
+                  "not a mapped hash table, not a mapped hash table";
+    }
+    BOOST_CHECK_THROW(map_t(file.name()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_mapped_set) {
+    using set_t = tsl::mapped_hopscotch_set<int64_t>;
+    const temporary_file file("test_mapped_hopscotch_set.bin");
+    
+    std::vector<int64_t> keys;
+    for(int64_t i = 0; i < 5000; i++) {
+        keys.push_back(3*i);
+    }
+    set_t::write(file.name(), keys.begin(), keys.end());
+    
+    const set_t set(file.name());
+    BOOST_CHECK_EQUAL(set.size(), 5000);
+    for(int64_t i = 0; i < 3*5000; i++) {
+        BOOST_CHECK_EQUAL(set.count(i), (i % 3 == 0)?1:0);
+    }
+    
+    int64_t sum = 0;
+    for(int64_t key: set) {
+        sum += key;
+    }
+    BOOST_CHECK_EQUAL(sum, 3*(int64_t(5000)*4999/2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,250 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "sharded_hopscotch_map.h"
+
+
+BOOST_AUTO_TEST_SUITE(test_sharded_hopscotch_map)
+
+using test_types = boost::mpl::list<
+                        tsl::sharded_hopscotch_map<int64_t, int64_t>,
+                        tsl::sharded_hopscotch_map<std::string, std::string, 4>,
+                        tsl::sharded_hopscotch_map<int64_t, int64_t, 1>,
+                        // Hash with a lot of collisions, some values go in the overflow list
+                        tsl::sharded_hopscotch_map<int64_t, int64_t, 8, mod_hash<9>, std::equal_to<int64_t>,
+                            std::allocator<std::pair<int64_t, int64_t>>, 6>,
+                        tsl::sharded_hopscotch_map<std::string, std::string, 2, std::hash<std::string>,
+                            std::equal_to<std::string>, std::allocator<std::pair<std::string, std::string>>, 30, true>
+                        >;
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_erase, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 5000;
+    
+    HMap map(0);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK(map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)}));
+    }
+    BOOST_CHECK(!map.insert({utils::get_key<key_t>(10), utils::get_value<value_t>(11)}));
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        value_t value = utils::get_value<value_t>(nb_values);
+        BOOST_CHECK(map.find(utils::get_key<key_t>(i), value));
+        BOOST_CHECK(value == utils::get_value<value_t>(i));
+        BOOST_CHECK(map.at(utils::get_key<key_t>(i)) == utils::get_value<value_t>(i));
+    }
+    
+    for(size_t i = 0; i < nb_values; i += 2) {
+        BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    }
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(0)), 0);
+    BOOST_CHECK_EQUAL(map.size(), nb_values/2);
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), (i % 2 == 0)?0:1);
+    }
+    
+    value_t value = utils::get_value<value_t>(nb_values);
+    BOOST_CHECK(!map.find(utils::get_key<key_t>(0), value));
+    BOOST_CHECK(value == utils::get_value<value_t>(nb_values));
+    BOOST_CHECK_THROW(map.at(utils::get_key<key_t>(0)), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_batches, HMap, test_types) {
+    // insert_batch, count_batch and erase_batch must give the same results as the single key operations
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 2000;
+    
+    std::vector<std::pair<key_t, value_t>> values;
+    for(size_t i = 0; i < nb_values; i++) {
+        values.emplace_back(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+    }
+    // Duplicate key, not inserted
+    values.emplace_back(utils::get_key<key_t>(5), utils::get_value<value_t>(6));
+    
+    HMap map;
+    BOOST_CHECK_EQUAL(map.insert_batch(values.begin(), values.end()), nb_values);
+    BOOST_CHECK_EQUAL(map.insert_batch(values.begin(), values.begin()), 0);
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    BOOST_CHECK(map.at(utils::get_key<key_t>(5)) == utils::get_value<value_t>(5));
+    
+    std::vector<key_t> keys;
+    for(size_t i = 0; i < 2*nb_values; i++) {
+        keys.push_back(utils::get_key<key_t>(i));
+    }
+    
+    std::vector<typename HMap::size_type> counts(keys.size() + 1, 42);
+    BOOST_CHECK(map.count_batch(keys.begin(), keys.end(), counts.begin()) == counts.end() - 1);
+    for(size_t i = 0; i < keys.size(); i++) {
+        BOOST_CHECK_EQUAL(counts[i], (i < nb_values)?1:0);
+    }
+    BOOST_CHECK_EQUAL(counts.back(), 42);
+    
+    std::vector<key_t> keys_to_erase;
+    for(size_t i = 0; i < 2*nb_values; i += 2) {
+        keys_to_erase.push_back(utils::get_key<key_t>(i));
+    }
+    BOOST_CHECK_EQUAL(map.erase_batch(keys_to_erase.begin(), keys_to_erase.end()), nb_values/2);
+    BOOST_CHECK_EQUAL(map.size(), nb_values/2);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), (i % 2 == 0)?0:1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_shards_reserve_clear, HMap, test_types) {
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_values = 1000;
+    
+    HMap map;
+    map.reserve(4*nb_values);
+    const std::size_t bucket_count = map.bucket_count();
+    
+    for(size_t i = 0; i < nb_values; i++) {
+        map.emplace(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+    }
+    BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count);
+    
+    // Each key must be in the shard given by shard_index
+    std::size_t nb_elements = 0;
+    std::size_t ishard = 0;
+    std::size_t nb_misplaced = 0;
+    map.for_each_shard([&](const typename HMap::map_type& shard_map) {
+        for(const auto& value: shard_map) {
+            if(map.shard_index(value.first) != ishard) {
+                nb_misplaced++;
+            }
+        }
+        
+        nb_elements += shard_map.size();
+        ishard++;
+    });
+    BOOST_CHECK_EQUAL(ishard, HMap::shard_count());
+    BOOST_CHECK_EQUAL(nb_elements, nb_values);
+    BOOST_CHECK_EQUAL(nb_misplaced, 0);
+    
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(!map.contains(utils::get_key<key_t>(1)));
+    
+    BOOST_CHECK(map.insert({utils::get_key<key_t>(1), utils::get_value<value_t>(1)}));
+    BOOST_CHECK_EQUAL(map.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_try_emplace_insert_or_assign_visit) {
+    tsl::sharded_hopscotch_map<int64_t, std::string> map;
+    
+    BOOST_CHECK(map.try_emplace(1, 3, 'a'));
+    BOOST_CHECK(!map.try_emplace(1, 3, 'b'));
+    BOOST_CHECK_EQUAL(map.at(1), "aaa");
+    
+    BOOST_CHECK(map.insert_or_assign(2, "b"));
+    BOOST_CHECK(!map.insert_or_assign(1, "c"));
+    BOOST_CHECK_EQUAL(map.at(1), "c");
+    BOOST_CHECK_EQUAL(map.at(2), "b");
+    
+    BOOST_CHECK(map.visit(2, [](std::string& value) { value += "d"; }));
+    BOOST_CHECK(!map.visit(3, [](std::string& value) { value += "d"; }));
+    BOOST_CHECK_EQUAL(map.at(2), "bd");
+    
+    const auto& const_map = map;
+    std::size_t length = 0;
+    BOOST_CHECK(const_map.visit(2, [&](const std::string& value) { length = value.size(); }));
+    BOOST_CHECK_EQUAL(length, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_shard_distribution) {
+    // std::hash of an integer is often the identity, the consecutive keys must still be spread over all the shards
+    tsl::sharded_hopscotch_map<int64_t, int64_t, 16> map;
+    std::vector<std::size_t> nb_keys_in_shard(map.shard_count(), 0);
+    for(int64_t i = 0; i < 16000; i++) {
+        nb_keys_in_shard[map.shard_index(i)]++;
+    }
+    
+    for(std::size_t nb_keys: nb_keys_in_shard) {
+        BOOST_CHECK_GT(nb_keys, 500);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_concurrent_operations, HMap, test_types) {
+    // Each thread inserts, looks up and erases its own keys while the others do the same with theirs,
+    // one out of two threads through the batched operations.
+    using key_t = typename HMap::key_type; using value_t = typename HMap:: mapped_type;
+    const size_t nb_threads = 4;
+    const size_t nb_values_per_thread = 3000;
+    
+    HMap map(0);
+    std::vector<std::size_t> nb_errors(nb_threads, 0);
+    
+    std::vector<std::thread> threads;
+    for(size_t ithread = 0; ithread < nb_threads; ithread++) {
+        threads.emplace_back([&, ithread]() {
+            if(ithread % 2 == 0) {
+                for(size_t i = ithread; i < nb_threads*nb_values_per_thread; i += nb_threads) {
+                    if(!map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)})) {
+                        nb_errors[ithread]++;
+                    }
+                }
+                
+                for(size_t i = ithread; i < nb_threads*nb_values_per_thread; i += nb_threads) {
+                    value_t value = utils::get_value<value_t>(i + 1);
+                    if(!map.find(utils::get_key<key_t>(i), value) || !(value == utils::get_value<value_t>(i))) {
+                        nb_errors[ithread]++;
+                    }
+                    
+                    if(i % 3 == 0 && map.erase(utils::get_key<key_t>(i)) != 1) {
+                        nb_errors[ithread]++;
+                    }
+                }
+            }
+            else {
+                std::vector<std::pair<key_t, value_t>> values;
+                std::vector<key_t> keys_to_erase;
+                for(size_t i = ithread; i < nb_threads*nb_values_per_thread; i += nb_threads) {
+                    values.emplace_back(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+                    if(i % 3 == 0) {
+                        keys_to_erase.push_back(utils::get_key<key_t>(i));
+                    }
+                }
+                
+                if(map.insert_batch(values.begin(), values.end()) != values.size()) {
+                    nb_errors[ithread]++;
+                }
+                if(map.erase_batch(keys_to_erase.begin(), keys_to_erase.end()) != keys_to_erase.size()) {
+                    nb_errors[ithread]++;
+                }
+            }
+        });
+    }
+    
+    for(auto& thread: threads) {
+        thread.join();
+    }
+    
+    for(size_t ithread = 0; ithread < nb_threads; ithread++) {
+        BOOST_CHECK_EQUAL(nb_errors[ithread], 0);
+    }
+    
+    const size_t nb_values = nb_threads*nb_values_per_thread;
+    BOOST_CHECK_EQUAL(map.size(), nb_values - (nb_values + 2)/3);
+    for(size_t i = 0; i < nb_values; i++) {
+        BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), (i % 3 == 0)?0:1);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
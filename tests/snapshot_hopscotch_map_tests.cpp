@@ -0,0 +1,172 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "snapshot_hopscotch_map.h"
+
+
+BOOST_AUTO_TEST_SUITE(test_snapshot_hopscotch_map)
+
+BOOST_AUTO_TEST_CASE(test_update_assign) {
+    using map_t = tsl::snapshot_hopscotch_map<std::string, int64_t>;
+    
+    map_t map(map_t::map_type({{"a", 1}, {"b", 2}}));
+    auto reader = map.make_reader();
+    BOOST_CHECK_EQUAL(map.epoch(), 1);
+    
+    {
+        auto view = reader.read();
+        BOOST_CHECK_EQUAL(view->size(), 2);
+        BOOST_CHECK_EQUAL(view->at("a"), 1);
+    }
+    
+    map.update([](map_t::map_type& new_map) {
+        new_map.erase("a");
+        new_map.insert({"c", 3});
+    });
+    BOOST_CHECK_EQUAL(map.epoch(), 2);
+    
+    {
+        auto view = reader.read();
+        BOOST_CHECK_EQUAL(view->size(), 2);
+        BOOST_CHECK_EQUAL(view->count("a"), 0);
+        BOOST_CHECK_EQUAL(view->at("c"), 3);
+    }
+    
+    BOOST_CHECK_THROW(map.update([](map_t::map_type& new_map) {
+                          new_map.clear();
+                          throw std::runtime_error("Update failed.");
+                      }), std::runtime_error);
+    BOOST_CHECK_EQUAL(map.epoch(), 2);
+    BOOST_CHECK_EQUAL(reader.read()->size(), 2);
+    
+    map.assign(map_t::map_type({{"d", 4}}));
+    BOOST_CHECK_EQUAL(map.epoch(), 3);
+    
+    auto view = reader.read();
+    BOOST_CHECK_EQUAL(view->size(), 1);
+    BOOST_CHECK_EQUAL(view.get().at("d"), 4);
+    BOOST_CHECK_EQUAL((*view).at("d"), 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_reclaim) {
+    // A retired snapshot must stay readable, and not be freed, while a view on it exists
+    using map_t = tsl::snapshot_hopscotch_map<int64_t, int64_t>;
+    
+    map_t map(map_t::map_type({{1, 1}}));
+    auto reader1 = map.make_reader();
+    auto reader2 = map.make_reader();
+    
+    {
+        auto old_view = reader1.read();
+        map.update([](map_t::map_type& new_map) { new_map[1] = 2; });
+        
+        auto new_view = reader2.read();
+        BOOST_CHECK_EQUAL(old_view->at(1), 1);
+        BOOST_CHECK_EQUAL(new_view->at(1), 2);
+        BOOST_CHECK_EQUAL(map.reclaim(), 1);
+        
+        map.update([](map_t::map_type& new_map) { new_map[1] = 3; });
+        BOOST_CHECK_EQUAL(map.reclaim(), 2);
+        BOOST_CHECK_EQUAL(old_view->at(1), 1);
+    }
+    
+    BOOST_CHECK_EQUAL(map.reclaim(), 0);
+    BOOST_CHECK_EQUAL(reader1.read()->at(1), 3);
+    
+    // A view taken after a publication doesn't hold the snapshots retired before
+    auto view = reader1.read();
+    map.update([](map_t::map_type& new_map) { new_map[1] = 4; });
+    BOOST_CHECK_EQUAL(map.reclaim(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_reader_slots_reuse) {
+    using map_t = tsl::snapshot_hopscotch_map<int64_t, int64_t>;
+    
+    map_t map;
+    for(int i = 0; i < 100; i++) {
+        auto reader = map.make_reader();
+        auto moved_reader = std::move(reader);
+        BOOST_CHECK(moved_reader.read()->empty());
+    }
+    
+    // The slots of the destroyed readers are free, a retired snapshot can be reclaimed
+    map.update([](map_t::map_type& new_map) { new_map.insert({1, 1}); });
+    BOOST_CHECK_EQUAL(map.reclaim(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_concurrent_readers) {
+    // The writer publishes snapshots where all the values are equal to the epoch of the snapshot.
+    // A reader must always see all the values of a snapshot equal and the epochs never decrease.
+    using map_t = tsl::snapshot_hopscotch_map<int64_t, int64_t>;
+    const int64_t nb_values = 500;
+    const int64_t nb_updates = 500;
+    const size_t nb_readers = 3;
+    
+    map_t::map_type initial_map;
+    for(int64_t i = 0; i < nb_values; i++) {
+        initial_map.insert({i, 1});
+    }
+    
+    map_t map(initial_map);
+    std::vector<std::size_t> nb_errors(nb_readers, 0);
+    std::atomic<bool> stop(false);
+    
+    std::vector<std::thread> readers;
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        readers.emplace_back([&, ireader]() {
+            auto reader = map.make_reader();
+            int64_t last_epoch = 0;
+            
+            while(!stop) {
+                auto view = reader.read();
+                const int64_t epoch = view->at(0);
+                if(epoch < last_epoch || int64_t(view->size()) != nb_values + epoch - 1) {
+                    nb_errors[ireader]++;
+                }
+                
+                for(int64_t i = 0; i < nb_values; i++) {
+                    auto it = view->find(i);
+                    if(it == view->end() || it->second != epoch) {
+                        nb_errors[ireader]++;
+                    }
+                }
+                
+                last_epoch = epoch;
+            }
+        });
+    }
+    
+    for(int64_t update = 0; update < nb_updates; update++) {
+        map.update([&](map_t::map_type& new_map) {
+            const int64_t epoch = int64_t(map.epoch()) + 1;
+            for(auto it = new_map.begin(); it != new_map.end(); ++it) {
+                it.value() = epoch;
+            }
+            new_map.insert({nb_values + update, epoch});
+        });
+    }
+    
+    stop = true;
+    for(auto& reader: readers) {
+        reader.join();
+    }
+    
+    for(size_t ireader = 0; ireader < nb_readers; ireader++) {
+        BOOST_CHECK_EQUAL(nb_errors[ireader], 0);
+    }
+    BOOST_CHECK_EQUAL(map.reclaim(), 0);
+    BOOST_CHECK_EQUAL(map.epoch(), std::size_t(nb_updates + 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,10 +4,13 @@
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 
@@ -223,4 +226,133 @@ inline HMap utils::get_filled_hash_map(size_t nb_elements) {
     return map;
 }
 
+
+/**
+ * Serializer writing the values in a buffer, the values of the test types are written member by member.
+ */
+class serializer {
+public:
+    template<typename T, typename std::enable_if<std::is_arithmetic<T>::value>::type* = nullptr>
+    void operator()(const T& value) {
+        m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    
+    void operator()(const std::string& value) {
+        (*this)(std::uint64_t(value.size()));
+        m_buffer.append(value);
+    }
+    
+    void operator()(const move_only_test& value) {
+        (*this)(value.value());
+    }
+    
+    void operator()(const self_reference_member_test& value) {
+        (*this)(value.value());
+    }
+    
+    template<typename T1, typename T2>
+    void operator()(const std::pair<T1, T2>& value) {
+        (*this)(value.first);
+        (*this)(value.second);
+    }
+    
+    const std::string& buffer() const {
+        return m_buffer;
+    }
+    
+protected:
+    std::string m_buffer;
+};
+
+/**
+ * Serializer which also supports the raw bytes overload used for the trivially copyable values.
+ */
+class raw_bytes_serializer: public serializer {
+public:
+    using serializer::operator();
+    
+    void operator()(const char* data, std::size_t size) {
+        m_buffer.append(data, size);
+        m_nb_raw_writes++;
+    }
+    
+    std::size_t nb_raw_writes() const {
+        return m_nb_raw_writes;
+    }
+    
+private:
+    std::size_t m_nb_raw_writes = 0;
+};
+
+class deserializer {
+    template<typename T>
+    struct tag {
+    };
+    
+public:
+    explicit deserializer(std::string buffer): m_buffer(std::move(buffer)), m_position(0) {
+    }
+    
+    template<typename T>
+    T operator()() {
+        return read(tag<T>());
+    }
+    
+protected:
+    void read_bytes(char* data, std::size_t size) {
+        if(m_position + size > m_buffer.size()) {
+            throw std::runtime_error("Not enough bytes in the buffer.");
+        }
+        
+        std::memcpy(data, m_buffer.data() + m_position, size);
+        m_position += size;
+    }
+    
+private:
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type read(tag<T>) {
+        T value;
+        read_bytes(reinterpret_cast<char*>(&value), sizeof(T));
+        
+        return value;
+    }
+    
+    std::string read(tag<std::string>) {
+        std::string value(std::size_t(read(tag<std::uint64_t>())), '\0');
+        read_bytes(&value[0], value.size());
+        
+        return value;
+    }
+    
+    move_only_test read(tag<move_only_test>) {
+        return move_only_test(read(tag<int64_t>()));
+    }
+    
+    self_reference_member_test read(tag<self_reference_member_test>) {
+        return self_reference_member_test(read(tag<int64_t>()));
+    }
+    
+    template<typename T1, typename T2>
+    std::pair<T1, T2> read(tag<std::pair<T1, T2>>) {
+        auto first = read(tag<typename std::remove_const<T1>::type>());
+        auto second = read(tag<typename std::remove_const<T2>::type>());
+        
+        return std::pair<T1, T2>(std::move(first), std::move(second));
+    }
+    
+private:
+    std::string m_buffer;
+    std::size_t m_position;
+};
+
+class raw_bytes_deserializer: public deserializer {
+public:
+    using deserializer::deserializer;
+    using deserializer::operator();
+    
+    void operator()(char* data, std::size_t size) {
+        read_bytes(data, size);
+    }
+};
+
 #endif